@@ -0,0 +1,381 @@
+/// File: batch.cc
+/// --------------
+/// Builds many mazes at once for puzzle corpora. Every worker thread builds
+/// whole mazes on its own, so K mazes keep every core busy without the cost of
+/// starting a process per maze. Maze i is built from seed + i, so any maze in a
+/// batch can be built again alone from the seed reported for it.
+///
+/// One JSON object per line reports each maze as it finishes, in whatever
+/// order the workers finish them. With -o the lines go to results.jsonl in that
+/// directory and every maze is also saved as a binary file laid out as:
+///
+///   bytes 0-3    "MAZE"
+///   bytes 4-7    rows, little endian
+///   bytes 8-11   columns, little endian
+///   then         rows * columns squares, row major, two bytes each, little
+///                endian, holding only the path bit and the wall bits.
+import labyrinth;
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Build_function = std::function<void(Maze::Maze &)>;
+
+struct Run_args {
+    uint64_t count{1};
+    Maze::Maze_args maze{};
+    std::string builder_name{"rdfs"};
+    Build_function builder{Recursive_backtracker::generate_maze};
+    std::optional<std::string> modification_name;
+    std::optional<Build_function> modder;
+    std::optional<uint64_t> seed;
+    bool solve{false};
+    std::optional<std::filesystem::path> out_dir;
+    uint64_t workers{std::max(std::thread::hardware_concurrency(), 1U)};
+};
+
+struct Maze_result {
+    uint64_t index;
+    uint64_t seed;
+    double build_seconds;
+    std::optional<double> solve_seconds;
+    std::optional<uint64_t> solution_length;
+    std::optional<std::string> file;
+};
+
+/// Results are written a whole line at a time so lines from different workers
+/// never mix.
+class Result_log {
+  public:
+    explicit Result_log(std::ostream &out) : out_(out) {
+    }
+
+    void
+    write(Run_args const &args, Maze_result const &result) {
+        std::string line = "{\"maze\":" + std::to_string(result.index)
+                           + ",\"seed\":" + std::to_string(result.seed)
+                           + ",\"builder\":\"" + args.builder_name + "\"";
+        if (args.modification_name) {
+            line += ",\"modification\":\"" + *args.modification_name + "\"";
+        }
+        line += ",\"rows\":" + std::to_string(args.maze.odd_rows)
+                + ",\"cols\":" + std::to_string(args.maze.odd_cols)
+                + ",\"build_seconds\":" + std::to_string(result.build_seconds);
+        if (result.solve_seconds) {
+            line += ",\"solve_seconds\":"
+                    + std::to_string(*result.solve_seconds)
+                    + ",\"solution_length\":"
+                    + (result.solution_length
+                           ? std::to_string(*result.solution_length)
+                           : std::string{"null"});
+        }
+        if (result.file) {
+            line += ",\"file\":\"" + *result.file + "\"";
+        }
+        line += "}\n";
+        std::scoped_lock const lock(lock_);
+        out_ << line << std::flush;
+    }
+
+  private:
+    std::mutex lock_{};
+    std::ostream &out_;
+};
+
+Run_args read_args(std::span<char *> args);
+uint64_t parse_number(std::string_view flag, std::string_view arg);
+uint64_t parse_odd_dimension(std::string_view flag, std::string_view arg);
+void build_mazes(Run_args const &args, uint64_t base_seed,
+                 std::atomic_uint64_t &next_maze, Result_log &log);
+Maze_result build_one(Run_args const &args, uint64_t index, uint64_t seed);
+void write_maze_file(Maze::Maze const &maze,
+                     std::filesystem::path const &path);
+std::string maze_file_name(uint64_t index, uint64_t count);
+void print_usage();
+
+} // namespace
+
+int
+main(int argc, char **argv) {
+    Run_args const args
+        = read_args(std::span(argv, static_cast<uint64_t>(argc)));
+    // Nobody watches a batch so builders skip drawing what they made.
+    Printer::set_headless(true);
+    uint64_t const base_seed
+        = args.seed.value_or((static_cast<uint64_t>(std::random_device{}())
+                              << 32U)
+                             | std::random_device{}());
+
+    std::ofstream results;
+    if (args.out_dir) {
+        std::error_code err;
+        std::filesystem::create_directories(*args.out_dir, err);
+        if (err) {
+            std::cerr << "Could not create " << args.out_dir->string() << ": "
+                      << err.message() << "\n";
+            std::exit(1);
+        }
+        results.open(*args.out_dir / "results.jsonl",
+                     std::ios::out | std::ios::trunc);
+        if (!results) {
+            std::cerr << "Could not open "
+                      << (*args.out_dir / "results.jsonl").string() << "\n";
+            std::exit(1);
+        }
+    }
+    Result_log log(args.out_dir ? static_cast<std::ostream &>(results)
+                                : std::cout);
+
+    uint64_t const workers = std::clamp(args.workers, uint64_t{1}, args.count);
+    std::atomic_uint64_t next_maze{0};
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (uint64_t i = 0; i < workers; ++i) {
+        threads.emplace_back(build_mazes, std::cref(args), base_seed,
+                             std::ref(next_maze), std::ref(log));
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return 0;
+}
+
+namespace {
+
+void
+build_mazes(Run_args const &args, uint64_t base_seed,
+            std::atomic_uint64_t &next_maze, Result_log &log) {
+    for (uint64_t i = next_maze.fetch_add(1, std::memory_order_relaxed);
+         i < args.count;
+         i = next_maze.fetch_add(1, std::memory_order_relaxed)) {
+        log.write(args, build_one(args, i, base_seed + i));
+    }
+}
+
+// Solutions run from the top left square to the bottom right one with a
+// shortest path search that only reads the maze.
+Maze_result
+build_one(Run_args const &args, uint64_t index, uint64_t seed) {
+    Maze_result result{index, seed, 0.0, {}, {}, {}};
+    Maze::Maze maze(args.maze);
+    Maze::seed_thread(seed);
+    auto const build_start = std::chrono::steady_clock::now();
+    args.builder(maze);
+    if (args.modder) {
+        (*args.modder)(maze);
+    }
+    auto const build_end = std::chrono::steady_clock::now();
+    result.build_seconds
+        = std::chrono::duration<double>(build_end - build_start).count();
+    if (args.solve) {
+        std::vector<Batch::Query> const query{
+            {{1, 1}, {maze.row_size() - 2, maze.col_size() - 2}}};
+        std::vector<Batch::Query_result> const solved
+            = Batch::solve(maze, query, {.keep_paths = false, .workers = 1});
+        result.solve_seconds = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - build_end)
+                                   .count();
+        if (solved.front().path_len != Batch::no_path) {
+            result.solution_length = solved.front().path_len;
+        }
+    }
+    if (args.out_dir) {
+        result.file = maze_file_name(index, args.count);
+        write_maze_file(maze, *args.out_dir / *result.file);
+    }
+    return result;
+}
+
+void
+append_le(std::string &out, uint64_t value, uint64_t bytes) {
+    for (uint64_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8U * i)) & 0xFFU));
+    }
+}
+
+void
+write_maze_file(Maze::Maze const &maze, std::filesystem::path const &path) {
+    std::ofstream file(path,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Could not open " << path.string() << " for writing.\n";
+        std::exit(1);
+    }
+    std::string bytes = "MAZE";
+    append_le(bytes, static_cast<uint64_t>(maze.row_size()), 4);
+    append_le(bytes, static_cast<uint64_t>(maze.col_size()), 4);
+    for (int row = 0; row < maze.row_size(); ++row) {
+        for (Maze::Square const &square : maze[row]) {
+            append_le(bytes, square.load() & (Maze::path_bit | Maze::wall_mask),
+                      2);
+        }
+        // A row at a time keeps memory flat for the largest mazes.
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        bytes.clear();
+    }
+    if (!file.flush()) {
+        std::cerr << "Could not finish writing " << path.string() << ".\n";
+        std::exit(1);
+    }
+}
+
+// Zero padded to the width of the largest index so files sort in order.
+std::string
+maze_file_name(uint64_t index, uint64_t count) {
+    std::string const last = std::to_string(count - 1);
+    std::string number = std::to_string(index);
+    number.insert(0, last.size() - number.size(), '0');
+    return "maze_" + number + ".bin";
+}
+
+Run_args
+read_args(std::span<char *> args) {
+    std::unordered_map<std::string_view, Build_function> const builder_table{
+        {"rdfs", Recursive_backtracker::generate_maze},
+        {"wilson", Wilson_path_carver::generate_maze},
+        {"wilson-walls", Wilson_wall_adder::generate_maze},
+        {"fractal", Recursive_subdivision::generate_maze},
+        {"kruskal", Kruskal::generate_maze},
+        {"eller", Eller::generate_maze},
+        {"prim", Prim::generate_maze},
+        {"grid", Grid::generate_maze},
+        {"arena", Arena::generate_maze},
+    };
+    std::unordered_map<std::string_view, Build_function> const
+        modification_table{
+            {"cross", Mods::add_cross},
+            {"x", Mods::add_x},
+        };
+    Run_args run{};
+    for (uint64_t i = 1; i < args.size(); ++i) {
+        std::string_view const flag = args[i];
+        if (flag == "-h") {
+            print_usage();
+            std::exit(0);
+        }
+        if (flag == "-solve") {
+            run.solve = true;
+            continue;
+        }
+        if (i + 1 == args.size()) {
+            std::cerr << "Flag " << flag << " needs an argument.\n";
+            print_usage();
+            std::exit(1);
+        }
+        std::string_view const arg = args[++i];
+        if (flag == "-n") {
+            run.count = parse_number(flag, arg);
+        } else if (flag == "-r") {
+            run.maze.odd_rows = parse_odd_dimension(flag, arg);
+        } else if (flag == "-c") {
+            run.maze.odd_cols = parse_odd_dimension(flag, arg);
+        } else if (flag == "-b") {
+            auto const found = builder_table.find(arg);
+            if (found == builder_table.end()) {
+                std::cerr << "Invalid builder: " << arg << "\n";
+                print_usage();
+                std::exit(1);
+            }
+            run.builder_name = arg;
+            run.builder = found->second;
+        } else if (flag == "-m") {
+            auto const found = modification_table.find(arg);
+            if (found == modification_table.end()) {
+                std::cerr << "Invalid modification: " << arg << "\n";
+                print_usage();
+                std::exit(1);
+            }
+            run.modification_name = std::string{arg};
+            run.modder = found->second;
+        } else if (flag == "-seed") {
+            run.seed = parse_number(flag, arg);
+        } else if (flag == "-o") {
+            run.out_dir = std::filesystem::path{arg};
+        } else if (flag == "-j") {
+            run.workers = parse_number(flag, arg);
+        } else {
+            std::cerr << "Invalid argument flag: " << flag << "\n";
+            print_usage();
+            std::exit(1);
+        }
+    }
+    if (!run.count || !run.workers) {
+        std::cerr << "Need at least one maze and one worker.\n";
+        print_usage();
+        std::exit(1);
+    }
+    return run;
+}
+
+uint64_t
+parse_number(std::string_view flag, std::string_view arg) {
+    uint64_t value = 0;
+    auto const [end, err]
+        = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (err != std::errc{} || end != arg.data() + arg.size()) {
+        std::cerr << "Flag was: " << flag << "\n";
+        std::cerr << "Argument was: " << arg << "\n";
+        print_usage();
+        std::exit(1);
+    }
+    return value;
+}
+
+// The same rules as run_maze. Even sizes round up and the smallest is 7.
+uint64_t
+parse_odd_dimension(std::string_view flag, std::string_view arg) {
+    uint64_t size = parse_number(flag, arg);
+    if (size % 2 == 0) {
+        ++size;
+    }
+    if (size < 7) {
+        std::cerr << "Flag was: " << flag << "\n";
+        std::cerr << "Argument was: " << arg << "\n";
+        print_usage();
+        std::exit(1);
+    }
+    return size;
+}
+
+void
+print_usage() {
+    std::cout
+        << "Usage: batch [-n count] [-r rows] [-c cols] [-b builder]\n"
+           "             [-m modification] [-seed seed] [-solve] [-o dir]\n"
+           "             [-j workers]\n"
+           "  -n     How many mazes to build. Default 1.\n"
+           "  -r     Rows in every maze. Odd, at least 7. Default 31.\n"
+           "  -c     Columns in every maze. Odd, at least 7. Default 111.\n"
+           "  -b     Builder: rdfs, wilson, wilson-walls, fractal, kruskal,\n"
+           "         eller, prim, grid, or arena. Default rdfs.\n"
+           "  -m     Modification: cross or x.\n"
+           "  -seed  Maze i is built from seed + i. Random if omitted.\n"
+           "  -solve Report the shortest path from the top left square to\n"
+           "         the bottom right one.\n"
+           "  -o     Directory for one binary file per maze and\n"
+           "         results.jsonl. Without it results go to standard\n"
+           "         output.\n"
+           "  -j     Worker threads. Defaults to every core.\n"
+           "  -h     Print this message.\n";
+}
+
+} // namespace
@@ -0,0 +1,539 @@
+/// File: bench.cc
+/// --------------
+/// Times every builder, the hunt, gather, and corners modes of the dfs, rdfs,
+/// floodfs, bfs, stealdfs, and stealbfs solvers, the distance and runs
+/// painters with nothing drawn, and a flood of the maze through each queue.
+/// Each case runs at every size and thread count asked for. A thread count
+/// of T runs T copies of the case at once, one per thread, which shows how a
+/// case scales when it shares the machine.
+/// The steal solvers, painters, and queue floods split one job among a team
+/// of workers, so they also run at every worker count asked for, which shows
+/// how one copy scales on its own. The racing solvers keep their four
+/// threads.
+///
+/// Every copy is seeded from the same fixed seed so the mazes, starts, and
+/// finishes match from one commit to the next. One JSON object per line
+/// reports the median and 95th percentile time of a case over its repetitions
+/// in nanoseconds and its throughput in squares per second at the median.
+import labyrinth;
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Maze_function = std::function<void(Maze::Maze &)>;
+
+struct Bench_case {
+    std::string_view kind;
+    std::string_view name;
+    Maze_function run;
+    // Splits its work among Maze::team_workers threads.
+    bool team{false};
+};
+
+struct Size {
+    uint64_t rows;
+    uint64_t cols;
+};
+
+struct Bench_args {
+    std::vector<Size> sizes{
+        {31, 111}, {101, 301}, {501, 501}, {2001, 2001}, {8001, 8001}};
+    // One copy and then one per core unless told otherwise.
+    std::vector<uint64_t> threads{};
+    // The same for the workers in one copy of a team case.
+    std::vector<uint64_t> workers{};
+    uint64_t reps{5};
+    uint64_t seed{1};
+    std::string_view only{};
+    Maze::Visit_marks marks{Maze::Visit_marks::bits};
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Timing {
+    uint64_t median_ns;
+    uint64_t p95_ns;
+};
+
+struct Copy_span {
+    Clock::time_point begin;
+    Clock::time_point end;
+};
+
+// Solvers and painters run on one maze per size built by this builder.
+constexpr std::string_view solved_builder = "rdfs";
+
+// The queue cases flood every open square from the top left corner.
+constexpr uint64_t flood_threads = 4;
+constexpr Maze::Point flood_start{1, 1};
+
+// Team cases run once per worker count and everything else runs once.
+constexpr std::array<uint64_t, 1> own_workers{0};
+
+std::vector<Bench_case> const &bench_cases();
+void flood_my_queue(Maze::Maze &maze);
+void flood_bounded(Maze::Maze &maze);
+void flood_segmented(Maze::Maze &maze);
+Bench_args read_args(std::span<char *> args);
+std::vector<uint64_t> parse_list(std::string_view flag, std::string_view arg);
+std::vector<Size> parse_sizes(std::string_view arg);
+uint64_t parse_number(std::string_view flag, std::string_view arg);
+uint64_t flood_workers();
+Timing time_case(Bench_args const &args, Bench_case const &c,
+                 Size const &size, uint64_t threads);
+void report(std::ostream &out, Bench_args const &args, Bench_case const &c,
+            Size const &size, uint64_t threads, uint64_t workers,
+            Timing const &t);
+void print_usage();
+
+} // namespace
+
+int
+main(int argc, char **argv) {
+    Bench_args const args
+        = read_args(std::span(argv, static_cast<uint64_t>(argc)));
+    Printer::set_headless(true);
+    Maze::set_visit_marks(args.marks);
+    for (Size const &size : args.sizes) {
+        for (uint64_t const threads : args.threads) {
+            for (Bench_case const &c : bench_cases()) {
+                if (!args.only.empty() && args.only != c.kind) {
+                    continue;
+                }
+                for (uint64_t const workers :
+                     c.team ? std::span<uint64_t const>(args.workers)
+                            : std::span<uint64_t const>(own_workers)) {
+                    std::cerr << size.rows << "x" << size.cols << " threads "
+                              << threads << " workers " << workers << " "
+                              << c.kind << " " << c.name << "\n";
+                    Maze::set_team_workers(workers);
+                    report(std::cout, args, c, size, threads, workers,
+                           time_case(args, c, size, threads));
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+namespace {
+
+std::vector<Bench_case> const &
+bench_cases() {
+    static std::vector<Bench_case> const cases{
+        {"builder", "rdfs", Recursive_backtracker::generate_maze},
+        {"builder", "wilson", Wilson_path_carver::generate_maze},
+        {"builder", "wilson-walls", Wilson_wall_adder::generate_maze},
+        {"builder", "fractal", Recursive_subdivision::generate_maze},
+        {"builder", "kruskal", Kruskal::generate_maze},
+        {"builder", "eller", Eller::generate_maze},
+        {"builder", "prim", Prim::generate_maze},
+        {"builder", "grid", Grid::generate_maze},
+        {"builder", "arena", Arena::generate_maze},
+        {"solver", "dfs-hunt", Dfs::hunt},
+        {"solver", "dfs-gather", Dfs::gather},
+        {"solver", "dfs-corners", Dfs::corners},
+        {"solver", "rdfs-hunt", Rdfs::hunt},
+        {"solver", "rdfs-gather", Rdfs::gather},
+        {"solver", "rdfs-corners", Rdfs::corners},
+        {"solver", "floodfs-hunt", Floodfs::hunt},
+        {"solver", "floodfs-gather", Floodfs::gather},
+        {"solver", "floodfs-corners", Floodfs::corners},
+        {"solver", "bfs-hunt", Bfs::hunt},
+        {"solver", "bfs-gather", Bfs::gather},
+        {"solver", "bfs-corners", Bfs::corners},
+        {"solver", "stealdfs-hunt", Steal_dfs::hunt, true},
+        {"solver", "stealdfs-gather", Steal_dfs::gather, true},
+        {"solver", "stealdfs-corners", Steal_dfs::corners, true},
+        {"solver", "stealbfs-hunt", Steal_bfs::hunt, true},
+        {"solver", "stealbfs-gather", Steal_bfs::gather, true},
+        {"solver", "stealbfs-corners", Steal_bfs::corners, true},
+        {"painter", "distance", Distance::paint_distance_from_center, true},
+        {"painter", "runs", Runs::paint_runs, true},
+        {"queue", "my_queue-flood", flood_my_queue, true},
+        {"queue", "bounded-flood", flood_bounded, true},
+        {"queue", "segmented-flood", flood_segmented, true},
+    };
+    return cases;
+}
+
+Maze_function const &
+builder_named(std::string_view name) {
+    for (Bench_case const &c : bench_cases()) {
+        if (c.kind == "builder" && c.name == name) {
+            return c.run;
+        }
+    }
+    std::cerr << "No builder named " << name << ".\n";
+    std::abort();
+}
+
+/// Each open square is handed out once to whichever thread claims it first.
+/// The maze is only read so nothing needs clearing between repetitions.
+class Flood {
+  public:
+    explicit Flood(Maze::Maze const &maze)
+        : maze_(maze), claimed_(std::make_unique<std::atomic_bool[]>(
+                           static_cast<uint64_t>(maze.row_size())
+                           * static_cast<uint64_t>(maze.col_size()))) {
+        claim(flood_start);
+    }
+
+    template <class Push>
+    void
+    expand(Maze::Point const &cur, Push push) {
+        for (Maze::Point const &d : Maze::dirs) {
+            Maze::Point const next = {cur.row + d.row, cur.col + d.col};
+            if ((maze_[next.row][next.col] & Maze::path_bit) && claim(next)) {
+                push(next);
+            }
+        }
+    }
+
+  private:
+    Maze::Maze const &maze_;
+    std::unique_ptr<std::atomic_bool[]> claimed_;
+
+    bool
+    claim(Maze::Point const &p) {
+        uint64_t const cell = static_cast<uint64_t>(p.row)
+                                  * static_cast<uint64_t>(maze_.col_size())
+                              + static_cast<uint64_t>(p.col);
+        return !claimed_[cell].exchange(true, std::memory_order_relaxed);
+    }
+};
+
+uint64_t
+flood_workers() {
+    uint64_t const workers = Maze::team_workers();
+    return workers ? workers : flood_threads;
+}
+
+/// The way the bfs solvers use My_queue today. Every thread starts from the
+/// same square with a queue of its own and keeps whatever it claims.
+void
+flood_my_queue(Maze::Maze &maze) {
+    Flood flood(maze);
+    std::vector<std::thread> threads;
+    threads.reserve(flood_workers());
+    for (uint64_t t = 0; t < flood_workers(); ++t) {
+        threads.emplace_back([&flood]() {
+            My_queue<Maze::Point> bfs;
+            bfs.push(flood_start);
+            while (!bfs.empty()) {
+                Maze::Point const cur = bfs.front();
+                bfs.pop();
+                flood.expand(cur, [&bfs](Maze::Point const &p) {
+                    bfs.push(p);
+                });
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+}
+
+/// Every thread pops from and pushes to one shared queue. Squares are counted
+/// as pending from their push until their neighbors have been pushed, so an
+/// empty queue with nothing pending means the flood is over.
+template <class Queue, class Push>
+void
+flood_shared(Maze::Maze &maze, Queue &queue, Push push) {
+    Flood flood(maze);
+    std::atomic_uint64_t pending{1};
+    push(queue, flood_start);
+    std::vector<std::thread> threads;
+    threads.reserve(flood_workers());
+    for (uint64_t t = 0; t < flood_workers(); ++t) {
+        threads.emplace_back([&]() {
+            for (;;) {
+                if (auto const cur = queue.try_pop()) {
+                    flood.expand(*cur, [&](Maze::Point const &p) {
+                        pending.fetch_add(1, std::memory_order_relaxed);
+                        push(queue, p);
+                    });
+                    pending.fetch_sub(1, std::memory_order_acq_rel);
+                } else if (!pending.load(std::memory_order_acquire)) {
+                    return;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+}
+
+void
+flood_bounded(Maze::Maze &maze) {
+    Bounded_queue<Maze::Point> queue(static_cast<uint64_t>(maze.row_size())
+                                     * static_cast<uint64_t>(maze.col_size()));
+    flood_shared(maze, queue,
+                 [](Bounded_queue<Maze::Point> &q, Maze::Point const &p) {
+                     if (!q.try_push(p)) {
+                         std::cerr << "Flood queue holds fewer squares than "
+                                      "the maze.\n";
+                         std::abort();
+                     }
+                 });
+}
+
+void
+flood_segmented(Maze::Maze &maze) {
+    Segmented_queue<Maze::Point> queue;
+    flood_shared(maze, queue,
+                 [](Segmented_queue<Maze::Point> &q, Maze::Point const &p) {
+                     q.push(p);
+                 });
+}
+
+/// Every repetition starts the copies together at a barrier and is timed from
+/// the first copy to start until the last one finishes. Builders get
+/// fresh mazes each time. Everything else reuses the same maze with the
+/// marks from the last run cleared, which happens before the clock starts.
+Timing
+time_case(Bench_args const &args, Bench_case const &c, Size const &size,
+          uint64_t threads) {
+    Maze::Maze_args const maze_args{size.rows, size.cols};
+    bool const builds = c.kind == "builder";
+    std::vector<Maze::Maze> mazes;
+    mazes.reserve(threads);
+    for (uint64_t t = 0; t < threads; ++t) {
+        mazes.emplace_back(maze_args);
+        if (!builds) {
+            Maze::seed_thread(args.seed);
+            builder_named(solved_builder)(mazes.back());
+        }
+    }
+    std::vector<uint64_t> times;
+    times.reserve(args.reps);
+    for (uint64_t rep = 0; rep < args.reps; ++rep) {
+        for (Maze::Maze &maze : mazes) {
+            if (builds) {
+                maze = Maze::Maze(maze_args);
+            } else {
+                Maze::clear_solver_marks(maze);
+            }
+        }
+        // Each copy clocks itself. The main thread may not even be scheduled
+        // again before a small case is done.
+        std::vector<Copy_span> spans(threads);
+        std::barrier start(static_cast<std::ptrdiff_t>(threads));
+        std::vector<std::thread> copies;
+        copies.reserve(threads);
+        for (uint64_t t = 0; t < threads; ++t) {
+            copies.emplace_back([&, t]() {
+                Maze::seed_thread(args.seed);
+                start.arrive_and_wait();
+                spans[t].begin = Clock::now();
+                c.run(mazes[t]);
+                spans[t].end = Clock::now();
+            });
+        }
+        for (std::thread &copy : copies) {
+            copy.join();
+        }
+        auto const first = std::ranges::min(spans, {}, &Copy_span::begin);
+        auto const last = std::ranges::max(spans, {}, &Copy_span::end);
+        times.push_back(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                last.end - first.begin)
+                .count()));
+    }
+    std::ranges::sort(times);
+    // Nearest rank so a percentile is always a time that was measured.
+    auto const rank = [&times](double p) {
+        auto const i = static_cast<uint64_t>(
+            std::ceil(p * static_cast<double>(times.size())));
+        return times[std::clamp<uint64_t>(i, 1, times.size()) - 1];
+    };
+    return {rank(0.5), rank(0.95)};
+}
+
+void
+report(std::ostream &out, Bench_args const &args, Bench_case const &c,
+       Size const &size, uint64_t threads, uint64_t workers,
+       Timing const &t) {
+    double const squares
+        = static_cast<double>(size.rows * size.cols * threads);
+    double const seconds
+        = static_cast<double>(std::max<uint64_t>(t.median_ns, 1)) / 1e9;
+    out << "{\"kind\":\"" << c.kind << "\",\"name\":\"" << c.name
+        << "\",\"rows\":" << size.rows << ",\"cols\":" << size.cols
+        << ",\"threads\":" << threads << ",\"reps\":" << args.reps;
+    if (c.team) {
+        out << ",\"workers\":" << workers;
+    }
+    if (c.kind == "solver") {
+        out << ",\"marks\":\""
+            << (args.marks == Maze::Visit_marks::grid ? "grid" : "bits")
+            << "\"";
+    }
+    out << ",\"median_ns\":" << t.median_ns << ",\"p95_ns\":" << t.p95_ns
+        << ",\"squares_per_second\":"
+        << static_cast<uint64_t>(squares / seconds) << "}" << std::endl;
+}
+
+Bench_args
+read_args(std::span<char *> args) {
+    Bench_args bench{};
+    for (uint64_t i = 1; i < args.size(); ++i) {
+        std::string_view const flag = args[i];
+        if (flag == "-h") {
+            print_usage();
+            std::exit(0);
+        }
+        if (i + 1 == args.size()) {
+            std::cerr << "Flag " << flag << " needs an argument.\n";
+            print_usage();
+            std::exit(1);
+        }
+        std::string_view const arg = args[++i];
+        if (flag == "-sizes") {
+            bench.sizes = parse_sizes(arg);
+        } else if (flag == "-threads") {
+            bench.threads = parse_list(flag, arg);
+        } else if (flag == "-workers") {
+            bench.workers = parse_list(flag, arg);
+        } else if (flag == "-reps") {
+            bench.reps = parse_number(flag, arg);
+        } else if (flag == "-seed") {
+            bench.seed = parse_number(flag, arg);
+        } else if (flag == "-only") {
+            if (arg != "builder" && arg != "solver" && arg != "painter"
+                && arg != "queue") {
+                std::cerr << "Invalid kind: " << arg << "\n";
+                print_usage();
+                std::exit(1);
+            }
+            bench.only = arg;
+        } else if (flag == "-marks") {
+            if (arg != "grid" && arg != "bits") {
+                std::cerr << "Invalid marks: " << arg << "\n";
+                print_usage();
+                std::exit(1);
+            }
+            bench.marks = arg == "grid" ? Maze::Visit_marks::grid
+                                        : Maze::Visit_marks::bits;
+        } else {
+            std::cerr << "Invalid argument flag: " << flag << "\n";
+            print_usage();
+            std::exit(1);
+        }
+    }
+    uint64_t const cores = std::thread::hardware_concurrency();
+    for (std::vector<uint64_t> *axis : {&bench.threads, &bench.workers}) {
+        if (axis->empty()) {
+            axis->push_back(1);
+            if (cores > 1) {
+                axis->push_back(cores);
+            }
+        }
+    }
+    if (!bench.reps || std::ranges::count(bench.threads, 0)
+        || std::ranges::count(bench.workers, 0)) {
+        std::cerr << "Need at least one repetition, thread, and worker.\n";
+        print_usage();
+        std::exit(1);
+    }
+    return bench;
+}
+
+std::vector<uint64_t>
+parse_list(std::string_view flag, std::string_view arg) {
+    std::vector<uint64_t> values;
+    while (!arg.empty()) {
+        uint64_t const comma = std::min(arg.find(','), arg.size());
+        values.push_back(parse_number(flag, arg.substr(0, comma)));
+        arg.remove_prefix(std::min(comma + 1, arg.size()));
+    }
+    return values;
+}
+
+// Sizes are written ROWSxCOLS and follow the run_maze rules, so even sizes
+// round up to odd and nothing is smaller than 7.
+std::vector<Size>
+parse_sizes(std::string_view arg) {
+    std::vector<Size> sizes;
+    while (!arg.empty()) {
+        uint64_t const comma = std::min(arg.find(','), arg.size());
+        std::string_view const size = arg.substr(0, comma);
+        uint64_t const x = size.find('x');
+        if (x == std::string_view::npos) {
+            std::cerr << "Invalid size: " << size << "\n";
+            print_usage();
+            std::exit(1);
+        }
+        Size s{parse_number("-sizes", size.substr(0, x)) | 1U,
+               parse_number("-sizes", size.substr(x + 1)) | 1U};
+        if (s.rows < 7 || s.cols < 7) {
+            std::cerr << "Invalid size: " << size << "\n";
+            print_usage();
+            std::exit(1);
+        }
+        sizes.push_back(s);
+        arg.remove_prefix(std::min(comma + 1, arg.size()));
+    }
+    return sizes;
+}
+
+uint64_t
+parse_number(std::string_view flag, std::string_view arg) {
+    uint64_t value = 0;
+    auto const [end, err]
+        = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (err != std::errc{} || end != arg.data() + arg.size()) {
+        std::cerr << "Flag was: " << flag << "\n";
+        std::cerr << "Argument was: " << arg << "\n";
+        print_usage();
+        std::exit(1);
+    }
+    return value;
+}
+
+void
+print_usage() {
+    std::cout
+        << "Usage: bench [-sizes ROWSxCOLS,...] [-threads T,...]\n"
+           "             [-workers W,...] [-reps N] [-seed S]\n"
+           "             [-only builder|solver|painter|queue]\n"
+           "             [-marks grid|bits]\n"
+           "  -sizes   Maze sizes to sweep. Default\n"
+           "           31x111,101x301,501x501,2001x2001,8001x8001.\n"
+           "  -threads Copies of each case run at once. Default 1 and one\n"
+           "           per core.\n"
+           "  -workers Threads sharing one copy of the steal solvers,\n"
+           "           painters, and queue floods. Default 1 and one per\n"
+           "           core.\n"
+           "  -reps    Repetitions per case. Default 5.\n"
+           "  -seed    Seed for every maze, start, and finish. Default 1.\n"
+           "  -only    Time only builders, solvers, painters, or queue\n"
+           "           floods.\n"
+           "  -marks   Where solver threads mark visited squares. grid sets\n"
+           "           bits in the shared maze and bits keeps a private\n"
+           "           bitmap per thread. Default bits.\n"
+           "  -h       Print this message.\n";
+}
+
+} // namespace
@@ -2,6 +2,7 @@ export module labyrinth:arena;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -12,31 +13,35 @@ void animate_maze(Maze::Maze &maze, Speed::Speed speed);
 
 //////////////////////////////////   Implementation
 
-namespace Arena {
+namespace {
 
+template <class Render_policy>
 void
-generate_maze(Maze::Maze &maze) {
-    Butil::fill_maze_with_walls(maze);
+build(Maze::Maze &maze, Render_policy const &render) {
     for (int row = 1; row < maze.row_size() - 1; row++) {
         for (int col = 1; col < maze.col_size() - 1; col++) {
-            Butil::build_path(maze, {.row = row, .col = col});
+            Butil::build_path(maze, {.row = row, .col = col}, render);
         }
     }
+}
+
+} // namespace
+
+namespace Arena {
+
+void
+generate_maze(Maze::Maze &maze) {
+    Butil::fill_maze_with_walls(maze);
+    build(maze, Render::No_render{});
     Butil::clear_and_flush_grid(maze);
 }
 
 void
 animate_maze(Maze::Maze &maze, Speed::Speed speed) {
     Butil::fill_maze_with_walls(maze);
-    Butil::clear_and_flush_grid(maze);
-    Speed::Speed_unit const animation
-        = Butil::builder_speeds.at(static_cast<int>(speed));
-    for (int row = 1; row < maze.row_size() - 1; row++) {
-        for (int col = 1; col < maze.col_size() - 1; col++) {
-            Butil::carve_path_walls_animated(maze, {.row = row, .col = col},
-                                             animation);
-        }
-    }
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::blank);
+    build(maze, Butil::Terminal_render{
+                    Butil::builder_speeds.at(static_cast<int>(speed))});
 }
 
 } // namespace Arena
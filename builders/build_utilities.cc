@@ -1,13 +1,16 @@
 module;
-#include <chrono>
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
-#include <thread>
+#include <string_view>
 module labyrinth:build_utilities;
 import :maze;
+import :stats;
+import :trace;
 import :speed;
 import :printers;
+import :render;
 
 namespace Butil {
 
@@ -17,56 +20,123 @@ enum class Parity_point : uint8_t {
 };
 
 constexpr std::array<Speed::Speed_unit, 8> builder_speeds
-    = {0, 5000, 2500, 1000, 500, 250, 100, 1};
+    = {0, 3, 7, 17, 33, 67, 167, 16667};
 
 ///////////////////      Cout Printing Functions
 
-void
-print_square(Maze::Maze const &maze, Maze::Point const &p) {
-    Maze::Square const &square = maze[p.row][p.col];
+std::string_view
+square_glyph(Maze::Maze const &maze, Maze::Square_bits square) {
     if (square & Maze::markers_mask) {
         Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
-            (square & Maze::markers_mask).load() >> Maze::marker_shift)};
-        std::cout << Maze::backtracking_symbols.at(mark);
-    } else if (!(square & Maze::path_bit)) {
-        std::cout << maze.wall_style()[(square & Maze::wall_mask).load()];
-    } else if (square & Maze::path_bit) {
-        std::cout << " ";
-    } else {
-        std::cerr << "Printed maze and a square was not categorized.\n";
-        std::abort();
+            (square & Maze::markers_mask) >> Maze::marker_shift)};
+        return Maze::backtracking_symbols.at(mark);
     }
+    if (!(square & Maze::path_bit)) {
+        return maze.wall_style()[square & Maze::wall_mask];
+    }
+    if (square & Maze::path_bit) {
+        return " ";
+    }
+    std::cerr << "Printed maze and a square was not categorized.\n";
+    std::abort();
+}
+
+std::string_view
+square_glyph(Maze::Maze const &maze, Maze::Point const &p) {
+    return square_glyph(maze, maze[p.row][p.col].load());
 }
 
 void
-print_maze(Maze::Maze const &maze) {
+print_square(Maze::Maze const &maze, Maze::Point const &p) {
+    std::cout << square_glyph(maze, p);
+}
+
+// A frame is written once it holds a band, so it never needs more than a band
+// and one row of the widest glyphs, the colored backtracking arrows.
+uint64_t
+frame_bytes(Maze::Maze const &maze) {
+    uint64_t const row_bytes = (static_cast<uint64_t>(maze.col_size()) + 1)
+                               * Maze::from_south_mark.size();
+    return std::min(static_cast<uint64_t>(maze.row_size()) * row_bytes,
+                    Printer::band_bytes + row_bytes)
+           + 16;
+}
+
+void
+append_maze(Printer::Frame &frame, Maze::Maze const &maze) {
     for (int row = 0; row < maze.row_size(); row++) {
         for (int col = 0; col < maze.col_size(); col++) {
-            print_square(maze, {row, col});
+            frame.append(square_glyph(maze, {row, col}));
         }
-        std::cout << "\n";
+        frame.append('\n');
+        frame.write_band();
+    }
+}
+
+void
+print_maze(Maze::Maze const &maze) {
+    if (Printer::headless()) {
+        return;
     }
+    Printer::Frame frame(frame_bytes(maze));
+    append_maze(frame, maze);
+    frame.write_out();
 }
 
 void
 clear_and_flush_grid(Maze::Maze const &maze) {
-    Printer::clear_screen();
-    for (int row = 0; row < maze.row_size(); row++) {
-        for (int col = 0; col < maze.col_size(); col++) {
-            print_square(maze, {row, col});
-        }
-        std::cout << "\n";
+    if (Printer::headless()) {
+        return;
     }
-    std::cout << std::flush;
+    Printer::Frame frame(frame_bytes(maze));
+    frame.clear_screen();
+    append_maze(frame, maze);
+    frame.write_out();
 }
 
+// Every bit square_glyph reads, so the builder bit and anything else a
+// builder sets on the side does not force a redraw.
+constexpr Maze::Square_bits square_glyph_bits
+    = Maze::markers_mask | Maze::path_bit | Maze::wall_mask;
+
+uint32_t
+square_key(Maze::Maze const &maze, Render::Event const &e) {
+    return maze[e.p.row][e.p.col].load() & square_glyph_bits;
+}
+
+void
+write_square(Printer::Frame &frame, Maze::Maze const &maze,
+             Maze::Point const &, uint32_t key) {
+    frame.append(square_glyph(maze, static_cast<Maze::Square_bits>(key)));
+}
+
+// Builders mark nearly every square they pass, so an overview of a build
+// shows the walls coming down rather than where the builder has been.
+Render::Summary
+summarize_square(uint32_t key) {
+    auto const square = static_cast<Maze::Square_bits>(key);
+    return {
+        .wall = !(square & Maze::path_bit),
+        .visited = false,
+        .painted = (square & Maze::markers_mask) != 0,
+    };
+}
+
+constexpr Render::Glyphs wall_glyphs{square_key, write_square,
+                                     summarize_square, 0};
+
 void
 flush_cursor_maze_coordinate(Maze::Maze const &maze, Maze::Point const &p) {
+    if (Render::submit(p)) {
+        return;
+    }
     Printer::set_cursor_position(p);
     print_square(maze, p);
     std::cout << std::flush;
 }
 
+using Terminal_render = Render::Terminal_render<flush_cursor_maze_coordinate>;
+
 void
 print_maze_square(Maze::Maze const &maze, Maze::Point const &p) {
     Maze::Square const &square = maze[p.row][p.col];
@@ -82,6 +152,7 @@ print_maze_square(Maze::Maze const &maze, Maze::Point const &p) {
 
 bool
 can_build_new_square(Maze::Maze const &maze, Maze::Point const &next) {
+    ++Stats::local().neighbor_checks;
     return next.row > 0 && next.row < maze.row_size() - 1 && next.col > 0
            && next.col < maze.col_size() - 1
            && !(maze[next.row][next.col] & Maze::builder_bit);
@@ -89,124 +160,110 @@ can_build_new_square(Maze::Maze const &maze, Maze::Point const &next) {
 
 bool
 has_builder_bit(Maze::Maze const &maze, Maze::Point const &next) {
+    ++Stats::local().neighbor_checks;
     return maze[next.row][next.col].load() & Maze::builder_bit;
 }
 
 bool
 is_square_within_perimeter_walls(Maze::Maze const &maze,
                                  Maze::Point const &next) {
+    ++Stats::local().neighbor_checks;
     return next.row < maze.row_size() - 1 && next.row > 0
            && next.col < maze.col_size() - 1 && next.col > 0;
 }
 
+/// Opens the wall of next that faces a new path square. Open neighbors look
+/// the same either way so an animation does not redraw them.
+template <class Render_policy>
 void
-build_wall_line(Maze::Maze &maze, Maze::Point const &p) {
+open_facing_wall(Maze::Maze &maze, Maze::Point const &next,
+                 Maze::Wall_line facing, Render_policy const &render) {
+    if constexpr (Render_policy::animated) {
+        bool const redraw = !(maze[next.row][next.col] & Maze::path_bit);
+        maze[next.row][next.col] &= ~facing;
+        if (redraw) {
+            render.draw(maze, next);
+        }
+    } else {
+        maze[next.row][next.col] &= ~facing;
+    }
+}
+
+template <class Render_policy>
+void
+build_wall_line(Maze::Maze &maze, Maze::Point const &p,
+                Render_policy const &render) {
+    ++Stats::local().expanded;
     Maze::Wall_line wall{0b0};
     if (p.row - 1 >= 0 && !(maze[p.row - 1][p.col] & Maze::path_bit)) {
         wall |= Maze::north_wall;
         maze[p.row - 1][p.col] |= Maze::south_wall;
+        render.draw(maze, {p.row - 1, p.col});
     }
     if (p.row + 1 < maze.row_size()
         && !(maze[p.row + 1][p.col] & Maze::path_bit)) {
         wall |= Maze::south_wall;
         maze[p.row + 1][p.col] |= Maze::north_wall;
+        render.draw(maze, {p.row + 1, p.col});
     }
     if (p.col - 1 >= 0 && !(maze[p.row][p.col - 1] & Maze::path_bit)) {
         wall |= Maze::west_wall;
         maze[p.row][p.col - 1] |= Maze::east_wall;
+        render.draw(maze, {p.row, p.col - 1});
     }
     if (p.col + 1 < maze.col_size()
         && !(maze[p.row][p.col + 1] & Maze::path_bit)) {
         wall |= Maze::east_wall;
         maze[p.row][p.col + 1] |= Maze::west_wall;
+        render.draw(maze, {p.row, p.col + 1});
     }
     maze[p.row][p.col] |= wall;
     maze[p.row][p.col] |= Maze::builder_bit;
     maze[p.row][p.col] &= ~Maze::path_bit;
+    render.draw(maze, p);
+}
+
+void
+build_wall_line(Maze::Maze &maze, Maze::Point const &p) {
+    build_wall_line(maze, p, Render::No_render{});
 }
 
 void
 build_wall_line_animated(Maze::Maze &maze, Maze::Point const &p,
                          Speed::Speed_unit speed) {
-    Maze::Wall_line wall{0b0};
-    if (p.row - 1 >= 0 && !(maze[p.row - 1][p.col] & Maze::path_bit)) {
-        wall |= Maze::north_wall;
-        maze[p.row - 1][p.col] |= Maze::south_wall;
-        flush_cursor_maze_coordinate(maze, {p.row - 1, p.col});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.row + 1 < maze.row_size()
-        && !(maze[p.row + 1][p.col] & Maze::path_bit)) {
-        wall |= Maze::south_wall;
-        maze[p.row + 1][p.col] |= Maze::north_wall;
-        flush_cursor_maze_coordinate(maze, {p.row + 1, p.col});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.col - 1 >= 0 && !(maze[p.row][p.col - 1] & Maze::path_bit)) {
-        wall |= Maze::west_wall;
-        maze[p.row][p.col - 1] |= Maze::east_wall;
-        flush_cursor_maze_coordinate(maze, {p.row, p.col - 1});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.col + 1 < maze.col_size()
-        && !(maze[p.row][p.col + 1] & Maze::path_bit)) {
-        wall |= Maze::east_wall;
-        maze[p.row][p.col + 1] |= Maze::west_wall;
-        flush_cursor_maze_coordinate(maze, {p.row, p.col + 1});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    maze[p.row][p.col] |= wall;
-    maze[p.row][p.col] |= Maze::builder_bit;
-    maze[p.row][p.col] &= ~Maze::path_bit;
-    flush_cursor_maze_coordinate(maze, p);
-    std::this_thread::sleep_for(std::chrono::microseconds(speed));
+    build_wall_line(maze, p, Terminal_render{speed});
 }
 
+template <class Render_policy>
 void
-build_path(Maze::Maze &maze, Maze::Point const &p) {
+build_path(Maze::Maze &maze, Maze::Point const &p,
+           Render_policy const &render) {
+    ++Stats::local().expanded;
+    maze[p.row][p.col] |= Maze::path_bit;
+    render.draw(maze, p);
     if (p.row - 1 >= 0) {
-        maze[p.row - 1][p.col] &= ~Maze::south_wall;
+        open_facing_wall(maze, {p.row - 1, p.col}, Maze::south_wall, render);
     }
     if (p.row + 1 < maze.row_size()) {
-        maze[p.row + 1][p.col] &= ~Maze::north_wall;
+        open_facing_wall(maze, {p.row + 1, p.col}, Maze::north_wall, render);
     }
     if (p.col - 1 >= 0) {
-        maze[p.row][p.col - 1] &= ~Maze::east_wall;
+        open_facing_wall(maze, {p.row, p.col - 1}, Maze::east_wall, render);
     }
     if (p.col + 1 < maze.col_size()) {
-        maze[p.row][p.col + 1] &= ~Maze::west_wall;
+        open_facing_wall(maze, {p.row, p.col + 1}, Maze::west_wall, render);
     }
-    maze[p.row][p.col] |= Maze::path_bit;
+}
+
+void
+build_path(Maze::Maze &maze, Maze::Point const &p) {
+    build_path(maze, p, Render::No_render{});
 }
 
 void
 build_path_animated(Maze::Maze &maze, Maze::Point const &p,
                     Speed::Speed_unit speed) {
-    maze[p.row][p.col] |= Maze::path_bit;
-    flush_cursor_maze_coordinate(maze, p);
-    std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    if (p.row - 1 >= 0 && !(maze[p.row - 1][p.col] & Maze::path_bit)) {
-        maze[p.row - 1][p.col] &= ~Maze::south_wall;
-        flush_cursor_maze_coordinate(maze, {p.row - 1, p.col});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.row + 1 < maze.row_size()
-        && !(maze[p.row + 1][p.col] & Maze::path_bit)) {
-        maze[p.row + 1][p.col] &= ~Maze::north_wall;
-        flush_cursor_maze_coordinate(maze, {p.row + 1, p.col});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.col - 1 >= 0 && !(maze[p.row][p.col - 1] & Maze::path_bit)) {
-        maze[p.row][p.col - 1] &= ~Maze::east_wall;
-        flush_cursor_maze_coordinate(maze, {p.row, p.col - 1});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.col + 1 < maze.col_size()
-        && !(maze[p.row][p.col + 1] & Maze::path_bit)) {
-        maze[p.row][p.col + 1] &= ~Maze::west_wall;
-        flush_cursor_maze_coordinate(maze, {p.row, p.col + 1});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
+    build_path(maze, p, Terminal_render{speed});
 }
 
 void
@@ -223,45 +280,65 @@ clear_for_wall_adders(Maze::Maze &maze) {
     }
 }
 
+Maze::Point
+wall_between(Maze::Point const &cur, Maze::Point const &next) {
+    Maze::Point wall = cur;
+    if (next.row < cur.row) {
+        wall.row--;
+    } else if (next.row > cur.row) {
+        wall.row++;
+    } else if (next.col < cur.col) {
+        wall.col--;
+    } else if (next.col > cur.col) {
+        wall.col++;
+    } else {
+        std::cerr << "Wall break error. Step through wall didn't work\n";
+    }
+    return wall;
+}
+
+/// Marks next with the direction the walk came from. An animation marks the
+/// wall square between them too so the walk shows as one unbroken line.
+template <class Render_policy>
+void
+mark_step(Maze::Maze &maze, Maze::Point const &cur, Maze::Point const &wall,
+          Maze::Point const &next) {
+    Maze::Backtrack_marker from{0b0};
+    if (next.row < cur.row) {
+        from = Maze::from_south;
+    } else if (next.row > cur.row) {
+        from = Maze::from_north;
+    } else if (next.col < cur.col) {
+        from = Maze::from_east;
+    } else if (next.col > cur.col) {
+        from = Maze::from_west;
+    }
+    maze[next.row][next.col] |= from;
+    if constexpr (Render_policy::animated) {
+        maze[wall.row][wall.col] |= from;
+    }
+}
+
+template <class Render_policy>
+void
+mark_origin(Maze::Maze &maze, Maze::Point const &walk, Maze::Point const &next,
+            Render_policy const &render) {
+    Maze::Point const wall = wall_between(walk, next);
+    mark_step<Render_policy>(maze, walk, wall, next);
+    render.draw(maze, wall);
+    render.draw(maze, next);
+}
+
 void
 mark_origin(Maze::Maze &maze, Maze::Point const &walk,
             Maze::Point const &next) {
-    if (next.row > walk.row) {
-        maze[next.row][next.col] |= Maze::from_north;
-    } else if (next.row < walk.row) {
-        maze[next.row][next.col] |= Maze::from_south;
-    } else if (next.col < walk.col) {
-        maze[next.row][next.col] |= Maze::from_east;
-    } else if (next.col > walk.col) {
-        maze[next.row][next.col] |= Maze::from_west;
-    }
+    mark_origin(maze, walk, next, Render::No_render{});
 }
 
 void
 mark_origin_animated(Maze::Maze &maze, Maze::Point const &walk,
                      Maze::Point const &next, Speed::Speed_unit speed) {
-    Maze::Point wall = walk;
-    if (next.row > walk.row) {
-        wall.row++;
-        maze[wall.row][wall.col] |= Maze::from_north;
-        maze[next.row][next.col] |= Maze::from_north;
-    } else if (next.row < walk.row) {
-        wall.row--;
-        maze[wall.row][wall.col] |= Maze::from_south;
-        maze[next.row][next.col] |= Maze::from_south;
-    } else if (next.col < walk.col) {
-        wall.col--;
-        maze[wall.row][wall.col] |= Maze::from_east;
-        maze[next.row][next.col] |= Maze::from_east;
-    } else if (next.col > walk.col) {
-        wall.col++;
-        maze[wall.row][wall.col] |= Maze::from_west;
-        maze[next.row][next.col] |= Maze::from_west;
-    }
-    flush_cursor_maze_coordinate(maze, wall);
-    std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    flush_cursor_maze_coordinate(maze, next);
-    std::this_thread::sleep_for(std::chrono::microseconds(speed));
+    mark_origin(maze, walk, next, Terminal_render{speed});
 }
 
 /* * * * * * * * * Path Carvers * * * * * * * */
@@ -312,6 +389,7 @@ build_wall_carefully(Maze::Maze &maze, Maze::Point const &p) {
 
 void
 fill_maze_with_walls(Maze::Maze &maze) {
+    Trace::Scope const trace("fill walls");
     for (int row = 0; row < maze.row_size(); row++) {
         for (int col = 0; col < maze.col_size(); col++) {
             build_wall(maze, {row, col});
@@ -321,6 +399,7 @@ fill_maze_with_walls(Maze::Maze &maze) {
 
 void
 fill_maze_with_walls_animated(Maze::Maze &maze) {
+    Trace::Scope const trace("fill walls");
     Printer::clear_screen();
     for (int row = 0; row < maze.row_size(); row++) {
         for (int col = 0; col < maze.col_size(); col++) {
@@ -329,154 +408,95 @@ fill_maze_with_walls_animated(Maze::Maze &maze) {
     }
 }
 
+template <class Render_policy>
 void
-carve_path_walls(Maze::Maze &maze, Maze::Point const &p) {
-    maze[p.row][p.col] |= Maze::path_bit;
-    if (p.row - 1 >= 0) {
-        maze[p.row - 1][p.col] &= ~Maze::south_wall;
-    }
-    if (p.row + 1 < maze.row_size()) {
-        maze[p.row + 1][p.col] &= ~Maze::north_wall;
-    }
-    if (p.col - 1 >= 0) {
-        maze[p.row][p.col - 1] &= ~Maze::east_wall;
-    }
-    if (p.col + 1 < maze.col_size()) {
-        maze[p.row][p.col + 1] &= ~Maze::west_wall;
-    }
+carve_path_walls(Maze::Maze &maze, Maze::Point const &p,
+                 Render_policy const &render) {
+    build_path(maze, p, render);
     maze[p.row][p.col] |= Maze::builder_bit;
 }
 
-// The animated version tries to save cursor movements if they are not
-// necessary.
+void
+carve_path_walls(Maze::Maze &maze, Maze::Point const &p) {
+    carve_path_walls(maze, p, Render::No_render{});
+}
+
 void
 carve_path_walls_animated(Maze::Maze &maze, Maze::Point const &p,
                           Speed::Speed_unit speed) {
-    maze[p.row][p.col] |= Maze::path_bit;
-    flush_cursor_maze_coordinate(maze, p);
-    std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    if (p.row - 1 >= 0 && !(maze[p.row - 1][p.col] & Maze::path_bit)) {
-        maze[p.row - 1][p.col] &= ~Maze::south_wall;
-        flush_cursor_maze_coordinate(maze, {p.row - 1, p.col});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.row + 1 < maze.row_size()
-        && !(maze[p.row + 1][p.col] & Maze::path_bit)) {
-        maze[p.row + 1][p.col] &= ~Maze::north_wall;
-        flush_cursor_maze_coordinate(maze, {p.row + 1, p.col});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.col - 1 >= 0 && !(maze[p.row][p.col - 1] & Maze::path_bit)) {
-        maze[p.row][p.col - 1] &= ~Maze::east_wall;
-        flush_cursor_maze_coordinate(maze, {p.row, p.col - 1});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    if (p.col + 1 < maze.col_size()
-        && !(maze[p.row][p.col + 1] & Maze::path_bit)) {
-        maze[p.row][p.col + 1] &= ~Maze::west_wall;
-        flush_cursor_maze_coordinate(maze, {p.row, p.col + 1});
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-    }
-    maze[p.row][p.col] |= Maze::builder_bit;
+    carve_path_walls(maze, p, Terminal_render{speed});
+}
+
+template <class Render_policy>
+void
+carve_path_markings(Maze::Maze &maze, Maze::Point const &cur,
+                    Maze::Point const &next, Render_policy const &render) {
+    Maze::Point const wall = wall_between(cur, next);
+    mark_step<Render_policy>(maze, cur, wall, next);
+    carve_path_walls(maze, cur, render);
+    carve_path_walls(maze, wall, render);
+    carve_path_walls(maze, next, render);
 }
 
 void
 carve_path_markings(Maze::Maze &maze, Maze::Point const &cur,
                     Maze::Point const &next) {
-    Maze::Point wall = cur;
-    if (next.row < cur.row) {
-        wall.row--;
-        maze[next.row][next.col] |= Maze::from_south;
-    } else if (next.row > cur.row) {
-        wall.row++;
-        maze[next.row][next.col] |= Maze::from_north;
-    } else if (next.col < cur.col) {
-        wall.col--;
-        maze[next.row][next.col] |= Maze::from_east;
-    } else if (next.col > cur.col) {
-        wall.col++;
-        maze[next.row][next.col] |= Maze::from_west;
-    } else {
-        std::cerr << "Wall break error. Step through wall didn't work\n";
-    }
-    carve_path_walls(maze, cur);
-    carve_path_walls(maze, next);
-    carve_path_walls(maze, wall);
+    carve_path_markings(maze, cur, next, Render::No_render{});
 }
 
 void
 carve_path_markings_animated(Maze::Maze &maze, Maze::Point const &cur,
                              Maze::Point const &next, Speed::Speed_unit speed) {
-    Maze::Point wall = cur;
-    if (next.row < cur.row) {
-        wall.row--;
-        maze[wall.row][wall.col] |= Maze::from_south;
-        maze[next.row][next.col] |= Maze::from_south;
-    } else if (next.row > cur.row) {
-        wall.row++;
-        maze[wall.row][wall.col] |= Maze::from_north;
-        maze[next.row][next.col] |= Maze::from_north;
-    } else if (next.col < cur.col) {
-        wall.col--;
-        maze[wall.row][wall.col] |= Maze::from_east;
-        maze[next.row][next.col] |= Maze::from_east;
-    } else if (next.col > cur.col) {
-        wall.col++;
-        maze[wall.row][wall.col] |= Maze::from_west;
-        maze[next.row][next.col] |= Maze::from_west;
-    } else {
-        std::cerr << "Wall break error. Step through wall didn't work\n";
-    }
-    carve_path_walls_animated(maze, cur, speed);
-    carve_path_walls_animated(maze, wall, speed);
-    carve_path_walls_animated(maze, next, speed);
+    carve_path_markings(maze, cur, next, Terminal_render{speed});
+}
+
+template <class Render_policy>
+void
+join_squares(Maze::Maze &maze, Maze::Point const &cur, Maze::Point const &next,
+             Render_policy const &render) {
+    Maze::Point const wall = wall_between(cur, next);
+    carve_path_walls(maze, cur, render);
+    carve_path_walls(maze, wall, render);
+    carve_path_walls(maze, next, render);
 }
 
 void
 join_squares(Maze::Maze &maze, Maze::Point const &cur,
              Maze::Point const &next) {
-    Maze::Point wall = cur;
-    build_path(maze, cur);
-    maze[cur.row][cur.col] |= Maze::builder_bit;
-    if (next.row < cur.row) {
-        wall.row--;
-    } else if (next.row > cur.row) {
-        wall.row++;
-    } else if (next.col < cur.col) {
-        wall.col--;
-    } else if (next.col > cur.col) {
-        wall.col++;
-    } else {
-        std::cerr << "Wall break error. Step through wall didn't work\n";
-    }
-    build_path(maze, wall);
-    maze[wall.row][wall.col] |= Maze::builder_bit;
-    build_path(maze, next);
-    maze[next.row][next.col] |= Maze::builder_bit;
+    join_squares(maze, cur, next, Render::No_render{});
 }
 
 void
 join_squares_animated(Maze::Maze &maze, Maze::Point const &cur,
                       Maze::Point const &next, Speed::Speed_unit speed) {
-    Maze::Point wall = cur;
-    if (next.row < cur.row) {
-        wall.row--;
-    } else if (next.row > cur.row) {
-        wall.row++;
-    } else if (next.col < cur.col) {
-        wall.col--;
-    } else if (next.col > cur.col) {
-        wall.col++;
-    } else {
-        std::cerr << "Wall break error. Step through wall didn't work\n";
+    join_squares(maze, cur, next, Terminal_render{speed});
+}
+
+/// An X is hard to notice and might miss breaking wall lines so each line is
+/// five squares wide.
+template <class Render_policy>
+void
+widen_slope(Maze::Maze &maze, Maze::Point const &p,
+            Render_policy const &render) {
+    build_path(maze, p, render);
+    if (p.col + 1 < maze.col_size() - 2) {
+        build_path(maze, {p.row, p.col + 1}, render);
+    }
+    if (p.col - 1 > 1) {
+        build_path(maze, {p.row, p.col - 1}, render);
+    }
+    if (p.col + 2 < maze.col_size() - 2) {
+        build_path(maze, {p.row, p.col + 2}, render);
+    }
+    if (p.col - 2 > 1) {
+        build_path(maze, {p.row, p.col - 2}, render);
     }
-    carve_path_walls_animated(maze, cur, speed);
-    carve_path_walls_animated(maze, wall, speed);
-    carve_path_walls_animated(maze, next, speed);
 }
 
+template <class Render_policy>
 void
-add_positive_slope(Maze::Maze &maze, Maze::Point const &p) {
+add_positive_slope(Maze::Maze &maze, Maze::Point const &p,
+                   Render_policy const &render) {
     auto const row_size = static_cast<float>(maze.row_size()) - 2.0F;
     auto const col_size = static_cast<float>(maze.col_size()) - 2.0F;
     auto const cur_row = static_cast<float>(p.row);
@@ -486,55 +506,25 @@ add_positive_slope(Maze::Maze &maze, Maze::Point const &p) {
     float const b = 2.0F - (2.0F * slope);
     int const on_line = static_cast<int>((cur_row - b) / slope);
     if (p.col == on_line && p.col < maze.col_size() - 2 && p.col > 1) {
-        // An X is hard to notice and might miss breaking wall lines so make it
-        // wider.
-        build_path(maze, p);
-        if (p.col + 1 < maze.col_size() - 2) {
-            build_path(maze, {p.row, p.col + 1});
-        }
-        if (p.col - 1 > 1) {
-            build_path(maze, {p.row, p.col - 1});
-        }
-        if (p.col + 2 < maze.col_size() - 2) {
-            build_path(maze, {p.row, p.col + 2});
-        }
-        if (p.col - 2 > 1) {
-            build_path(maze, {p.row, p.col - 2});
-        }
+        widen_slope(maze, p, render);
     }
 }
 
+void
+add_positive_slope(Maze::Maze &maze, Maze::Point const &p) {
+    add_positive_slope(maze, p, Render::No_render{});
+}
+
 void
 add_positive_slope_animated(Maze::Maze &maze, Maze::Point const &p,
                             Speed::Speed_unit speed) {
-    auto const row_size = static_cast<float>(maze.row_size()) - 2.0F;
-    auto const col_size = static_cast<float>(maze.col_size()) - 2.0F;
-    auto const cur_row = static_cast<float>(p.row);
-    // y = mx + b. We will get the negative slope. This line goes top left to
-    // bottom right.
-    float const slope = (2.0F - row_size) / (2.0F - col_size);
-    float const b = 2.0F - (2.0F * slope);
-    int const on_line = static_cast<int>((cur_row - b) / slope);
-    if (p.col == on_line && p.col < maze.col_size() - 2 && p.col > 1) {
-        // An X is hard to notice so make it wider.
-        build_path_animated(maze, p, speed);
-        if (p.col + 1 < maze.col_size() - 2) {
-            build_path_animated(maze, {p.row, p.col + 1}, speed);
-        }
-        if (p.col - 1 > 1) {
-            build_path_animated(maze, {p.row, p.col - 1}, speed);
-        }
-        if (p.col + 2 < maze.col_size() - 2) {
-            build_path_animated(maze, {p.row, p.col + 2}, speed);
-        }
-        if (p.col - 2 > 1) {
-            build_path_animated(maze, {p.row, p.col - 2}, speed);
-        }
-    }
+    add_positive_slope(maze, p, Terminal_render{speed});
 }
 
+template <class Render_policy>
 void
-add_negative_slope(Maze::Maze &maze, Maze::Point const &p) {
+add_negative_slope(Maze::Maze &maze, Maze::Point const &p,
+                   Render_policy const &render) {
     auto const row_size = static_cast<float>(maze.row_size()) - 2.0F;
     auto const col_size = static_cast<float>(maze.col_size()) - 2.0F;
     auto const cur_row = static_cast<float>(p.row);
@@ -543,47 +533,19 @@ add_negative_slope(Maze::Maze &maze, Maze::Point const &p) {
     int const on_line = static_cast<int>((cur_row - b) / slope);
     if (p.col == on_line && p.col > 1 && p.col < maze.col_size() - 2
         && p.row < maze.row_size() - 2) {
-        build_path(maze, p);
-        if (p.col + 1 < maze.col_size() - 2) {
-            build_path(maze, {p.row, p.col + 1});
-        }
-        if (p.col - 1 > 1) {
-            build_path(maze, {p.row, p.col - 1});
-        }
-        if (p.col + 2 < maze.col_size() - 2) {
-            build_path(maze, {p.row, p.col + 2});
-        }
-        if (p.col - 2 > 1) {
-            build_path(maze, {p.row, p.col - 2});
-        }
+        widen_slope(maze, p, render);
     }
 }
 
+void
+add_negative_slope(Maze::Maze &maze, Maze::Point const &p) {
+    add_negative_slope(maze, p, Render::No_render{});
+}
+
 void
 add_negative_slope_animated(Maze::Maze &maze, Maze::Point const &p,
                             Speed::Speed_unit speed) {
-    auto const row_size = static_cast<float>(maze.row_size()) - 2.0F;
-    auto const col_size = static_cast<float>(maze.col_size()) - 2.0F;
-    auto const cur_row = static_cast<float>(p.row);
-    float const slope = (2.0F - row_size) / (col_size - 2.0F);
-    float const b = row_size - (2.0F * slope);
-    int const on_line = static_cast<int>((cur_row - b) / slope);
-    if (p.col == on_line && p.col > 1 && p.col < maze.col_size() - 2
-        && p.row < maze.row_size() - 2) {
-        build_path_animated(maze, p, speed);
-        if (p.col + 1 < maze.col_size() - 2) {
-            build_path_animated(maze, {p.row, p.col + 1}, speed);
-        }
-        if (p.col - 1 > 1) {
-            build_path_animated(maze, {p.row, p.col - 1}, speed);
-        }
-        if (p.col + 2 < maze.col_size() - 2) {
-            build_path_animated(maze, {p.row, p.col + 2}, speed);
-        }
-        if (p.col - 2 > 1) {
-            build_path_animated(maze, {p.row, p.col - 2}, speed);
-        }
-    }
+    add_negative_slope(maze, p, Terminal_render{speed});
 }
 
 void
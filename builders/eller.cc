@@ -10,6 +10,7 @@ export module labyrinth:eller;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -61,8 +62,10 @@ merge_sets(Sliding_set_window &sets, Id_merge_request const &merge,
     }
 }
 
+template <class Render_policy>
 void
-complete_final_row(Maze::Maze &maze, Sliding_set_window &window) {
+complete_final_row(Maze::Maze &maze, Sliding_set_window &window,
+                   Render_policy const &render) {
     int const final_row = maze.row_size() - 2;
     for (int col = 1; col < maze.col_size() - 2; col += 2) {
         Maze::Point const next = {final_row, col + 2};
@@ -70,7 +73,7 @@ complete_final_row(Maze::Maze &maze, Sliding_set_window &window) {
             = window.sets[window.curr_row * window.width + col];
         if (this_square_id
             != window.sets[window.curr_row * window.width + col + 2]) {
-            Butil::join_squares(maze, {final_row, col}, next);
+            Butil::join_squares(maze, {final_row, col}, next, render);
             Set_id const other_set_id
                 = window.sets[window.curr_row * window.width + next.col];
             for (int set_elem = next.col; set_elem < maze.col_size() - 1;
@@ -85,36 +88,6 @@ complete_final_row(Maze::Maze &maze, Sliding_set_window &window) {
     }
 }
 
-void
-complete_final_row_animated(Maze::Maze &maze, Sliding_set_window &window,
-                            Speed::Speed_unit animation) {
-    int const final_row = maze.row_size() - 2;
-    for (int col = 1; col < maze.col_size() - 2; col += 2) {
-        Maze::Point const next = {final_row, col + 2};
-        Set_id const this_square_id
-            = window.sets[window.curr_row * window.width + col];
-        if (this_square_id
-            != window.sets[window.curr_row * window.width + col + 2]) {
-            Butil::join_squares_animated(maze, {final_row, col}, next,
-                                         animation);
-            Set_id const other_set_id
-                = window.sets[window.curr_row * window.width + next.col];
-            for (int set_elem = next.col; set_elem < maze.col_size() - 1;
-                 set_elem += 2) {
-                if (window.sets[window.curr_row * window.width + set_elem]
-                    == other_set_id) {
-                    window.sets[window.curr_row * window.width + set_elem]
-                        = this_square_id;
-                }
-            }
-        }
-    }
-}
-
-} // namespace
-
-namespace Eller {
-
 // There are two fun details about this implementation: the auxillary memory
 // requirement is a constant determined by the width of a row and the randomness
 // is thorough when determining how many squares per set should drop below. The
@@ -122,10 +95,10 @@ namespace Eller {
 // memory footprint low and a good randomized technique to choose dropping
 // squares. Find a better strategy.
 
+template <class Render_policy>
 void
-generate_maze(Maze::Maze &maze) {
-    Butil::fill_maze_with_walls(maze);
-    std::mt19937 gen(std::random_device{}());
+build(Maze::Maze &maze, Render_policy const &render) {
+    std::mt19937 gen(Maze::random_seed());
     std::uniform_int_distribution<int> coin(0, horizontal_bias);
 
     Sliding_set_window window(maze);
@@ -148,7 +121,7 @@ generate_maze(Maze::Maze &maze) {
                 && this_square_id
                        != window.sets[window.curr_row * window.width + next.col]
                 && coin(gen)) {
-                Butil::join_squares(maze, {row, col}, next);
+                Butil::join_squares(maze, {row, col}, next, render);
                 merge_sets(
                     window,
                     {this_square_id,
@@ -172,86 +145,37 @@ generate_maze(Maze::Maze &maze) {
                     0, s.second.size() - 1);
                 Maze::Point const chosen = s.second[rand_drop(gen)];
                 // We already linked this up and rondomness dropped us here
-                // again. More important for animated version.
+                // again. Save pointless cursor movements when animated.
                 if (!(maze[chosen.row + 2][chosen.col] & Maze::builder_bit)) {
                     window.sets[next_row * window.width + chosen.col] = s.first;
                     Butil::join_squares(maze, chosen,
-                                        {chosen.row + 2, chosen.col});
+                                        {chosen.row + 2, chosen.col}, render);
                 }
             }
         }
         window.curr_row = next_row;
         sets_in_this_row.clear();
     }
-    complete_final_row(maze, window);
+    complete_final_row(maze, window, render);
+}
+
+} // namespace
+
+namespace Eller {
+
+void
+generate_maze(Maze::Maze &maze) {
+    Butil::fill_maze_with_walls(maze);
+    build(maze, Render::No_render{});
     Butil::clear_and_flush_grid(maze);
 }
 
 void
 animate_maze(Maze::Maze &maze, Speed::Speed speed) {
     Butil::fill_maze_with_walls_animated(maze);
-    Butil::clear_and_flush_grid(maze);
-    Speed::Speed_unit const animation
-        = Butil::builder_speeds.at(static_cast<int>(speed));
-    std::mt19937 gen(std::random_device{}());
-    std::uniform_int_distribution<int> coin(0, horizontal_bias);
-
-    Sliding_set_window window(maze);
-    std::span<Set_id> init_sets(window.sets.data(), window.width);
-    std::iota(std::begin(init_sets), std::end(init_sets), 0);
-    Set_id unique_ids = maze.col_size();
-    std::unordered_map<Set_id, std::vector<Maze::Point>> sets_in_this_row{};
-    for (int row = 1; row < maze.row_size() - 2; row += 2) {
-        uint64_t const next_row = (window.curr_row + 1) % window_height;
-        std::span<Set_id> fill_sets(&window.sets[next_row * window.width],
-                                    window.width);
-        std::iota(std::begin(fill_sets), std::end(fill_sets), unique_ids);
-        unique_ids += maze.col_size();
-
-        for (int col = 1; col < maze.col_size() - 1; col += 2) {
-            Maze::Point const next = {row, col + 2};
-            Set_id const this_square_id
-                = window.sets[window.curr_row * window.width + col];
-            if (Butil::is_square_within_perimeter_walls(maze, next)
-                && this_square_id
-                       != window.sets[window.curr_row * window.width + next.col]
-                && coin(gen)) {
-                Butil::join_squares_animated(maze, {row, col}, next, animation);
-                merge_sets(
-                    window,
-                    {this_square_id,
-                     window.sets[window.curr_row * window.width + next.col]},
-                    col);
-            }
-        }
-
-        for (int col = 1; col < maze.col_size() - 1; col += 2) {
-            Set_id const this_square_id
-                = window.sets[window.curr_row * window.width + col];
-            sets_in_this_row[this_square_id].push_back({row, col});
-        }
-
-        for (auto const &s : sets_in_this_row) {
-            std::uniform_int_distribution<uint64_t> num_drops(1,
-                                                              s.second.size());
-            uint64_t const drops = num_drops(gen);
-            for (uint64_t drop = 0; drop < drops; drop++) {
-                std::uniform_int_distribution<uint64_t> rand_drop(
-                    0, s.second.size() - 1);
-                Maze::Point const chosen = s.second[rand_drop(gen)];
-                // We already linked this up and rondomness dropped us here
-                // again. Save pointless cursor movements.
-                if (!(maze[chosen.row + 2][chosen.col] & Maze::builder_bit)) {
-                    window.sets[next_row * window.width + chosen.col] = s.first;
-                    Butil::join_squares_animated(
-                        maze, chosen, {chosen.row + 2, chosen.col}, animation);
-                }
-            }
-        }
-        window.curr_row = next_row;
-        sets_in_this_row.clear();
-    }
-    complete_final_row_animated(maze, window, animation);
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::blank);
+    build(maze, Butil::Terminal_render{
+                    Butil::builder_speeds.at(static_cast<int>(speed))});
 }
 
 } // namespace Eller
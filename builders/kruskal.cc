@@ -8,6 +8,7 @@ import :disjoint_set;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -37,7 +38,7 @@ load_shuffled_walls(Maze::Maze &maze) {
         }
     }
     std::shuffle(walls.begin(), walls.end(),
-                 std::mt19937(std::random_device{}()));
+                 std::mt19937(Maze::random_seed()));
     return walls;
 }
 
@@ -55,13 +56,9 @@ tag_cells(Maze::Maze &maze) {
     return set_ids;
 }
 
-} // namespace
-
-namespace Kruskal {
-
+template <class Render_policy>
 void
-generate_maze(Maze::Maze &maze) {
-    Butil::fill_maze_with_walls(maze);
+build(Maze::Maze &maze, Render_policy const &render) {
     std::vector<Maze::Point> const walls = load_shuffled_walls(maze);
     std::unordered_map<Maze::Point, int> const set_ids = tag_cells(maze);
     Disjoint_set sets(set_ids.size());
@@ -71,49 +68,36 @@ generate_maze(Maze::Maze &maze) {
             Maze::Point const below_cell = {p.row + 1, p.col};
             if (sets.made_union(set_ids.at(above_cell),
                                 set_ids.at(below_cell))) {
-                Butil::join_squares(maze, above_cell, below_cell);
+                Butil::join_squares(maze, above_cell, below_cell, render);
             }
         } else {
             Maze::Point const left_cell = {p.row, p.col - 1};
             Maze::Point const right_cell = {p.row, p.col + 1};
             if (sets.made_union(set_ids.at(left_cell),
                                 set_ids.at(right_cell))) {
-                Butil::join_squares(maze, left_cell, right_cell);
+                Butil::join_squares(maze, left_cell, right_cell, render);
             }
         }
     }
+}
+
+} // namespace
+
+namespace Kruskal {
+
+void
+generate_maze(Maze::Maze &maze) {
+    Butil::fill_maze_with_walls(maze);
+    build(maze, Render::No_render{});
     Butil::clear_and_flush_grid(maze);
 }
 
 void
 animate_maze(Maze::Maze &maze, Speed::Speed speed) {
-    Speed::Speed_unit const animation
-        = Butil::builder_speeds.at(static_cast<int>(speed));
     Butil::fill_maze_with_walls_animated(maze);
-    Butil::clear_and_flush_grid(maze);
-    std::vector<Maze::Point> const walls = load_shuffled_walls(maze);
-    std::unordered_map<Maze::Point, int> const set_ids = tag_cells(maze);
-    Disjoint_set sets(set_ids.size());
-
-    for (Maze::Point const &p : walls) {
-        if (p.row % 2 == 0) {
-            Maze::Point const above_cell = {p.row - 1, p.col};
-            Maze::Point const below_cell = {p.row + 1, p.col};
-            if (sets.made_union(set_ids.at(above_cell),
-                                set_ids.at(below_cell))) {
-                Butil::join_squares_animated(maze, above_cell, below_cell,
-                                             animation);
-            }
-        } else {
-            Maze::Point const left_cell = {p.row, p.col - 1};
-            Maze::Point const right_cell = {p.row, p.col + 1};
-            if (sets.made_union(set_ids.at(left_cell),
-                                set_ids.at(right_cell))) {
-                Butil::join_squares_animated(maze, left_cell, right_cell,
-                                             animation);
-            }
-        }
-    }
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::blank);
+    build(maze, Butil::Terminal_render{
+                    Butil::builder_speeds.at(static_cast<int>(speed))});
 }
 
 } // namespace Kruskal
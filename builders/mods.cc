@@ -2,6 +2,7 @@ export module labyrinth:mods;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -28,6 +29,7 @@ add_x(Maze::Maze &maze) {
 
 void
 add_x_animated(Maze::Maze &maze, Speed::Speed speed) {
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::maze);
     Speed::Speed_unit const animation
         = Butil::builder_speeds.at(static_cast<int>(speed));
     for (int row = 1; row < maze.row_size() - 1; row++) {
@@ -57,6 +59,7 @@ add_cross(Maze::Maze &maze) {
 
 void
 add_cross_animated(Maze::Maze &maze, Speed::Speed speed) {
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::maze);
     Speed::Speed_unit const animation
         = Butil::builder_speeds.at(static_cast<int>(speed));
     for (int row = 1; row < maze.row_size() - 1; row++) {
@@ -1,15 +1,14 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <iterator>
 #include <numeric>
 #include <random>
-#include <thread>
 #include <vector>
 export module labyrinth:recursive_backtracker;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -20,16 +19,16 @@ void animate_maze(Maze::Maze &maze, Speed::Speed speed);
 
 //////////////////////////////////   Implementation
 
-namespace Recursive_backtracker {
+namespace {
 
 constexpr Speed::Speed_unit backtrack_delay = 8;
 
+template <class Render_policy>
 void
-generate_maze(Maze::Maze &maze) {
-    Butil::fill_maze_with_walls(maze);
+build(Maze::Maze &maze, Render_policy const &render) {
     // Note that backtracking occurs by encoding directions into path bits. No
     // stack needed.
-    std::mt19937 generator(std::random_device{}());
+    std::mt19937 generator(Maze::random_seed());
     std::uniform_int_distribution<int> row_random(1, maze.row_size() - 2);
     std::uniform_int_distribution<int> col_random(1, maze.col_size() - 2);
 
@@ -52,7 +51,7 @@ generate_maze(Maze::Maze &maze) {
                 = {cur.row + direction.row, cur.col + direction.col};
             if (Butil::can_build_new_square(maze, next)) {
                 branches_remain = true;
-                Butil::carve_path_markings(maze, cur, next);
+                Butil::carve_path_markings(maze, cur, next, render);
                 cur = next;
                 break;
             }
@@ -62,74 +61,45 @@ generate_maze(Maze::Maze &maze) {
                 (maze[cur.row][cur.col] & Maze::markers_mask).load()
                 >> Maze::marker_shift)};
             Maze::Point const &backtracking = Maze::backtracking_marks.at(dir);
+            Maze::Point const &backtracking_half
+                = Maze::backtracking_half_marks.at(dir);
+            Maze::Point const half = {cur.row + backtracking_half.row,
+                                      cur.col + backtracking_half.col};
             Maze::Point const next
                 = {cur.row + backtracking.row, cur.col + backtracking.col};
             // We are using fields the threads will use later. Clear bits as we
-            // backtrack.
+            // backtrack. Only an animation marks the half square between.
+            maze[half.row][half.col] &= ~Maze::markers_mask;
             maze[cur.row][cur.col] &= ~Maze::markers_mask;
+            if constexpr (Render_policy::animated) {
+                Butil::flush_cursor_maze_coordinate(maze, half);
+                Speed::pace(render.speed, backtrack_delay);
+                Butil::flush_cursor_maze_coordinate(maze, cur);
+                Speed::pace(render.speed, backtrack_delay);
+            }
             cur = next;
             branches_remain = true;
         }
     }
+}
+
+} // namespace
+
+namespace Recursive_backtracker {
+
+void
+generate_maze(Maze::Maze &maze) {
+    Butil::fill_maze_with_walls(maze);
+    build(maze, Render::No_render{});
     Butil::clear_and_flush_grid(maze);
 }
 
 void
 animate_maze(Maze::Maze &maze, Speed::Speed speed) {
-    Speed::Speed_unit const animation
-        = Butil::builder_speeds.at(static_cast<int>(speed));
     Butil::fill_maze_with_walls_animated(maze);
-    Butil::clear_and_flush_grid(maze);
-    std::mt19937 generator(std::random_device{}());
-    std::uniform_int_distribution<int> row_random(1, maze.row_size() - 2);
-    std::uniform_int_distribution<int> col_random(1, maze.col_size() - 2);
-    Maze::Point const start = {2 * (row_random(generator) / 2) + 1,
-                               2 * (col_random(generator) / 2) + 1};
-    std::vector<int> random_direction_indices(Maze::build_dirs.size());
-    std::iota(begin(random_direction_indices), end(random_direction_indices),
-              0);
-    Maze::Point cur = start;
-    bool branches_remain = true;
-    while (branches_remain) {
-        shuffle(begin(random_direction_indices), end(random_direction_indices),
-                generator);
-        branches_remain = false;
-        for (int const &i : random_direction_indices) {
-            Maze::Point const &direction = Maze::build_dirs.at(i);
-            Maze::Point const next
-                = {cur.row + direction.row, cur.col + direction.col};
-            if (Butil::can_build_new_square(maze, next)) {
-                Butil::carve_path_markings_animated(maze, cur, next, animation);
-                branches_remain = true;
-                cur = next;
-                break;
-            }
-        }
-        if (!branches_remain && cur != start) {
-            Maze::Backtrack_marker const dir{static_cast<Maze::Square_bits>(
-                (maze[cur.row][cur.col] & Maze::markers_mask).load()
-                >> Maze::marker_shift)};
-            Maze::Point const &backtracking = Maze::backtracking_marks.at(dir);
-            Maze::Point const &backtracking_half
-                = Maze::backtracking_half_marks.at(dir);
-            Maze::Point const half = {cur.row + backtracking_half.row,
-                                      cur.col + backtracking_half.col};
-            Maze::Point const next
-                = {cur.row + backtracking.row, cur.col + backtracking.col};
-            // We are using fields the threads will use later. Clear bits as we
-            // backtrack.
-            maze[half.row][half.col] &= ~Maze::markers_mask;
-            maze[cur.row][cur.col] &= ~Maze::markers_mask;
-            Butil::flush_cursor_maze_coordinate(maze, half);
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(animation * backtrack_delay));
-            Butil::flush_cursor_maze_coordinate(maze, cur);
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(animation * backtrack_delay));
-            cur = next;
-            branches_remain = true;
-        }
-    }
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::blank);
+    build(maze, Butil::Terminal_render{
+                    Butil::builder_speeds.at(static_cast<int>(speed))});
 }
 
 } // namespace Recursive_backtracker
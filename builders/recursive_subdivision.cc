@@ -6,6 +6,7 @@ export module labyrinth:recursive_subdivision;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -33,14 +34,10 @@ random_odd_passage(std::mt19937 &generator, int axis_limit) {
     return 2 * divider(generator) + 1;
 }
 
-} // namespace
-
-namespace Recursive_subdivision {
-
+template <class Render_policy>
 void
-generate_maze(Maze::Maze &maze) {
-    Butil::build_wall_outline(maze);
-    std::mt19937 generator(std::random_device{}());
+build(Maze::Maze &maze, Render_policy const &render) {
+    std::mt19937 generator(Maze::random_seed());
     std::stack<std::tuple<Maze::Point, Height, Width>> chamber_stack(
         {{{0, 0}, maze.row_size(), maze.col_size()}});
     while (!chamber_stack.empty()) {
@@ -55,8 +52,10 @@ generate_maze(Maze::Maze &maze) {
                 if (col != passage) {
                     maze[chamber_offset.row + divide][chamber_offset.col + col]
                         &= ~Maze::path_bit;
-                    Butil::build_wall_line(maze, {chamber_offset.row + divide,
-                                                  chamber_offset.col + col});
+                    Butil::build_wall_line(
+                        maze,
+                        {chamber_offset.row + divide, chamber_offset.col + col},
+                        render);
                 }
             }
             // Remember to shrink height of this branch before we continue down
@@ -73,8 +72,10 @@ generate_maze(Maze::Maze &maze) {
                 if (row != passage) {
                     maze[chamber_offset.row + row][chamber_offset.col + divide]
                         &= ~Maze::path_bit;
-                    Butil::build_wall_line(maze, {chamber_offset.row + row,
-                                                  chamber_offset.col + divide});
+                    Butil::build_wall_line(
+                        maze,
+                        {chamber_offset.row + row, chamber_offset.col + divide},
+                        render);
                 }
             }
             // In this case, we are shrinking the width.
@@ -87,63 +88,25 @@ generate_maze(Maze::Maze &maze) {
             chamber_stack.pop();
         }
     }
+}
+
+} // namespace
+
+namespace Recursive_subdivision {
+
+void
+generate_maze(Maze::Maze &maze) {
+    Butil::build_wall_outline(maze);
+    build(maze, Render::No_render{});
     Butil::clear_and_flush_grid(maze);
 }
 
 void
 animate_maze(Maze::Maze &maze, Speed::Speed speed) {
-    Speed::Speed_unit const animation
-        = Butil::builder_speeds.at(static_cast<int>(speed));
     Butil::build_wall_outline(maze);
-    Butil::clear_and_flush_grid(maze);
-    std::mt19937 generator(std::random_device{}());
-    std::stack<std::tuple<Maze::Point, Height, Width>> chamber_stack(
-        {{{0, 0}, maze.row_size(), maze.col_size()}});
-    while (!chamber_stack.empty()) {
-        std::tuple<Maze::Point, Height, Width> &chamber = chamber_stack.top();
-        Maze::Point const &chamber_offset = std::get<0>(chamber);
-        int const chamber_height = std::get<1>(chamber);
-        int const chamber_width = std::get<2>(chamber);
-        if (chamber_height >= chamber_width && chamber_width > 3) {
-            int const divide = random_even_division(generator, chamber_height);
-            int const passage = random_odd_passage(generator, chamber_width);
-            for (int col = 0; col < chamber_width; col++) {
-                if (col != passage) {
-                    maze[chamber_offset.row + divide][chamber_offset.col + col]
-                        &= ~Maze::path_bit;
-                    Butil::build_wall_line_animated(
-                        maze,
-                        {chamber_offset.row + divide, chamber_offset.col + col},
-                        animation);
-                }
-            }
-            std::get<1>(chamber) = divide + 1;
-            Maze::Point const offset
-                = {chamber_offset.row + divide, chamber_offset.col};
-            chamber_stack.emplace(offset, chamber_height - divide,
-                                  chamber_width);
-        } else if (chamber_width > chamber_height && chamber_height > 3) {
-            int const divide = random_even_division(generator, chamber_width);
-            int const passage = random_odd_passage(generator, chamber_height);
-            for (int row = 0; row < chamber_height; row++) {
-                if (row != passage) {
-                    maze[chamber_offset.row + row][chamber_offset.col + divide]
-                        &= ~Maze::path_bit;
-                    Butil::build_wall_line_animated(
-                        maze,
-                        {chamber_offset.row + row, chamber_offset.col + divide},
-                        animation);
-                }
-            }
-            std::get<2>(chamber) = divide + 1;
-            Maze::Point const offset
-                = {chamber_offset.row, chamber_offset.col + divide};
-            chamber_stack.emplace(offset, chamber_height,
-                                  chamber_width - divide);
-        } else {
-            chamber_stack.pop();
-        }
-    }
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::blank);
+    build(maze, Butil::Terminal_render{
+                    Butil::builder_speeds.at(static_cast<int>(speed))});
 }
 
 } // namespace Recursive_subdivision
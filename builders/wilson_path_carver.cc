@@ -1,17 +1,16 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <cstdlib>
 #include <iostream>
 #include <iterator>
 #include <numeric>
 #include <random>
-#include <thread>
 #include <vector>
 export module labyrinth:wilson_path_carver;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -42,8 +41,10 @@ is_valid_random_step(Maze::Maze &maze, Maze::Point const &next,
            && next.col < maze.col_size() - 1 && next != previous;
 }
 
+template <class Render_policy>
 void
-build_marks(Maze::Maze &maze, Maze::Point const &cur, Maze::Point const &next) {
+build_marks(Maze::Maze &maze, Maze::Point const &cur, Maze::Point const &next,
+            Render_policy const &render) {
     Maze::Point wall = cur;
     if (next.row < cur.row) {
         wall.row--;
@@ -60,58 +61,15 @@ build_marks(Maze::Maze &maze, Maze::Point const &cur, Maze::Point const &next) {
     }
     maze[cur.row][cur.col] &= ~Maze::start_bit;
     maze[next.row][next.col] &= ~Maze::start_bit;
-    Butil::carve_path_walls(maze, cur);
-    Butil::carve_path_walls(maze, next);
-    Butil::carve_path_walls(maze, wall);
+    Butil::carve_path_walls(maze, cur, render);
+    Butil::carve_path_walls(maze, wall, render);
+    Butil::carve_path_walls(maze, next, render);
 }
 
+template <class Render_policy>
 void
-animate_marks(Maze::Maze &maze, Maze::Point const &cur, Maze::Point const &next,
-              Speed::Speed_unit speed) {
-    Maze::Point wall = cur;
-    if (next.row < cur.row) {
-        wall.row--;
-    } else if (next.row > cur.row) {
-        wall.row++;
-    } else if (next.col < cur.col) {
-        wall.col--;
-    } else if (next.col > cur.col) {
-        wall.col++;
-    } else {
-        std::cerr << "Wall break error. Step through wall didn't work"
-                  << "\n";
-    }
-    maze[cur.row][cur.col] &= ~Maze::start_bit;
-    maze[next.row][next.col] &= ~Maze::start_bit;
-    Butil::carve_path_walls_animated(maze, cur, speed);
-    Butil::carve_path_walls_animated(maze, wall, speed);
-    Butil::carve_path_walls_animated(maze, next, speed);
-}
-
-void
-connect_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk) {
-    Maze::Point cur = walk;
-    while (maze[cur.row][cur.col] & Maze::markers_mask) {
-        Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
-            (maze[cur.row][cur.col] & Maze::markers_mask).load()
-            >> Maze::marker_shift)};
-        Maze::Point const &direction = Maze::backtracking_marks.at(mark);
-        Maze::Point const next
-            = {cur.row + direction.row, cur.col + direction.col};
-        build_marks(maze, cur, next);
-        // Clean up after ourselves and leave no marks behind for the maze
-        // solvers.
-        maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        cur = next;
-    }
-    maze[cur.row][cur.col] &= ~Maze::start_bit;
-    maze[cur.row][cur.col] &= ~Maze::markers_mask;
-    Butil::carve_path_walls(maze, cur);
-}
-
-void
-animate_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk,
-                     Speed::Speed_unit speed) {
+connect_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk,
+                     Render_policy const &render) {
     Maze::Point cur = walk;
     while (maze[cur.row][cur.col] & Maze::markers_mask) {
         Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
@@ -123,43 +81,23 @@ animate_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk,
             = {cur.row + half_step.row, cur.col + half_step.col};
         Maze::Point const next
             = {cur.row + direction.row, cur.col + direction.col};
-        animate_marks(maze, cur, next, speed);
+        build_marks(maze, cur, next, render);
         // Clean up after ourselves and leave no marks behind for the maze
-        // solvers.
+        // solvers. Only an animation marks the half step.
         maze[half.row][half.col] &= ~Maze::markers_mask;
         maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        Butil::flush_cursor_maze_coordinate(maze, half);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-        Butil::flush_cursor_maze_coordinate(maze, cur);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
+        render.draw(maze, half);
+        render.draw(maze, cur);
         cur = next;
     }
     maze[cur.row][cur.col] &= ~Maze::start_bit;
     maze[cur.row][cur.col] &= ~Maze::markers_mask;
-    Butil::carve_path_walls_animated(maze, cur, speed);
-    Butil::flush_cursor_maze_coordinate(maze, cur);
-    std::this_thread::sleep_for(std::chrono::microseconds(speed));
+    Butil::carve_path_walls(maze, cur, render);
 }
 
+template <class Render_policy>
 void
-erase_loop(Maze::Maze &maze, Loop const &loop) {
-    Maze::Point cur = loop.walk;
-    while (cur != loop.root) {
-        maze[cur.row][cur.col] &= ~Maze::start_bit;
-        Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
-            (maze[cur.row][cur.col] & Maze::markers_mask).load()
-            >> Maze::marker_shift)};
-        Maze::Point const &direction = Maze::backtracking_marks.at(mark);
-        Maze::Point const next
-            = {cur.row + direction.row, cur.col + direction.col};
-        maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        cur = next;
-    }
-}
-
-void
-animate_erase_loop(Maze::Maze &maze, Loop const &loop,
-                   Speed::Speed_unit speed) {
+erase_loop(Maze::Maze &maze, Loop const &loop, Render_policy const &render) {
     Maze::Point cur = loop.walk;
     while (cur != loop.root) {
         maze[cur.row][cur.col] &= ~Maze::start_bit;
@@ -174,52 +112,19 @@ animate_erase_loop(Maze::Maze &maze, Loop const &loop,
             = {cur.row + direction.row, cur.col + direction.col};
         maze[half.row][half.col] &= ~Maze::markers_mask;
         maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        Butil::flush_cursor_maze_coordinate(maze, half);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-        Butil::flush_cursor_maze_coordinate(maze, cur);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
+        render.draw(maze, half);
+        render.draw(maze, cur);
         cur = next;
     }
 }
 
+template <class Render_policy>
 bool
-continue_random_walks(Maze::Maze &maze, Random_walk &cur) {
-    if (Butil::has_builder_bit(maze, cur.next)) {
-        build_marks(maze, cur.walk, cur.next);
-        connect_walk_to_maze(maze, cur.walk);
-        cur.walk = choose_arbitrary_point(maze, Butil::Parity_point::odd);
-
-        if (!cur.walk.row) {
-            return false;
-        }
-
-        maze[cur.walk.row][cur.walk.col] &= ~Maze::markers_mask;
-        cur.prev = {};
-        return true;
-    }
-    if (maze[cur.next.row][cur.next.col] & Maze::start_bit) {
-        erase_loop(maze, {cur.walk, cur.next});
-        cur.walk = cur.next;
-        cur.prev = {};
-        Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
-            (maze[cur.walk.row][cur.walk.col] & Maze::markers_mask).load()
-            >> Maze::marker_shift)};
-        Maze::Point const &direction = Maze::backtracking_marks.at(mark);
-        cur.prev = {cur.walk.row + direction.row, cur.walk.col + direction.col};
-        return true;
-    }
-    Butil::mark_origin(maze, cur.walk, cur.next);
-    cur.prev = cur.walk;
-    cur.walk = cur.next;
-    return true;
-}
-
-bool
-animate_random_walks(Maze::Maze &maze, Random_walk &cur,
-                     Speed::Speed_unit speed) {
+continue_random_walks(Maze::Maze &maze, Random_walk &cur,
+                      Render_policy const &render) {
     if (Butil::has_builder_bit(maze, cur.next)) {
-        animate_marks(maze, cur.walk, cur.next, speed);
-        animate_walk_to_maze(maze, cur.walk, speed);
+        build_marks(maze, cur.walk, cur.next, render);
+        connect_walk_to_maze(maze, cur.walk, render);
         cur.walk = choose_arbitrary_point(maze, Butil::Parity_point::odd);
 
         if (!cur.walk.row) {
@@ -231,7 +136,7 @@ animate_random_walks(Maze::Maze &maze, Random_walk &cur,
         return true;
     }
     if (maze[cur.next.row][cur.next.col] & Maze::start_bit) {
-        animate_erase_loop(maze, {cur.walk, cur.next}, speed);
+        erase_loop(maze, {cur.walk, cur.next}, render);
         cur.walk = cur.next;
         cur.prev = {};
         Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
@@ -241,32 +146,27 @@ animate_random_walks(Maze::Maze &maze, Random_walk &cur,
         cur.prev = {cur.walk.row + direction.row, cur.walk.col + direction.col};
         return true;
     }
-    Butil::mark_origin_animated(maze, cur.walk, cur.next, speed);
+    Butil::mark_origin(maze, cur.walk, cur.next, render);
     cur.prev = cur.walk;
     cur.walk = cur.next;
     return true;
 }
 
-} // namespace
-
-//////////////////////   Wilson's Path Carving Algorithm
-
-namespace Wilson_path_carver {
+// Important to remember that this maze builds by jumping two squares at a
+// time. Therefore for Wilson's algorithm to work two points must both be even
+// or odd to find each other. For any number N, 2 * N + 1 is always odd, 2 * N
+// is always even.
 
+template <class Render_policy>
 void
-generate_maze(Maze::Maze &maze) {
-    Butil::fill_maze_with_walls(maze);
-    // Important to remember that this maze builds by jumping two squares at a
-    // time. Therefore for Wilson's algorithm to work two points must both be
-    // even or odd to find each other. For any number N, 2 * N + 1 is always
-    // odd, 2 * N is always even.
-    std::mt19937 generator(std::random_device{}());
+build(Maze::Maze &maze, Render_policy const &render) {
+    std::mt19937 generator(Maze::random_seed());
     std::uniform_int_distribution<int> row_rand(2, maze.row_size() - 2);
     std::uniform_int_distribution<int> col_rand(2, maze.col_size() - 2);
     Maze::Point const start = {2 * (row_rand(generator) / 2) + 1,
                                2 * (col_rand(generator) / 2) + 1};
 
-    Butil::build_path(maze, start);
+    Butil::build_path(maze, start, render);
     maze[start.row][start.col] |= Maze::builder_bit;
     Random_walk cur = {{}, {1, 1}, {}};
     maze[cur.walk.row][cur.walk.col] &= ~Maze::markers_mask;
@@ -286,8 +186,7 @@ generate_maze(Maze::Maze &maze) {
             if (!is_valid_random_step(maze, cur.next, cur.prev)) {
                 continue;
             }
-            if (!continue_random_walks(maze, cur)) {
-                Butil::clear_and_flush_grid(maze);
+            if (!continue_random_walks(maze, cur, render)) {
                 return;
             }
             break;
@@ -295,45 +194,25 @@ generate_maze(Maze::Maze &maze) {
     }
 }
 
-void
-animate_maze(Maze::Maze &maze, Speed::Speed speed) {
-    Speed::Speed_unit const animation
-        = Butil::builder_speeds.at(static_cast<int>(speed));
-    Butil::fill_maze_with_walls_animated(maze);
-    Butil::clear_and_flush_grid(maze);
-    std::mt19937 generator(std::random_device{}());
-    std::uniform_int_distribution<int> row_rand(2, maze.row_size() - 2);
-    std::uniform_int_distribution<int> col_rand(2, maze.col_size() - 2);
-    Maze::Point const start = {2 * (row_rand(generator) / 2) + 1,
-                               2 * (col_rand(generator) / 2) + 1};
+} // namespace
 
-    Butil::build_path(maze, start);
-    Butil::flush_cursor_maze_coordinate(maze, start);
-    maze[start.row][start.col] |= Maze::builder_bit;
-    Random_walk cur = {{}, {1, 1}, {}};
-    maze[cur.walk.row][cur.walk.col] &= ~Maze::markers_mask;
-    std::vector<int> random_direction_indices(Maze::build_dirs.size());
-    std::iota(begin(random_direction_indices), end(random_direction_indices),
-              0);
+//////////////////////   Wilson's Path Carving Algorithm
 
-    for (;;) {
-        maze[cur.walk.row][cur.walk.col] |= Maze::start_bit;
-        std::shuffle(begin(random_direction_indices),
-                     end(random_direction_indices), generator);
+namespace Wilson_path_carver {
 
-        for (int const &i : random_direction_indices) {
+void
+generate_maze(Maze::Maze &maze) {
+    Butil::fill_maze_with_walls(maze);
+    build(maze, Render::No_render{});
+    Butil::clear_and_flush_grid(maze);
+}
 
-            Maze::Point const &p = Maze::build_dirs.at(i);
-            cur.next = {cur.walk.row + p.row, cur.walk.col + p.col};
-            if (!is_valid_random_step(maze, cur.next, cur.prev)) {
-                continue;
-            }
-            if (!animate_random_walks(maze, cur, animation)) {
-                return;
-            }
-            break;
-        }
-    }
+void
+animate_maze(Maze::Maze &maze, Speed::Speed speed) {
+    Butil::fill_maze_with_walls_animated(maze);
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::blank);
+    build(maze, Butil::Terminal_render{
+                    Butil::builder_speeds.at(static_cast<int>(speed))});
 }
 
 } // namespace Wilson_path_carver
@@ -1,17 +1,16 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <cstdlib>
 #include <iostream>
 #include <iterator>
 #include <numeric>
 #include <random>
-#include <thread>
 #include <vector>
 export module labyrinth:wilson_wall_adder;
 import :maze;
 import :speed;
 import :build_utilities;
+import :render;
 
 ///////////////////////////////////   Exported Interface
 
@@ -42,9 +41,10 @@ is_valid_walk_step(Maze::Maze &maze, Maze::Point const &next,
            && next.col < maze.col_size() && next != prev;
 }
 
+template <class Render_policy>
 void
 join_walk_walls(Maze::Maze &maze, Maze::Point const &cur,
-                Maze::Point const &next) {
+                Maze::Point const &next, Render_policy const &render) {
     Maze::Point wall = cur;
     if (next.row < cur.row) {
         wall.row--;
@@ -61,59 +61,15 @@ join_walk_walls(Maze::Maze &maze, Maze::Point const &cur,
     }
     maze[cur.row][cur.col] &= ~Maze::start_bit;
     maze[next.row][next.col] &= ~Maze::start_bit;
-    Butil::build_wall_line(maze, cur);
-    Butil::build_wall_line(maze, wall);
-    Butil::build_wall_line(maze, next);
+    Butil::build_wall_line(maze, cur, render);
+    Butil::build_wall_line(maze, wall, render);
+    Butil::build_wall_line(maze, next, render);
 }
 
+template <class Render_policy>
 void
-animate_walk_walls(Maze::Maze &maze, Maze::Point const &cur,
-                   Maze::Point const &next, Speed::Speed_unit speed) {
-    Maze::Point wall = cur;
-    if (next.row < cur.row) {
-        wall.row--;
-    } else if (next.row > cur.row) {
-        wall.row++;
-    } else if (next.col < cur.col) {
-        wall.col--;
-    } else if (next.col > cur.col) {
-        wall.col++;
-    } else {
-        std::cerr << "Wall join error. Step through wall didn't work"
-                  << "\n";
-        std::abort();
-    }
-    maze[cur.row][cur.col] &= ~Maze::start_bit;
-    maze[next.row][next.col] &= ~Maze::start_bit;
-    Butil::build_wall_line_animated(maze, cur, speed);
-    Butil::build_wall_line_animated(maze, wall, speed);
-    Butil::build_wall_line_animated(maze, next, speed);
-}
-
-void
-connect_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk) {
-    Maze::Point cur = walk;
-    while (maze[cur.row][cur.col] & Maze::markers_mask) {
-        Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
-            (maze[cur.row][cur.col] & Maze::markers_mask).load()
-            >> Maze::marker_shift)};
-        Maze::Point const &direction = Maze::backtracking_marks.at(mark);
-        Maze::Point const next
-            = {cur.row + direction.row, cur.col + direction.col};
-        join_walk_walls(maze, cur, next);
-        // Clean up after ourselves and leave no marks behind for the maze
-        // solvers.
-        maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        cur = next;
-    }
-    maze[cur.row][cur.col] &= ~Maze::start_bit;
-    maze[cur.row][cur.col] &= ~Maze::markers_mask;
-    Butil::build_wall_line(maze, cur);
-}
-
-void
-animate_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk,
-                     Speed::Speed_unit speed) {
+connect_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk,
+                     Render_policy const &render) {
     Maze::Point cur = walk;
     while (maze[cur.row][cur.col] & Maze::markers_mask) {
         Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
@@ -125,41 +81,23 @@ animate_walk_to_maze(Maze::Maze &maze, Maze::Point const &walk,
             = {cur.row + half_step.row, cur.col + half_step.col};
         Maze::Point const next
             = {cur.row + direction.row, cur.col + direction.col};
-        animate_walk_walls(maze, cur, next, speed);
+        join_walk_walls(maze, cur, next, render);
         // Clean up after ourselves and leave no marks behind for the maze
-        // solvers.
+        // solvers. Only an animation marks the half step.
         maze[half.row][half.col] &= ~Maze::markers_mask;
         maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        Butil::flush_cursor_maze_coordinate(maze, half);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-        Butil::flush_cursor_maze_coordinate(maze, cur);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
+        render.draw(maze, half);
+        render.draw(maze, cur);
         cur = next;
     }
     maze[cur.row][cur.col] &= ~Maze::start_bit;
     maze[cur.row][cur.col] &= ~Maze::markers_mask;
-    Butil::build_wall_line_animated(maze, cur, speed);
-}
-
-void
-erase_loop(Maze::Maze &maze, Loop const &loop) {
-    Maze::Point cur = loop.walk;
-    while (cur != loop.root) {
-        maze[cur.row][cur.col] &= ~Maze::start_bit;
-        Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
-            (maze[cur.row][cur.col] & Maze::markers_mask).load()
-            >> Maze::marker_shift)};
-        Maze::Point const &direction = Maze::backtracking_marks.at(mark);
-        Maze::Point const next
-            = {cur.row + direction.row, cur.col + direction.col};
-        maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        cur = next;
-    }
+    Butil::build_wall_line(maze, cur, render);
 }
 
+template <class Render_policy>
 void
-animate_erase_loop(Maze::Maze &maze, Loop const &loop,
-                   Speed::Speed_unit speed) {
+erase_loop(Maze::Maze &maze, Loop const &loop, Render_policy const &render) {
     Maze::Point cur = loop.walk;
     while (cur != loop.root) {
         maze[cur.row][cur.col] &= ~Maze::start_bit;
@@ -174,19 +112,19 @@ animate_erase_loop(Maze::Maze &maze, Loop const &loop,
             = {cur.row + direction.row, cur.col + direction.col};
         maze[half.row][half.col] &= ~Maze::markers_mask;
         maze[cur.row][cur.col] &= ~Maze::markers_mask;
-        Butil::flush_cursor_maze_coordinate(maze, half);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
-        Butil::flush_cursor_maze_coordinate(maze, cur);
-        std::this_thread::sleep_for(std::chrono::microseconds(speed));
+        render.draw(maze, half);
+        render.draw(maze, cur);
         cur = next;
     }
 }
 
+template <class Render_policy>
 bool
-continue_random_walks(Maze::Maze &maze, Random_walk &cur) {
+continue_random_walks(Maze::Maze &maze, Random_walk &cur,
+                      Render_policy const &render) {
     if (Butil::has_builder_bit(maze, cur.next)) {
-        join_walk_walls(maze, cur.walk, cur.next);
-        connect_walk_to_maze(maze, cur.walk);
+        join_walk_walls(maze, cur.walk, cur.next, render);
+        connect_walk_to_maze(maze, cur.walk, render);
         cur.walk = choose_arbitrary_point(maze, Butil::Parity_point::even);
 
         if (!cur.walk.row) {
@@ -199,7 +137,7 @@ continue_random_walks(Maze::Maze &maze, Random_walk &cur) {
     }
 
     if (maze[cur.next.row][cur.next.col] & Maze::start_bit) {
-        erase_loop(maze, {cur.walk, cur.next});
+        erase_loop(maze, {cur.walk, cur.next}, render);
         cur.walk = cur.next;
         cur.prev = {};
         Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
@@ -210,56 +148,17 @@ continue_random_walks(Maze::Maze &maze, Random_walk &cur) {
         return true;
     }
 
-    Butil::mark_origin(maze, cur.walk, cur.next);
+    Butil::mark_origin(maze, cur.walk, cur.next, render);
     cur.prev = cur.walk;
     cur.walk = cur.next;
     return true;
 };
 
-bool
-animate_random_walks(Maze::Maze &maze, Random_walk &cur,
-                     Speed::Speed_unit speed) {
-    if (Butil::has_builder_bit(maze, cur.next)) {
-        animate_walk_walls(maze, cur.walk, cur.next, speed);
-        animate_walk_to_maze(maze, cur.walk, speed);
-        cur.walk = choose_arbitrary_point(maze, Butil::Parity_point::even);
-
-        if (!cur.walk.row) {
-            return false;
-        }
-
-        maze[cur.walk.row][cur.walk.col] &= ~Maze::markers_mask;
-        cur.prev = {};
-        return true;
-    }
-    if (maze[cur.next.row][cur.next.col] & Maze::start_bit) {
-        animate_erase_loop(maze, {cur.walk, cur.next}, speed);
-        cur.walk = cur.next;
-        cur.prev = {};
-        Maze::Backtrack_marker const mark{static_cast<Maze::Square_bits>(
-            (maze[cur.walk.row][cur.walk.col] & Maze::markers_mask).load()
-            >> Maze::marker_shift)};
-        Maze::Point const &direction = Maze::backtracking_marks.at(mark);
-        cur.prev = {cur.walk.row + direction.row, cur.walk.col + direction.col};
-        return true;
-    }
-    Butil::mark_origin_animated(maze, cur.walk, cur.next, speed);
-    cur.prev = cur.walk;
-    cur.walk = cur.next;
-    return true;
-}
-
-} // namespace
-
-/////////////////////   Wilson Wall Adder Algorithm
-
-namespace Wilson_wall_adder {
-
+template <class Render_policy>
 void
-generate_maze(Maze::Maze &maze) {
-    Butil::build_wall_outline(maze);
+build(Maze::Maze &maze, Render_policy const &render) {
     // Walls must start and connect between even squares.
-    std::mt19937 generator(std::random_device{}());
+    std::mt19937 generator(Maze::random_seed());
     std::uniform_int_distribution<int> row_rand(2, maze.row_size() - 2);
     std::uniform_int_distribution<int> col_rand(2, maze.col_size() - 2);
     Random_walk cur = {
@@ -278,8 +177,7 @@ generate_maze(Maze::Maze &maze) {
             if (!is_valid_walk_step(maze, cur.next, cur.prev)) {
                 continue;
             }
-            if (!continue_random_walks(maze, cur)) {
-                Butil::clear_and_flush_grid(maze);
+            if (!continue_random_walks(maze, cur, render)) {
                 return;
             }
             break;
@@ -287,38 +185,25 @@ generate_maze(Maze::Maze &maze) {
     }
 }
 
+} // namespace
+
+/////////////////////   Wilson Wall Adder Algorithm
+
+namespace Wilson_wall_adder {
+
 void
-animate_maze(Maze::Maze &maze, Speed::Speed speed) {
-    Speed::Speed_unit const animation
-        = Butil::builder_speeds.at(static_cast<int>(speed));
+generate_maze(Maze::Maze &maze) {
     Butil::build_wall_outline(maze);
+    build(maze, Render::No_render{});
     Butil::clear_and_flush_grid(maze);
-    std::mt19937 generator(std::random_device{}());
-    std::uniform_int_distribution<int> row_rand(2, maze.row_size() - 2);
-    std::uniform_int_distribution<int> col_rand(2, maze.col_size() - 2);
-    Random_walk cur = {
-        {}, {2 * (row_rand(generator) / 2), 2 * (col_rand(generator) / 2)}, {}};
+}
 
-    std::vector<int> random_direction_indices(Maze::build_dirs.size());
-    std::iota(begin(random_direction_indices), end(random_direction_indices),
-              0);
-    for (;;) {
-        // Every walk is distinguished from the maze with the start bit.
-        maze[cur.walk.row][cur.walk.col] |= Maze::start_bit;
-        shuffle(begin(random_direction_indices), end(random_direction_indices),
-                generator);
-        for (int const &i : random_direction_indices) {
-            Maze::Point const &p = Maze::build_dirs.at(i);
-            cur.next = {cur.walk.row + p.row, cur.walk.col + p.col};
-            if (!is_valid_walk_step(maze, cur.next, cur.prev)) {
-                continue;
-            }
-            if (!animate_random_walks(maze, cur, animation)) {
-                return;
-            }
-            break;
-        }
-    }
+void
+animate_maze(Maze::Maze &maze, Speed::Speed speed) {
+    Butil::build_wall_outline(maze);
+    Render::Session session(maze, Butil::wall_glyphs, Render::Screen::blank);
+    build(maze, Butil::Terminal_render{
+                    Butil::builder_speeds.at(static_cast<int>(speed))});
 }
 
 } // namespace Wilson_wall_adder
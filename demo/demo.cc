@@ -63,12 +63,22 @@ struct Demo_runner {
         Floodfs::animate_hunt,
         Floodfs::animate_gather,
         Floodfs::animate_corners,
+        Dead_end::animate_hunt,
+        Dead_end::animate_gather,
+        Dead_end::animate_corners,
         Rdfs::animate_hunt,
         Rdfs::animate_gather,
         Rdfs::animate_corners,
         Bfs::animate_hunt,
         Bfs::animate_gather,
         Bfs::animate_corners,
+        Steal_dfs::animate_hunt,
+        Steal_dfs::animate_gather,
+        Steal_dfs::animate_corners,
+        Steal_bfs::animate_hunt,
+        Steal_bfs::animate_gather,
+        Steal_bfs::animate_corners,
+        Junction::animate_hunt,
         Dark_dfs::animate_hunt,
         Dark_dfs::animate_gather,
         Dark_dfs::animate_corners,
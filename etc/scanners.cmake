@@ -2,6 +2,9 @@ file (GLOB_RECURSE MAZE_CC_FILES
   ${CMAKE_SOURCE_DIR}/demo/*.cc
   ${CMAKE_SOURCE_DIR}/run_maze/*.cc
   ${CMAKE_SOURCE_DIR}/measure/*.cc
+  ${CMAKE_SOURCE_DIR}/replay/*.cc
+  ${CMAKE_SOURCE_DIR}/batch/*.cc
+  ${CMAKE_SOURCE_DIR}/bench/*.cc
   ${CMAKE_SOURCE_DIR}/module/*.cc
   ${CMAKE_SOURCE_DIR}/speed/*.cc
   ${CMAKE_SOURCE_DIR}/maze/*.cc
@@ -1,7 +1,12 @@
 module;
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <random>
 #include <span>
 #include <string_view>
 #include <vector>
@@ -118,6 +123,90 @@ struct Point {
     int col;
 };
 
+/// Data one thread writes while others read nearby data goes on its own lines
+/// of this many bytes. Not std::hardware_destructive_interference_size because
+/// GCC warns that its value may change between compilers and flags, which
+/// would change the layout of every type aligned to it.
+constexpr std::size_t cache_line = 64;
+
+/// One thread's container on its own cache lines. Every push writes the
+/// container's size or end, and packed next to another thread's container
+/// each push would evict the line that thread is reading.
+template <class Container> struct alignas(cache_line) Padded : Container {};
+
+/// Visited marks packed one bit a square in a flat array only their thread
+/// touches. A cache line holds 512 squares of marks rather than 32 Squares,
+/// and no other thread ever writes to it. Every word carries the epoch it was
+/// last written in, so starting a new search forgets every old mark in O(1)
+/// and a stale word is only cleared once the new search writes to it.
+class Bit_marks {
+  public:
+    void
+    next_epoch(uint64_t rows, uint64_t cols) {
+        uint64_t const words = ((rows * cols) + word_bits - 1) / word_bits;
+        if (words != words_.size() || cols != cols_) {
+            words_.assign(words, 0);
+            epochs_.assign(words, 0);
+            cols_ = cols;
+            epoch_ = 1;
+            return;
+        }
+        if (++epoch_ == 0) {
+            std::fill(epochs_.begin(), epochs_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    void
+    mark(Point const &p) {
+        uint64_t const i = index(p);
+        uint64_t const w = i / word_bits;
+        if (epochs_[w] != epoch_) {
+            epochs_[w] = epoch_;
+            words_[w] = 0;
+        }
+        words_[w] |= uint64_t{1} << (i % word_bits);
+    }
+
+    bool
+    is_marked(Point const &p) const {
+        uint64_t const i = index(p);
+        uint64_t const w = i / word_bits;
+        return epochs_[w] == epoch_ && ((words_[w] >> (i % word_bits)) & 1U);
+    }
+
+    /// Calls visit with every marked square in row major order.
+    template <class Visit>
+    void
+    for_each(Visit visit) const {
+        for (uint64_t w = 0; w < words_.size(); ++w) {
+            if (epochs_[w] != epoch_) {
+                continue;
+            }
+            for (uint64_t bits = words_[w]; bits; bits &= bits - 1) {
+                uint64_t const i
+                    = (w * word_bits)
+                      + static_cast<uint64_t>(std::countr_zero(bits));
+                visit(Point{static_cast<int>(i / cols_),
+                            static_cast<int>(i % cols_)});
+            }
+        }
+    }
+
+  private:
+    static constexpr uint64_t word_bits = 64;
+    std::vector<uint64_t> words_;
+    std::vector<uint16_t> epochs_;
+    uint64_t cols_{0};
+    uint16_t epoch_{0};
+
+    uint64_t
+    index(Point const &p) const {
+        return (static_cast<uint64_t>(p.row) * cols_)
+               + static_cast<uint64_t>(p.col);
+    }
+};
+
 struct Maze_args {
     uint64_t odd_rows = 31;
     uint64_t odd_cols = 111;
@@ -133,6 +222,10 @@ class Maze {
     int row_size() const;
     int col_size() const;
     std::span<std::string_view const> wall_style() const;
+    /// Starts a new epoch in one set of visit marks per solver thread and
+    /// hands them out. They belong to the maze so solving it again reuses
+    /// their memory, and they are freed with it.
+    std::span<Bit_marks> next_thread_marks(uint64_t threads);
 
   private:
     int maze_row_size_;
@@ -141,8 +234,43 @@ class Maze {
     // []operators.
     std::vector<Square> maze_;
     int wall_style_index_;
+    std::vector<Bit_marks> thread_marks_;
+};
+
+/// Solvers and painters leave start, finish, thread paint, and thread cache
+/// bits behind. This clears them while keeping the walls and paths a builder
+/// made so the same maze can be solved again without rebuilding it.
+void clear_solver_marks(Maze &maze);
+
+/// Builders and solvers seed their generators from here. After a thread calls
+/// seed_thread every builder it runs draws from that seed, so the same seed and
+/// arguments always give the same maze, and solvers it runs pick the same
+/// starts and finishes. Other threads get fresh randomness every time.
+void seed_thread(uint64_t seed);
+uint32_t random_seed();
+
+/// Where static solves keep the squares each thread has visited. In grid
+/// every thread sets its own cache bit in the shared Squares, so threads
+/// exploring near each other write the same cache lines. In bits every thread
+/// keeps a private bitmap of one bit per square and only the paint reaches
+/// the maze, once the thread is done. Animations always use the grid so the
+/// frames can show what each thread has seen.
+enum class Visit_marks {
+    grid,
+    bits,
 };
 
+void set_visit_marks(Visit_marks marks);
+Visit_marks visit_marks();
+
+/// How many threads share one job in the solvers and painters that split
+/// their work instead of racing. Zero, the default, lets each choose: the
+/// steal solvers run one thread per color and the painters one per core once
+/// a maze is big enough to be worth splitting. Benchmarks set it to measure
+/// how a job scales.
+void set_team_workers(uint64_t workers);
+uint64_t team_workers();
+
 // Walls are constructed in terms of other walls they need to connect to. For
 // example, read 0b0011 as, "this is a wall square that must connect to other
 // walls to the East and North."
@@ -171,6 +299,7 @@ constexpr Square_bits path_bit{0b0010'0000'0000'0000};
 constexpr Square_bits clear_available_bits{0b0001'1111'1111'0000};
 constexpr Square_bits start_bit{0b0100'0000'0000'0000};
 constexpr Square_bits builder_bit{0b0001'0000'0000'0000};
+constexpr Square_bits solver_marks_mask{0b1100'1111'1111'0000};
 constexpr uint16_t marker_shift{4};
 constexpr Backtrack_marker markers_mask{0b1111'0000};
 constexpr Backtrack_marker is_origin{0b0000'0000};
@@ -238,6 +367,12 @@ constexpr std::array<Point, 8> all_dirs = {{
 
 /////////////////////////  Internal Implementations
 
+namespace {
+thread_local std::optional<std::mt19937_64> thread_seeds;
+std::atomic<Maze::Visit_marks> visit_marks_setting{Maze::Visit_marks::bits};
+std::atomic_uint64_t team_workers_setting{0};
+} // namespace
+
 namespace Maze {
 
 ///////////////////////  Square Implementation
@@ -380,6 +515,60 @@ Maze::wall_style() const {
     return {&wall_styles.at(wall_style_index_ * wall_row), wall_row};
 }
 
+std::span<Bit_marks>
+Maze::next_thread_marks(uint64_t threads) {
+    if (thread_marks_.size() < threads) {
+        thread_marks_.resize(threads);
+    }
+    for (uint64_t i = 0; i < threads; ++i) {
+        thread_marks_[i].next_epoch(static_cast<uint64_t>(maze_row_size_),
+                                    static_cast<uint64_t>(maze_col_size_));
+    }
+    return {thread_marks_.data(), threads};
+}
+
+void
+clear_solver_marks(Maze &maze) {
+    for (int row = 0; row < maze.row_size(); ++row) {
+        for (Square &square : maze[row]) {
+            square &= static_cast<Square_bits>(~solver_marks_mask);
+        }
+    }
+}
+
+void
+seed_thread(uint64_t seed) {
+    thread_seeds.emplace(seed);
+}
+
+uint32_t
+random_seed() {
+    if (thread_seeds) {
+        return static_cast<uint32_t>((*thread_seeds)());
+    }
+    return std::random_device{}();
+}
+
+void
+set_visit_marks(Visit_marks marks) {
+    visit_marks_setting.store(marks, std::memory_order_relaxed);
+}
+
+Visit_marks
+visit_marks() {
+    return visit_marks_setting.load(std::memory_order_relaxed);
+}
+
+void
+set_team_workers(uint64_t workers) {
+    team_workers_setting.store(workers, std::memory_order_relaxed);
+}
+
+uint64_t
+team_workers() {
+    return team_workers_setting.load(std::memory_order_relaxed);
+}
+
 bool
 operator==(Point const &lhs, Point const &rhs) {
     return lhs.row == rhs.row && lhs.col == rhs.col;
@@ -0,0 +1,283 @@
+/// File: stats.cc
+/// --------------
+/// Counters for the hot loops of builders, solvers, and painters. They answer
+/// whether a slow solve is spent fighting other threads over squares or doing
+/// more work than it had to. Every thread counts into its own Counters, padded
+/// to a cache line so no two threads write the same line, and nothing is
+/// shared until the counts are collected after the threads are joined.
+///
+/// Counting is only compiled in when MAZE_STATS is defined, which the build
+/// does with -DMAZE_STATS=ON. Otherwise every bump compiles to nothing and
+/// local() never touches thread local storage, so the squares, builders, and
+/// solvers pay nothing for counters no one will read.
+module;
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+export module labyrinth:stats;
+import :maze;
+
+/////////////////////////////////////   Exported Interface
+////////////////////////////////////////
+
+export namespace Stats {
+
+#ifdef MAZE_STATS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+constexpr uint64_t never = UINT64_MAX;
+
+/// A counter that does nothing unless counting is compiled in.
+class Count {
+  public:
+    Count &
+    operator++() {
+        if constexpr (enabled) {
+            ++n_;
+        }
+        return *this;
+    }
+
+    Count &
+    operator+=(uint64_t n) {
+        if constexpr (enabled) {
+            n_ += n;
+        }
+        return *this;
+    }
+
+    uint64_t
+    value() const {
+        return n_;
+    }
+
+  private:
+    uint64_t n_{0};
+};
+
+/// Loops take a reference from local() once and bump the fields directly.
+struct alignas(Maze::cache_line) Counters {
+    // Squares whose neighbors were looked at.
+    Count expanded{};
+    Count neighbor_checks{};
+    // Compare and swap calls on squares and how many lost to another writer.
+    Count cas_attempts{};
+    Count cas_failures{};
+    Count queue_growths{};
+    // Squares on the path this thread reported when it stopped.
+    uint64_t path_len{0};
+    // Nanoseconds from the last reset until this thread first found a finish.
+    uint64_t first_finish_ns{never};
+};
+
+/// Use local() instead. This is the thread local slot behind it.
+Counters &thread_counters();
+
+/// The calling thread's counters. They live as long as the thread does and
+/// are kept for collection when it exits. Without counting compiled in every
+/// thread shares one set that is never written.
+inline Counters &
+local() {
+    if constexpr (enabled) {
+        return thread_counters();
+    } else {
+        static constinit Counters unused{};
+        return unused;
+    }
+}
+
+inline void
+count_cas(bool swapped) {
+    if constexpr (enabled) {
+        Counters &c = local();
+        ++c.cas_attempts;
+        c.cas_failures += static_cast<uint64_t>(!swapped);
+    }
+}
+
+void reached_finish();
+
+/// Records how long a thread's path is when the scope holding it ends so every
+/// way out of a search loop is counted.
+template <class Path> class Path_scope {
+  public:
+    explicit Path_scope(Path const &path) : path_(path) {
+    }
+
+    Path_scope(Path_scope const &) = delete;
+    Path_scope &operator=(Path_scope const &) = delete;
+    Path_scope(Path_scope &&) = delete;
+    Path_scope &operator=(Path_scope &&) = delete;
+
+    ~Path_scope() {
+        if constexpr (enabled) {
+            local().path_len = path_.size();
+        }
+    }
+
+  private:
+    Path const &path_;
+};
+
+/// Forgets every count and restarts the clock. Call between phases while no
+/// other thread is counting.
+void reset();
+
+/// Every thread that counted since the last reset followed by the totals, as
+/// one JSON object on one line. Call after the counting threads are joined.
+void write_json(std::ostream &out, std::string_view phase);
+
+} // namespace Stats
+
+/////////////////////////////////////     Implementation
+////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Threads register their counters on first use. Solver threads are spawned
+/// fresh for every solve, so counters of threads that have exited are copied
+/// here before they go.
+struct Registry {
+    std::mutex lock;
+    std::vector<Stats::Counters *> live;
+    std::vector<Stats::Counters> exited;
+    std::atomic<Clock::rep> start{Clock::now().time_since_epoch().count()};
+};
+
+Registry &
+registry() {
+    static Registry r;
+    return r;
+}
+
+bool
+counted(Stats::Counters const &c) {
+    return c.expanded.value() || c.neighbor_checks.value()
+           || c.cas_attempts.value() || c.queue_growths.value() || c.path_len
+           || c.first_finish_ns != Stats::never;
+}
+
+class Slot {
+  public:
+    Slot() {
+        Registry &r = registry();
+        std::scoped_lock const lock(r.lock);
+        r.live.push_back(&counters);
+    }
+
+    Slot(Slot const &) = delete;
+    Slot &operator=(Slot const &) = delete;
+    Slot(Slot &&) = delete;
+    Slot &operator=(Slot &&) = delete;
+
+    ~Slot() {
+        Registry &r = registry();
+        std::scoped_lock const lock(r.lock);
+        std::erase(r.live, &counters);
+        if (counted(counters)) {
+            r.exited.push_back(counters);
+        }
+    }
+
+    Stats::Counters counters{};
+};
+
+thread_local Slot slot;
+
+void
+write_counters(std::ostream &out, Stats::Counters const &c) {
+    out << "{\"expanded\":" << c.expanded.value()
+        << ",\"neighbor_checks\":" << c.neighbor_checks.value()
+        << ",\"cas_attempts\":" << c.cas_attempts.value()
+        << ",\"cas_failures\":" << c.cas_failures.value()
+        << ",\"queue_growths\":" << c.queue_growths.value()
+        << ",\"path_len\":" << c.path_len << ",\"first_finish_ns\":"
+        << (c.first_finish_ns == Stats::never
+                ? std::string{"null"}
+                : std::to_string(c.first_finish_ns))
+        << "}";
+}
+
+} // namespace
+
+namespace Stats {
+
+Counters &
+thread_counters() {
+    return slot.counters;
+}
+
+void
+reached_finish() {
+    if constexpr (enabled) {
+        Counters &c = local();
+        if (c.first_finish_ns != never) {
+            return;
+        }
+        Clock::duration const since(registry().start.load());
+        c.first_finish_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now().time_since_epoch() - since)
+                .count());
+    }
+}
+
+void
+reset() {
+    Registry &r = registry();
+    std::scoped_lock const lock(r.lock);
+    r.exited.clear();
+    for (Counters *c : r.live) {
+        *c = Counters{};
+    }
+    r.start.store(Clock::now().time_since_epoch().count());
+}
+
+void
+write_json(std::ostream &out, std::string_view phase) {
+    Registry &r = registry();
+    std::scoped_lock const lock(r.lock);
+    Clock::duration const since(r.start.load());
+    auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch() - since);
+    std::vector<Counters> threads = r.exited;
+    for (Counters const *c : r.live) {
+        if (counted(*c)) {
+            threads.push_back(*c);
+        }
+    }
+    Counters total{};
+    for (Counters const &c : threads) {
+        total.expanded += c.expanded.value();
+        total.neighbor_checks += c.neighbor_checks.value();
+        total.cas_attempts += c.cas_attempts.value();
+        total.cas_failures += c.cas_failures.value();
+        total.queue_growths += c.queue_growths.value();
+        total.path_len += c.path_len;
+        total.first_finish_ns = std::min(total.first_finish_ns,
+                                         c.first_finish_ns);
+    }
+    out << "{\"phase\":\"" << phase << "\",\"elapsed_ns\":" << elapsed.count()
+        << ",\"total\":";
+    write_counters(out, total);
+    out << ",\"threads\":[";
+    for (uint64_t i = 0; i < threads.size(); ++i) {
+        out << (i ? "," : "");
+        write_counters(out, threads[i]);
+    }
+    out << "]}\n";
+}
+
+} // namespace Stats
@@ -0,0 +1,211 @@
+/// File: trace.cc
+/// --------------
+/// A timeline of where a run spends its time. A Scope marks a phase from the
+/// line it is declared until the end of its block, and each thread keeps its
+/// finished scopes in its own ring of the most recent events so nothing is
+/// shared while the maze is being worked on. The timeline is written as a
+/// Chrome trace that chrome://tracing or ui.perfetto.dev will open, with one
+/// row per thread so the solver threads can be seen overlapping.
+///
+/// Tracing is only compiled in when MAZE_TRACE is defined, which the build
+/// does with -DMAZE_TRACE=ON. Otherwise a Scope is empty and costs nothing.
+module;
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+export module labyrinth:trace;
+
+/////////////////////////////////////   Exported Interface
+////////////////////////////////////////
+
+export namespace Trace {
+
+#ifdef MAZE_TRACE
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+/// The oldest events of a thread are overwritten once it has this many.
+constexpr uint64_t ring_size = uint64_t{1} << 14;
+
+/// Nanoseconds since the program started tracing.
+int64_t now();
+void record(char const *name, int64_t start_ns);
+
+/// Names must be string literals because only the pointer is kept.
+class Scope {
+  public:
+    explicit Scope(char const *name) : name_(name) {
+        if constexpr (enabled) {
+            start_ns_ = now();
+        }
+    }
+
+    Scope(Scope const &) = delete;
+    Scope &operator=(Scope const &) = delete;
+    Scope(Scope &&) = delete;
+    Scope &operator=(Scope &&) = delete;
+
+    ~Scope() {
+        if constexpr (enabled) {
+            record(name_, start_ns_);
+        }
+    }
+
+  private:
+    [[maybe_unused]] char const *name_;
+    [[maybe_unused]] int64_t start_ns_{0};
+};
+
+/// Every event recorded so far as a Chrome trace. Call after the traced
+/// threads are joined.
+void write_json(std::ostream &out);
+
+} // namespace Trace
+
+/////////////////////////////////////     Implementation
+////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+    char const *name;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+struct Ring {
+    uint64_t tid{0};
+    uint64_t recorded{0};
+    std::unique_ptr<std::array<Event, Trace::ring_size>> events{
+        std::make_unique<std::array<Event, Trace::ring_size>>()};
+
+    void
+    push(Event const &e) {
+        (*events)[recorded % Trace::ring_size] = e;
+        ++recorded;
+    }
+
+    // Oldest first, which is the order the scopes ended in.
+    void
+    copy_to(std::vector<Event> &out) const {
+        uint64_t const kept = std::min(recorded, Trace::ring_size);
+        for (uint64_t i = recorded - kept; i < recorded; ++i) {
+            out.push_back((*events)[i % Trace::ring_size]);
+        }
+    }
+};
+
+struct Thread_events {
+    uint64_t tid;
+    std::vector<Event> events;
+};
+
+/// Threads register their ring on their first event. Solver threads are gone
+/// by the time the trace is written, so their events are copied here first.
+struct Registry {
+    std::mutex lock;
+    uint64_t next_tid{0};
+    std::vector<Ring *> live;
+    std::vector<Thread_events> exited;
+    Clock::time_point start{Clock::now()};
+};
+
+Registry &
+registry() {
+    static Registry r;
+    return r;
+}
+
+class Slot {
+  public:
+    Slot() {
+        Registry &r = registry();
+        std::scoped_lock const lock(r.lock);
+        ring.tid = r.next_tid++;
+        r.live.push_back(&ring);
+    }
+
+    Slot(Slot const &) = delete;
+    Slot &operator=(Slot const &) = delete;
+    Slot(Slot &&) = delete;
+    Slot &operator=(Slot &&) = delete;
+
+    ~Slot() {
+        Registry &r = registry();
+        std::scoped_lock const lock(r.lock);
+        std::erase(r.live, &ring);
+        Thread_events done{ring.tid, {}};
+        ring.copy_to(done.events);
+        r.exited.push_back(std::move(done));
+    }
+
+    Ring ring{};
+};
+
+thread_local Slot slot;
+
+// Chrome traces count in microseconds and keep the fraction.
+void
+write_us(std::ostream &out, int64_t ns) {
+    int64_t const frac = ns % 1000;
+    out << ns / 1000 << '.' << (frac < 100 ? "0" : "") << (frac < 10 ? "0" : "")
+        << frac;
+}
+
+void
+write_events(std::ostream &out, Thread_events const &thread, bool &first) {
+    for (Event const &e : thread.events) {
+        out << (first ? "\n" : ",\n") << R"({"name":")" << e.name
+            << R"(","ph":"X","pid":1,"tid":)" << thread.tid << R"(,"ts":)";
+        write_us(out, e.start_ns);
+        out << R"(,"dur":)";
+        write_us(out, e.end_ns - e.start_ns);
+        out << "}";
+        first = false;
+    }
+}
+
+} // namespace
+
+namespace Trace {
+
+int64_t
+now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now() - registry().start)
+        .count();
+}
+
+void
+record(char const *name, int64_t start_ns) {
+    slot.ring.push({name, start_ns, now()});
+}
+
+void
+write_json(std::ostream &out) {
+    Registry &r = registry();
+    std::scoped_lock const lock(r.lock);
+    std::vector<Thread_events> threads = r.exited;
+    for (Ring const *ring : r.live) {
+        Thread_events t{ring->tid, {}};
+        ring->copy_to(t.events);
+        threads.push_back(std::move(t));
+    }
+    out << R"({"displayTimeUnit":"ns","traceEvents":[)";
+    bool first = true;
+    for (Thread_events const &t : threads) {
+        write_events(out, t, first);
+    }
+    out << "\n]}\n";
+}
+
+} // namespace Trace
@@ -1,5 +1,6 @@
 import labyrinth;
 #include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <optional>
@@ -18,10 +19,15 @@ using Build_function
 
 using Paint_function
     = std::tuple<std::function<void(Maze::Maze &)>,
-                 std::function<void(Maze::Maze &, Speed::Speed)>>;
+                 std::function<void(Maze::Maze &, Speed::Speed)>,
+                 std::function<void(Maze::Maze &, std::string const &)>>;
 
 constexpr int static_image = 0;
 constexpr int animated_playback = 1;
+constexpr int image_file = 2;
+
+// Painters print their closing message below the maze.
+constexpr int cast_footer_height = 10;
 
 struct Flag_arg {
     std::string_view flag;
@@ -42,7 +48,13 @@ struct Maze_runner {
     int painter_view{static_image};
     Speed::Speed painter_speed{};
     Paint_function painter{Distance::paint_distance_from_center,
-                           Distance::animate_distance_from_center};
+                           Distance::animate_distance_from_center,
+                           Distance::image_distance_from_center};
+
+    std::optional<std::string> cast_path;
+    Printer::View view{Printer::View::overview};
+    std::optional<std::string> image_path;
+    std::optional<std::string> stats_path;
     Maze_runner() : args{} {
     }
 };
@@ -53,6 +65,7 @@ struct Lookup_tables {
     std::unordered_map<std::string, Build_function> modification_table;
     std::unordered_map<std::string, Paint_function> painter_table;
     std::unordered_map<std::string, Maze::Maze_style> style_table;
+    std::unordered_map<std::string, Printer::View> view_table;
     std::unordered_map<std::string, Speed::Speed> painter_animation_table;
     std::unordered_map<std::string, Speed::Speed> builder_animation_table;
 };
@@ -69,7 +82,7 @@ void print_usage();
 int
 main(int argc, char **argv) {
     Lookup_tables const tables = {
-        .argument_flags={"-r", "-c", "-b", "-p", "-h", "-g", "-d", "-m", "-pa", "-ba"},
+        .argument_flags={"-r", "-c", "-b", "-p", "-h", "-g", "-d", "-m", "-pa", "-ba", "-rec", "-img", "-v", "-stats"},
         .builder_table={
             {"rdfs",
              {Recursive_backtracker::generate_maze,
@@ -96,8 +109,9 @@ main(int argc, char **argv) {
         .painter_table={
             {"distance",
              {Distance::paint_distance_from_center,
-              Distance::animate_distance_from_center}},
-            {"runs", {Runs::paint_runs, Runs::animate_runs}},
+              Distance::animate_distance_from_center,
+              Distance::image_distance_from_center}},
+            {"runs", {Runs::paint_runs, Runs::animate_runs, Runs::image_runs}},
         },
         .style_table={
             {"sharp", Maze::Maze_style::sharp},
@@ -107,6 +121,10 @@ main(int argc, char **argv) {
             {"contrast", Maze::Maze_style::contrast},
             {"spikes", Maze::Maze_style::spikes},
         },
+        .view_table={
+            {"overview", Printer::View::overview},
+            {"follow", Printer::View::follow},
+        },
         .painter_animation_table={
             {"0", Speed::Speed::instant},
             {"1", Speed::Speed::speed_1},
@@ -158,6 +176,28 @@ main(int argc, char **argv) {
 
     Maze::Maze maze(runner.args);
 
+    Printer::set_view(runner.view);
+
+    // Animations write to the cast instead of the terminal while this is alive
+    // and run as fast as they can be computed.
+    std::optional<Recorder::Recording> recording;
+    if (runner.cast_path) {
+        recording.emplace(*runner.cast_path, maze.col_size(),
+                          maze.row_size() + cast_footer_height);
+    }
+
+    // One line of counters for the build and one for the paint.
+    std::optional<std::ofstream> stats;
+    if (runner.stats_path) {
+        stats.emplace(*runner.stats_path);
+        if (!*stats) {
+            std::cerr << "Could not open stats file " << *runner.stats_path
+                      << "\n";
+            std::exit(1);
+        }
+    }
+    Stats::reset();
+
     // Functions are stored in tuples so use tuple get syntax and then call them
     // immidiately.
 
@@ -174,15 +214,25 @@ main(int argc, char **argv) {
         }
     }
 
+    if (stats) {
+        Stats::write_json(*stats, "build");
+    }
+    Stats::reset();
+
     // This helps ensure we have a smooth transition from build to solve with no
     // flashing from redrawing frame.
     Printer::set_cursor_position({.row = 0, .col = 0});
 
-    if (runner.painter_view == animated_playback) {
+    if (runner.image_path) {
+        std::get<image_file>(runner.painter)(maze, *runner.image_path);
+    } else if (runner.painter_view == animated_playback) {
         std::get<animated_playback>(runner.painter)(maze, runner.painter_speed);
     } else {
         std::get<static_image>(runner.painter)(maze);
     }
+    if (stats) {
+        Stats::write_json(*stats, "paint");
+    }
     return 0;
 }
 
@@ -251,6 +301,31 @@ set_relevant_arg(Lookup_tables const &tables, Maze_runner &runner,
         runner.modification_getter = animated_playback;
         return;
     }
+    if (pairs.flag == "-v") {
+        auto const found = tables.view_table.find(arg_data);
+        if (found == tables.view_table.end()) {
+            print_invalid_arg(pairs);
+        }
+        runner.view = found->second;
+        return;
+    }
+    if (pairs.flag == "-rec") {
+        runner.cast_path = arg_data;
+        return;
+    }
+    if (pairs.flag == "-img") {
+        runner.image_path = arg_data;
+        return;
+    }
+    if (pairs.flag == "-stats") {
+        if (!Stats::enabled) {
+            std::cerr << "Counting is compiled out. Configure the build with "
+                         "-DMAZE_STATS=ON to use -stats.\n";
+            std::exit(1);
+        }
+        runner.stats_path = arg_data;
+        return;
+    }
     print_invalid_arg(pairs);
 }
 
@@ -325,6 +400,15 @@ print_usage() {
     │ │ ╵ │ ╶─┤ Any number 1-7. Speed increases with number.┌─┘ ┌─┤ ╵ │ ╶─┤
     │ │   │   -ba Builder Animation flag. Watch the maze build. │ │   │   │
     │ ├─╴ ├─┐ └─Any number 1-7. Speed increases with number.┘ ┌─┘ │ ┌─┴─┐ │
+    │ │   │ │ -rec Record flag. Save it to a file.    │   │   │   │ │   │ │
+    │ │   │ │ Any file name. Play with ./replay.      │   │   │   │ │   │ │
+    │ │   │ │ -img Image flag. Paint to an image.     │   │   │   │ │   │ │
+    │ │   │ │ File name ending .png or .ppm.          │   │   │   │ │   │ │
+    │ │   │ │ -stats Stats flag. Count work per thread│   │   │   │ │   │ │
+    │ │   │ │ Any file name. Needs MAZE_STATS.        │   │   │   │ │   │ │
+    │ │   │ │ -v View flag. For mazes over the screen.│   │   │   │ │   │ │
+    │ │   │ │ overview - The whole maze in blocks.    │   │   │   │ │   │ │
+    │ │   │ │ follow - Pan after the busiest thread.  │   │   │   │ │   │ │
     │ │   │ │ -h Help flag. Make this prompt appear.  │   │   │   │ │   │ │
     │ └─┐ ╵ └─┐ No arguments.─┘ ┌───┐ └─┐ ├─╴ │ ╵ └───┤ ┌─┘ ┌─┴─╴ │ ├─╴ │ │
     │   │     -If any flags are omitted, defaults are used. │     │ │   │ │
@@ -1,8 +1,15 @@
 export module labyrinth;
 
 export import :maze;
+export import :stats;
+export import :trace;
+export import :my_queue;
+export import :mpmc_queue;
 export import :speed;
 export import :printers;
+export import :recorder;
+export import :image;
+export import :svg;
 export import :arena;
 export import :grid;
 export import :eller;
@@ -18,8 +25,12 @@ export import :bfs;
 export import :floodfs;
 export import :rdfs;
 export import :dark_floodfs;
+export import :dead_end;
 export import :dark_dfs;
 export import :dark_bfs;
 export import :dark_rdfs;
+export import :steal;
+export import :junction;
+export import :batch;
 export import :distance;
 export import :runs;
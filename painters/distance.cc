@@ -1,20 +1,21 @@
 module;
 #include <algorithm>
 #include <array>
-#include <chrono>
+#include <atomic>
+#include <barrier>
 #include <cstdint>
 #include <functional>
 #include <iostream>
-#include <random>
+#include <iterator>
+#include <span>
+#include <string>
 #include <thread>
-#include <unordered_map>
-#include <unordered_set>
+#include <vector>
 export module labyrinth:distance;
 import :maze;
+import :stats;
 import :speed;
-import :rgb;
-import :my_queue;
-import :printers;
+import :metric;
 
 /////////////////////////////////////   Exported Interface
 ////////////////////////////////////////
@@ -22,6 +23,21 @@ import :printers;
 export namespace Distance {
 void paint_distance_from_center(Maze::Maze &maze);
 void animate_distance_from_center(Maze::Maze &maze, Speed::Speed speed);
+/// Paints to a PNG or PPM file rather than the terminal for mazes too large to
+/// print.
+void image_distance_from_center(Maze::Maze &maze, std::string const &path);
+
+/// Every square is colored by its distance to the nearest source, so many
+/// sources show which one each part of the maze is closest to. Sources that
+/// are outside the maze or not open squares are ignored.
+void paint_distance_from(Maze::Maze &maze,
+                         std::span<Maze::Point const> sources);
+void animate_distance_from(Maze::Maze &maze,
+                           std::span<Maze::Point const> sources,
+                           Speed::Speed speed);
+void image_distance_from(Maze::Maze &maze,
+                         std::span<Maze::Point const> sources,
+                         std::string const &path);
 } // namespace Distance
 
 /////////////////////////////////////     Implementation
@@ -29,97 +45,162 @@ void animate_distance_from_center(Maze::Maze &maze, Speed::Speed speed);
 
 namespace {
 
-struct Distance_map {
-    uint64_t max;
-    std::unordered_map<Maze::Point, uint64_t> distances;
-    Distance_map(Maze::Point p, uint64_t const dist)
-        : max(dist), distances({{p, dist}}) {
-    }
-};
+// Callers may hand us any point so it is checked against the maze bounds
+// before its square is read.
+bool
+open_square(Maze::Maze const &maze, Maze::Point const &p) {
+    return p.row >= 0 && p.row < maze.row_size() && p.col >= 0
+           && p.col < maze.col_size() && (maze[p.row][p.col] & Maze::path_bit);
+}
 
-struct Point_dist {
-    Maze::Point p;
-    uint64_t dist;
-};
+// Corridors keep most frontiers narrow. Those are cheaper for one thread to
+// grow than for every thread to meet at a barrier over.
+constexpr uint64_t parallel_frontier = 4096;
+constexpr uint64_t frontier_chunk = 512;
 
-void
-painter(Maze::Maze &maze, Distance_map const &map) {
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<int> uid(0, 2);
-    int const rand_color_choice = uid(rng);
-    for (int row = 0; row < maze.row_size(); row++) {
-        for (int col = 0; col < maze.col_size(); col++) {
-            Maze::Point const cur = {row, col};
-            auto const path_point = map.distances.find(cur);
-            if (path_point != map.distances.end()) {
-                auto const intensity
-                    = static_cast<double>(map.max - path_point->second)
-                      / static_cast<double>(map.max);
-                auto const dark = static_cast<uint8_t>(255.0 * intensity);
-                auto const bright = static_cast<uint8_t>(128)
-                                    + static_cast<uint8_t>(127.0 * intensity);
-                Rgb::Rgb color{dark, dark, dark};
-                color.at(rand_color_choice) = bright;
-                Rgb::print_rgb(color, cur);
-            } else {
-                Rgb::print_wall(maze, cur);
+/// A level synchronous breadth first search. Each level's frontier is cut into
+/// chunks that workers claim, and a square goes to whichever worker wins the
+/// compare and swap on its distance. The last worker to reach the barrier
+/// gathers the next frontier and keeps growing it alone while it is narrow.
+class Frontier_bfs {
+  public:
+    Frontier_bfs(Maze::Maze const &maze, Metric::Field &field,
+                 uint64_t workers)
+        : maze_(maze), field_(field), workers_(workers), next_(workers) {
+    }
+
+    void
+    run(std::span<Maze::Point const> sources) {
+        for (Maze::Point const &p : sources) {
+            if (open_square(maze_, p) && field_.at(p) == Metric::unmeasured) {
+                field_.values[field_.cell(p)] = 0;
+                frontier_.push_back(p);
             }
         }
+        if (frontier_.empty()) {
+            std::cerr << "Distance needs at least one open square to start.\n";
+            std::abort();
+        }
+        field_.measured = frontier_.size();
+        grow_narrow_levels();
+        if (frontier_.empty()) {
+            return;
+        }
+        Level_barrier levels(static_cast<std::ptrdiff_t>(workers_),
+                             Next_level{this});
+        std::vector<std::thread> threads;
+        threads.reserve(workers_ - 1);
+        for (uint64_t w = 1; w < workers_; ++w) {
+            threads.emplace_back(&Frontier_bfs::work, this, w,
+                                 std::ref(levels));
+        }
+        work(0, levels);
+        for (std::thread &t : threads) {
+            t.join();
+        }
     }
-    std::cout << "\n";
-}
 
-void
-painter_animated(Maze::Maze &maze, Distance_map const &map,
-                 Rgb::Bfs_monitor &monitor, Rgb::Thread_guide guide) {
-    My_queue<Maze::Point> &bfs = monitor.paths[guide.bias];
-    std::unordered_set<Maze::Point> &seen = monitor.seen[guide.bias];
-    bfs.push(guide.p);
-    while (!bfs.empty()) {
-        Maze::Point const cur = bfs.front();
-        bfs.pop();
-
-        if (monitor.count.load() >= map.distances.size()) {
-            return;
+  private:
+    struct Next_level {
+        Frontier_bfs *bfs;
+
+        void
+        operator()() const noexcept {
+            bfs->next_level();
         }
+    };
+    using Level_barrier = std::barrier<Next_level>;
+
+    Maze::Maze const &maze_;
+    Metric::Field &field_;
+    uint64_t workers_;
+    uint32_t depth_{0};
+    std::vector<Maze::Point> frontier_{};
+    std::vector<std::vector<Maze::Point>> next_;
+    std::atomic_uint64_t next_chunk_{0};
 
-        uint16_t const square = maze[cur.row][cur.col].load();
-        uint16_t const painted = (square | Rgb::paint);
-        uint16_t const not_painted
-            = square & static_cast<uint16_t>(~Rgb::paint);
-        if (maze[cur.row][cur.col].ces(not_painted, painted)) {
-            uint64_t const dist = map.distances.at(cur);
-            auto const intensity = static_cast<double>(map.max - dist)
-                                   / static_cast<double>(map.max);
-            auto const dark = static_cast<uint8_t>(255.0 * intensity);
-            auto const bright = static_cast<uint8_t>(128)
-                                + static_cast<uint8_t>(127.0 * intensity);
-            Rgb::Rgb color{dark, dark, dark};
-            color.at(guide.color_i) = bright;
-
-            monitor.monitor.lock();
-            Rgb::animate_rgb(color, cur);
-            monitor.monitor.unlock();
-
-            ++monitor.count;
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(guide.animation));
+    void
+    work(uint64_t worker, Level_barrier &levels) {
+        while (!frontier_.empty()) {
+            for (uint64_t first = next_chunk_.fetch_add(
+                     frontier_chunk, std::memory_order_relaxed);
+                 first < frontier_.size();
+                 first = next_chunk_.fetch_add(frontier_chunk,
+                                               std::memory_order_relaxed)) {
+                uint64_t const last
+                    = std::min(first + frontier_chunk, frontier_.size());
+                for (uint64_t i = first; i < last; ++i) {
+                    expand(frontier_[i], next_[worker]);
+                }
+            }
+            levels.arrive_and_wait();
         }
+    }
 
-        for (uint64_t count = 0, i = guide.bias; count < Maze::dirs.size();
-             count++, ++i %= Maze::dirs.size()) {
-            Maze::Point const &p = Maze::dirs.at(i);
-            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
+    // Runs alone on the last worker to arrive while the rest wait.
+    void
+    next_level() noexcept {
+        frontier_.clear();
+        for (std::vector<Maze::Point> &found : next_) {
+            frontier_.insert(frontier_.end(), found.begin(), found.end());
+            found.clear();
+        }
+        settle_level();
+        grow_narrow_levels();
+        next_chunk_.store(0, std::memory_order_relaxed);
+    }
+
+    void
+    grow_narrow_levels() {
+        while (!frontier_.empty()
+               && (workers_ == 1 || frontier_.size() < parallel_frontier)) {
+            std::vector<Maze::Point> &found = next_.front();
+            for (Maze::Point const &p : frontier_) {
+                expand(p, found);
+            }
+            frontier_.swap(found);
+            found.clear();
+            settle_level();
+        }
+    }
 
-            bool const is_path
-                = (maze[next.row][next.col] & Maze::path_bit).load();
+    void
+    settle_level() {
+        ++depth_;
+        field_.measured += frontier_.size();
+    }
 
-            if (is_path && !seen.contains(next)) {
-                bfs.push(next);
-                seen.insert(next);
+    void
+    expand(Maze::Point const &cur, std::vector<Maze::Point> &found) {
+        Stats::Counters &stats = Stats::local();
+        ++stats.expanded;
+        for (Maze::Point const &d : Maze::dirs) {
+            ++stats.neighbor_checks;
+            Maze::Point const next = {cur.row + d.row, cur.col + d.col};
+            if (!(maze_[next.row][next.col] & Maze::path_bit)) {
+                continue;
+            }
+            std::atomic_ref<uint32_t> dist(field_.values[field_.cell(next)]);
+            uint32_t expected = Metric::unmeasured;
+            if (dist.load(std::memory_order_relaxed) != Metric::unmeasured) {
+                continue;
+            }
+            bool const claimed = dist.compare_exchange_strong(
+                expected, depth_ + 1, std::memory_order_relaxed);
+            Stats::count_cas(claimed);
+            if (claimed) {
+                found.push_back(next);
             }
         }
     }
+};
+
+Metric::Field
+map_distances(Maze::Maze const &maze, std::span<Maze::Point const> sources) {
+    Metric::Field field(maze);
+    Frontier_bfs(maze, field, Metric::workers_for(field.values.size()))
+        .run(sources);
+    return field;
 }
 
 } // namespace
@@ -128,79 +209,48 @@ namespace Distance {
 
 void
 paint_distance_from_center(Maze::Maze &maze) {
-    int const row_mid = maze.row_size() / 2;
-    int const col_mid = maze.col_size() / 2;
-    Maze::Point const start
-        = {row_mid + 1 - (row_mid % 2), col_mid + 1 - (col_mid % 2)};
-    Distance_map map(start, 0);
-    My_queue<Point_dist> bfs;
-    bfs.push({start, 0});
-    maze[start.row][start.col] |= Rgb::measure;
-    while (!bfs.empty()) {
-        Point_dist const cur = bfs.front();
-        bfs.pop();
-        map.max = std::max(map.max, cur.dist);
-        for (Maze::Point const &p : Maze::dirs) {
-            Maze::Point const next = {cur.p.row + p.row, cur.p.col + p.col};
-            if (!(maze[next.row][next.col] & Maze::path_bit)
-                || (maze[next.row][next.col] & Rgb::measure)) {
-                continue;
-            }
-            maze[next.row][next.col] |= Rgb::measure;
-            map.distances.insert({next, cur.dist + 1});
-            bfs.push({next, cur.dist + 1});
-        }
-    }
-    painter(maze, map);
-    std::cout << "\n";
+    std::array<Maze::Point, 1> const start{Metric::center_source(maze)};
+    paint_distance_from(maze, start);
 }
 
 void
 animate_distance_from_center(Maze::Maze &maze, Speed::Speed speed) {
-    int const row_mid = maze.row_size() / 2;
-    int const col_mid = maze.col_size() / 2;
-    Maze::Point const start
-        = {row_mid + 1 - (row_mid % 2), col_mid + 1 - (col_mid % 2)};
-    Distance_map map(start, 0);
-    My_queue<Point_dist> bfs;
-    bfs.push({start, 0});
-    maze[start.row][start.col] |= Rgb::measure;
-    while (!bfs.empty()) {
-        Point_dist const cur = bfs.front();
-        bfs.pop();
-        map.max = std::max(map.max, cur.dist);
-        for (Maze::Point const &p : Maze::dirs) {
-            Maze::Point const next = {cur.p.row + p.row, cur.p.col + p.col};
-            if (!(maze[next.row][next.col] & Maze::path_bit)
-                || (maze[next.row][next.col] & Rgb::measure)) {
-                continue;
-            }
-            maze[next.row][next.col] |= Rgb::measure;
-            map.distances.insert({next, cur.dist + 1});
-            bfs.push({next, cur.dist + 1});
-        }
-    }
+    std::array<Maze::Point, 1> const start{Metric::center_source(maze)};
+    animate_distance_from(maze, start, speed);
+}
 
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<uint64_t> uid(0, 2);
-    uint64_t const rand_color_choice = uid(rng);
-    std::array<std::thread, Rgb::num_painters> handles;
-    Speed::Speed_unit const animation
-        = Rgb::animation_speeds.at(static_cast<uint64_t>(speed));
-    Rgb::Bfs_monitor monitor;
-    for (uint64_t i = 0; i < handles.size(); i++) {
-        Rgb::Thread_guide const this_thread
-            = {i, rand_color_choice, animation, start};
-        handles.at(i)
-            = std::thread(painter_animated, std::ref(maze), std::ref(map),
-                          std::ref(monitor), this_thread);
-    }
+void
+image_distance_from_center(Maze::Maze &maze, std::string const &path) {
+    std::array<Maze::Point, 1> const start{Metric::center_source(maze)};
+    image_distance_from(maze, start, path);
+}
 
-    for (std::thread &t : handles) {
-        t.join();
-    }
-    Printer::set_cursor_position({maze.row_size(), maze.col_size()});
-    std::cout << "\n";
+void
+paint_distance_from(Maze::Maze &maze, std::span<Maze::Point const> sources) {
+    Metric::Field const field = map_distances(maze, sources);
+    Metric::paint(maze, field, Metric::min_max(field), Metric::heat_palette());
+}
+
+void
+animate_distance_from(Maze::Maze &maze, std::span<Maze::Point const> sources,
+                      Speed::Speed speed) {
+    Metric::Field const field = map_distances(maze, sources);
+    // The painters start from the sources so they only get the usable ones.
+    std::vector<Maze::Point> open_sources;
+    std::ranges::copy_if(sources, std::back_inserter(open_sources),
+                         [&maze](Maze::Point const &p) {
+                             return open_square(maze, p);
+                         });
+    Metric::animate(maze, field, Metric::min_max(field),
+                    Metric::heat_palette(), open_sources, speed);
+}
+
+void
+image_distance_from(Maze::Maze &maze, std::span<Maze::Point const> sources,
+                    std::string const &path) {
+    Metric::Field const field = map_distances(maze, sources);
+    Metric::image(maze, field, Metric::min_max(field), Metric::heat_palette(),
+                  path);
 }
 
 } // namespace Distance
@@ -0,0 +1,381 @@
+/// File: metric.cc
+/// ---------------
+/// Every painter is the same three stages. A metric fills a Field with one
+/// value per square. Normalizing picks the Range of values that spans the
+/// colors, either the smallest and largest or a pair of percentiles. Each
+/// value is then cut to one of 256 levels and drawn with that level's entry
+/// in a Palette, which holds the color and its escape already encoded, so the
+/// terminal frame, the animation, and the image file all color a square with
+/// a table lookup. A new painter only has to write its metric.
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+module labyrinth:metric;
+import :maze;
+import :stats;
+import :speed;
+import :rgb;
+import :my_queue;
+import :printers;
+import :render;
+import :image;
+
+namespace Metric {
+
+constexpr uint32_t unmeasured = UINT32_MAX;
+constexpr uint64_t palette_size = 256;
+constexpr uint32_t top_level = palette_size - 1;
+// Smaller fields are finished before a second thread could even start.
+constexpr uint64_t parallel_squares = uint64_t{1} << 18;
+// Percentiles are found to within one of this many equal slices of the range.
+constexpr uint64_t histogram_bins = uint64_t{1} << 16;
+// Animated painters sum every painter's count only once per this many squares.
+constexpr uint64_t painted_poll = 256;
+
+/// One value per square, row major. Walls and squares the metric never reached
+/// stay unmeasured and are drawn as the maze.
+struct Field {
+    int cols;
+    uint64_t measured;
+    std::vector<uint32_t> values;
+
+    explicit Field(Maze::Maze const &maze)
+        : cols(maze.col_size()), measured(0),
+          values(static_cast<uint64_t>(maze.row_size())
+                     * static_cast<uint64_t>(maze.col_size()),
+                 unmeasured) {
+    }
+
+    uint64_t
+    cell(Maze::Point const &p) const {
+        return (static_cast<uint64_t>(p.row) * static_cast<uint64_t>(cols))
+               + static_cast<uint64_t>(p.col);
+    }
+
+    uint32_t
+    at(Maze::Point const &p) const {
+        return values[cell(p)];
+    }
+};
+
+/// Values at or below low get the first color and at or above high the last.
+struct Range {
+    uint32_t low;
+    uint32_t high;
+};
+
+/// The 256 colors a field is drawn with, each with its terminal escape.
+struct Palette {
+    std::array<Rgb::Rgb, palette_size> colors;
+    std::array<Rgb::Rgb_bytes, palette_size> escapes;
+    std::array<uint8_t, palette_size> escape_sizes;
+
+    std::string_view
+    escape(uint8_t level) const {
+        return {escapes.at(level).data(), escape_sizes.at(level)};
+    }
+};
+
+/// The open square nearest the middle, where painters measure from when not
+/// given a source. Open squares sit at odd rows and columns.
+Maze::Point
+center_source(Maze::Maze const &maze) {
+    int const row_mid = maze.row_size() / 2;
+    int const col_mid = maze.col_size() / 2;
+    return {row_mid + 1 - (row_mid % 2), col_mid + 1 - (col_mid % 2)};
+}
+
+uint64_t
+workers_for(uint64_t squares) {
+    if (uint64_t const workers = Maze::team_workers()) {
+        return workers;
+    }
+    return squares < parallel_squares
+               ? 1
+               : std::max<uint64_t>(std::thread::hardware_concurrency(), 1);
+}
+
+/// Calls work(first, last, worker) over even slices of [0, size), one slice
+/// to a thread, and returns once every slice is done.
+template <class Work>
+void
+for_slices(uint64_t size, uint64_t workers, Work const &work) {
+    uint64_t const slice = (size + workers - 1) / workers;
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (uint64_t w = 1; w < workers; ++w) {
+        threads.emplace_back([&work, w, slice, size]() {
+            work(std::min(w * slice, size), std::min((w + 1) * slice, size),
+                 w);
+        });
+    }
+    work(0, std::min(slice, size), 0);
+    for (std::thread &t : threads) {
+        t.join();
+    }
+}
+
+Range
+min_max(Field const &field) {
+    uint64_t const workers = workers_for(field.values.size());
+    std::vector<Range> ranges(workers, {unmeasured, 0});
+    for_slices(field.values.size(), workers,
+               [&](uint64_t first, uint64_t last, uint64_t w) {
+                   Range range{unmeasured, 0};
+                   for (uint64_t i = first; i < last; ++i) {
+                       uint32_t const v = field.values[i];
+                       if (v != unmeasured) {
+                           range.low = std::min(range.low, v);
+                           range.high = std::max(range.high, v);
+                       }
+                   }
+                   ranges[w] = range;
+               });
+    Range range{unmeasured, 0};
+    for (Range const &r : ranges) {
+        range.low = std::min(range.low, r.low);
+        range.high = std::max(range.high, r.high);
+    }
+    if (range.low == unmeasured) {
+        return {0, 0};
+    }
+    return range;
+}
+
+/// Fractions run from 0 to 1. Every thread fills its own histogram of the
+/// values and the sums are walked once to find both bounds.
+Range
+percentiles(Field const &field, double lower, double upper) {
+    Range const full = min_max(field);
+    uint64_t const span = static_cast<uint64_t>(full.high - full.low) + 1;
+    uint64_t const width = (span + histogram_bins - 1) / histogram_bins;
+    uint64_t const bins = (span + width - 1) / width;
+    uint64_t const workers = workers_for(field.values.size());
+    std::vector<std::vector<uint64_t>> histograms(
+        workers, std::vector<uint64_t>(bins, 0));
+    for_slices(field.values.size(), workers,
+               [&](uint64_t first, uint64_t last, uint64_t w) {
+                   std::vector<uint64_t> &histogram = histograms[w];
+                   for (uint64_t i = first; i < last; ++i) {
+                       uint32_t const v = field.values[i];
+                       if (v != unmeasured) {
+                           ++histogram[(v - full.low) / width];
+                       }
+                   }
+               });
+    for (uint64_t w = 1; w < workers; ++w) {
+        for (uint64_t b = 0; b < bins; ++b) {
+            histograms.front()[b] += histograms[w][b];
+        }
+    }
+    uint64_t total = 0;
+    for (uint64_t const count : histograms.front()) {
+        total += count;
+    }
+    auto const lower_rank
+        = static_cast<uint64_t>(lower * static_cast<double>(total));
+    auto const upper_rank
+        = static_cast<uint64_t>(upper * static_cast<double>(total));
+    Range range = full;
+    bool found_low = false;
+    uint64_t seen = 0;
+    for (uint64_t b = 0; b < bins; ++b) {
+        seen += histograms.front()[b];
+        auto const bin_low = static_cast<uint32_t>(full.low + (b * width));
+        if (!found_low && seen > lower_rank) {
+            range.low = bin_low;
+            found_low = true;
+        }
+        if (seen >= upper_rank && seen) {
+            range.high = static_cast<uint32_t>(
+                std::min<uint64_t>(bin_low + width - 1, full.high));
+            break;
+        }
+    }
+    range.high = std::max(range.high, range.low);
+    return range;
+}
+
+/// The level of every square in one pass with no branches so it vectorizes.
+/// Unmeasured squares get a level too and callers skip them.
+std::vector<uint8_t>
+quantize(Field const &field, Range const &range) {
+    std::vector<uint8_t> levels(field.values.size());
+    double const span = std::max<double>(range.high - range.low, 1.0);
+    for_slices(field.values.size(), workers_for(field.values.size()),
+               [&](uint64_t first, uint64_t last, uint64_t) {
+                   uint32_t const *const values = field.values.data();
+                   uint8_t *const out = levels.data();
+                   for (uint64_t i = first; i < last; ++i) {
+                       uint32_t const clamped
+                           = std::clamp(values[i], range.low, range.high)
+                             - range.low;
+                       out[i] = static_cast<uint8_t>(
+                           static_cast<double>(clamped) * top_level / span);
+                   }
+               });
+    return levels;
+}
+
+/// White at the first level fading to a dim shade of one random channel.
+Palette
+heat_palette() {
+    std::mt19937 rng(std::random_device{}());
+    std::uniform_int_distribution<uint64_t> uid(0, 2);
+    uint64_t const color_i = uid(rng);
+    Palette palette{};
+    for (uint64_t level = 0; level < palette_size; ++level) {
+        Rgb::Rgb const color = Rgb::heat_color(level, top_level, color_i);
+        palette.colors.at(level) = color;
+        palette.escape_sizes.at(level) = static_cast<uint8_t>(
+            Rgb::encode_rgb(palette.escapes.at(level), color).size());
+    }
+    return palette;
+}
+
+Image::Color
+image_color(Maze::Maze const &maze, Field const &field,
+            std::vector<uint8_t> const &levels, Palette const &palette,
+            Maze::Point const &p) {
+    if (field.at(p) != unmeasured) {
+        return Rgb::image_color(palette.colors.at(levels[field.cell(p)]));
+    }
+    return (maze[p.row][p.col] & Maze::path_bit) ? Image::path_color
+                                                 : Image::wall_color;
+}
+
+void
+paint(Maze::Maze &maze, Field const &field, Range const &range,
+      Palette const &palette) {
+    std::vector<uint8_t> const levels = quantize(field, range);
+    Printer::Frame frame(Rgb::frame_bytes(maze));
+    for (int row = 0; row < maze.row_size(); row++) {
+        // Squares in a row are printed in order so one cursor move will do.
+        frame.set_cursor_position({row, 0});
+        for (int col = 0; col < maze.col_size(); col++) {
+            Maze::Point const cur = {row, col};
+            if (field.at(cur) != unmeasured) {
+                frame.append(palette.escape(levels[field.cell(cur)]));
+            } else {
+                Rgb::append_wall(frame, maze, cur);
+            }
+        }
+        frame.write_band();
+    }
+    frame.append("\n\n");
+    frame.write_out();
+}
+
+void
+painter_animated(Maze::Maze &maze, Field const &field,
+                 std::vector<uint8_t> const &levels, Palette const &palette,
+                 std::span<Maze::Point const> starts,
+                 Rgb::Bfs_monitor &monitor, Rgb::Thread_guide guide) {
+    My_queue<Maze::Point> &bfs = monitor.paths[guide.bias];
+    std::unordered_set<Maze::Point> &seen = monitor.seen[guide.bias];
+    // Threads take the starts in a different order so they fan out.
+    for (uint64_t i = 0; i < starts.size(); ++i) {
+        Maze::Point const &p = starts[(i + guide.bias) % starts.size()];
+        if (field.at(p) != unmeasured && seen.insert(p).second) {
+            bfs.push(p);
+        }
+    }
+    std::atomic_uint64_t &my_count = monitor.counts.at(guide.bias).painted;
+    for (uint64_t step = 1; !bfs.empty(); ++step) {
+        Maze::Point const cur = bfs.front();
+        bfs.pop();
+
+        if (monitor.done.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (step % painted_poll == 0 && monitor.painted() >= field.measured) {
+            monitor.done.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        uint16_t const square = maze[cur.row][cur.col].load();
+        uint16_t const painted = (square | Rgb::paint);
+        uint16_t const not_painted
+            = square & static_cast<uint16_t>(~Rgb::paint);
+        if (field.at(cur) != unmeasured) {
+            bool const claimed
+                = maze[cur.row][cur.col].ces(not_painted, painted);
+            Stats::count_cas(claimed);
+            if (claimed) {
+                Rgb::animate_rgb(palette.colors.at(levels[field.cell(cur)]),
+                                 cur);
+
+                my_count.fetch_add(1, std::memory_order_relaxed);
+                Speed::pace(guide.animation);
+            }
+        }
+
+        for (uint64_t count = 0, i = guide.bias; count < Maze::dirs.size();
+             count++, ++i %= Maze::dirs.size()) {
+            Maze::Point const &p = Maze::dirs.at(i);
+            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
+
+            bool const is_path
+                = (maze[next.row][next.col] & Maze::path_bit).load();
+
+            if (is_path && !seen.contains(next)) {
+                bfs.push(next);
+                seen.insert(next);
+            }
+        }
+    }
+}
+
+/// Painter threads spread out from the starts and color squares as they
+/// reach them.
+void
+animate(Maze::Maze &maze, Field const &field, Range const &range,
+        Palette const &palette, std::span<Maze::Point const> starts,
+        Speed::Speed speed) {
+    std::vector<uint8_t> const levels = quantize(field, range);
+    std::array<std::thread, Rgb::num_painters> handles;
+    Speed::Speed_unit const animation
+        = Rgb::animation_speeds.at(static_cast<uint64_t>(speed));
+    Rgb::Bfs_monitor monitor;
+    Render::Session session(maze, Rgb::rgb_glyphs, Render::Screen::unknown);
+    for (uint64_t i = 0; i < handles.size(); i++) {
+        Rgb::Thread_guide const this_thread
+            = {i, 0, animation, starts.front()};
+        handles.at(i) = std::thread(
+            painter_animated, std::ref(maze), std::cref(field),
+            std::cref(levels), std::cref(palette), starts, std::ref(monitor),
+            this_thread);
+    }
+
+    for (std::thread &t : handles) {
+        t.join();
+    }
+    session.stop();
+    Printer::set_cursor_position({maze.row_size(), maze.col_size()});
+    std::cout << "\n";
+}
+
+void
+image(Maze::Maze &maze, Field const &field, Range const &range,
+      Palette const &palette, std::string const &path) {
+    std::vector<uint8_t> const levels = quantize(field, range);
+    Image::write_image(
+        maze, path,
+        [&](Maze::Point const &p) {
+            return image_color(maze, field, levels, palette, p);
+        },
+        Image::default_scale(maze));
+}
+
+} // namespace Metric
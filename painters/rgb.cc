@@ -1,4 +1,5 @@
 module;
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cstdint>
@@ -12,6 +13,8 @@ import :maze;
 import :speed;
 import :my_queue;
 import :printers;
+import :render;
+import :image;
 
 namespace Rgb {
 
@@ -22,23 +25,65 @@ constexpr uint16_t paint{0b1'0000'0000};
 constexpr Maze::Square_bits measure{0b10'0000'0000};
 constexpr uint64_t initial_path_len = 1024;
 constexpr std::array<Speed_unit, 8> animation_speeds
-    = {0, 10000, 5000, 2000, 1000, 500, 250, 50};
+    = {0, 2, 3, 8, 17, 33, 67, 333};
 constexpr uint64_t r = 0;
 constexpr uint64_t g = 1;
 constexpr uint64_t b = 2;
 constexpr std::string_view rgb_escape = "\033[38;2;";
 constexpr std::string_view brush = "m█\033[0m";
+// The escape for white, the widest color there is, is 26 bytes.
+constexpr uint64_t max_rgb_bytes = 26;
+using Rgb_bytes = std::array<char, max_rgb_bytes>;
+
+struct Channel_text {
+    std::array<char, 3> digits;
+    uint8_t size;
+};
+
+// The decimal text of every channel value so encoding a color is only copies.
+constexpr std::array<Channel_text, 256> channel_texts = [] {
+    std::array<Channel_text, 256> texts{};
+    for (uint16_t value = 0; value < texts.size(); ++value) {
+        Channel_text &text = texts.at(value);
+        if (value >= 100) {
+            text.digits.at(text.size++)
+                = static_cast<char>('0' + (value / 100));
+        }
+        if (value >= 10) {
+            text.digits.at(text.size++)
+                = static_cast<char>('0' + ((value / 10) % 10));
+        }
+        text.digits.at(text.size++) = static_cast<char>('0' + (value % 10));
+    }
+    return texts;
+}();
+
+/// Painters only add to their own count and sum all of them now and then, so
+/// the squares painted so far are never one line every painter writes.
+struct alignas(Maze::cache_line) Paint_count {
+    std::atomic_uint64_t painted{0};
+};
 
 struct Bfs_monitor {
     std::mutex monitor{};
-    std::atomic_uint64_t count{0};
-    std::vector<My_queue<Maze::Point>> paths;
-    std::vector<std::unordered_set<Maze::Point>> seen;
-    Bfs_monitor() : paths{num_painters}, seen{num_painters} {
+    alignas(Maze::cache_line) std::atomic_bool done{false};
+    std::array<Paint_count, num_painters> counts{};
+    std::vector<Maze::Padded<My_queue<Maze::Point>>> paths;
+    std::vector<Maze::Padded<std::unordered_set<Maze::Point>>> seen;
+    Bfs_monitor() : paths(num_painters), seen(num_painters) {
         for (My_queue<Maze::Point> &p : paths) {
             p.reserve(initial_path_len);
         }
     }
+
+    uint64_t
+    painted() const {
+        uint64_t total = 0;
+        for (Paint_count const &c : counts) {
+            total += c.painted.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
 };
 
 struct Thread_guide {
@@ -48,18 +93,73 @@ struct Thread_guide {
     Maze::Point p;
 };
 
+// Writes the colored block for rgb into out with no allocation. The view is
+// into out.
+std::string_view
+encode_rgb(Rgb_bytes &out, Rgb const &rgb) {
+    char *next = std::copy(rgb_escape.begin(), rgb_escape.end(), out.data());
+    for (uint64_t channel = r; channel <= b; ++channel) {
+        Channel_text const &text = channel_texts.at(rgb.at(channel));
+        next = std::copy_n(text.digits.begin(), text.size, next);
+        if (channel != b) {
+            *next++ = ';';
+        }
+    }
+    next = std::copy(brush.begin(), brush.end(), next);
+    return {out.data(), static_cast<uint64_t>(next - out.data())};
+}
+
+// A value of zero is white. Larger values fade toward a dim shade of the
+// channel at color_i, reaching it at max.
+Rgb
+heat_color(uint64_t value, uint64_t max, uint64_t color_i) {
+    auto const intensity
+        = static_cast<double>(max - value) / static_cast<double>(max);
+    auto const dark = static_cast<uint8_t>(255.0 * intensity);
+    auto const bright
+        = static_cast<uint8_t>(128) + static_cast<uint8_t>(127.0 * intensity);
+    Rgb color{dark, dark, dark};
+    color.at(color_i) = bright;
+    return color;
+}
+
+// Colors travel as 0xRRGGBB wherever a whole color must fit in one word.
+constexpr uint32_t
+pack_rgb(Rgb const &rgb) {
+    return (static_cast<uint32_t>(rgb[r]) << 16U)
+           | (static_cast<uint32_t>(rgb[g]) << 8U)
+           | static_cast<uint32_t>(rgb[b]);
+}
+
+constexpr Rgb
+unpack_rgb(uint32_t packed) {
+    return {static_cast<uint16_t>((packed >> 16U) & 0xFFU),
+            static_cast<uint16_t>((packed >> 8U) & 0xFFU),
+            static_cast<uint16_t>(packed & 0xFFU)};
+}
+
+Image::Color
+image_color(Rgb const &rgb) {
+    return {static_cast<uint8_t>(rgb[r]), static_cast<uint8_t>(rgb[g]),
+            static_cast<uint8_t>(rgb[b])};
+}
+
 void
 print_rgb(Rgb rgb, Maze::Point p) {
     Printer::set_cursor_position(p);
-    std::cout << rgb_escape << rgb[r] << ";" << rgb[g] << ";" << rgb[b]
-              << brush;
+    Rgb_bytes bytes{};
+    std::cout << encode_rgb(bytes, rgb);
 }
 
+// Colors do not live in the maze so they ride along in the render event.
 void
 animate_rgb(Rgb rgb, Maze::Point p) {
+    if (Render::submit(p, pack_rgb(rgb))) {
+        return;
+    }
     Printer::set_cursor_position(p);
-    std::cout << rgb_escape << rgb[r] << ";" << rgb[g] << ";" << rgb[b] << brush
-              << std::flush;
+    Rgb_bytes bytes{};
+    std::cout << encode_rgb(bytes, rgb) << std::flush;
 }
 
 void
@@ -69,4 +169,45 @@ print_wall(Maze::Maze &maze, Maze::Point p) {
     std::cout << maze.wall_style()[(square & Maze::wall_mask).load()];
 }
 
+// Room for the widest color escape plus one cursor move per row, up to the
+// band a frame holds before it is written.
+uint64_t
+frame_bytes(Maze::Maze const &maze) {
+    uint64_t const row_bytes
+        = (static_cast<uint64_t>(maze.col_size()) * max_rgb_bytes)
+          + Printer::max_cursor_bytes;
+    return std::min(static_cast<uint64_t>(maze.row_size()) * row_bytes,
+                    Printer::band_bytes + row_bytes);
+}
+
+void
+append_rgb(Printer::Frame &frame, Rgb rgb) {
+    Rgb_bytes bytes{};
+    frame.append(encode_rgb(bytes, rgb));
+}
+
+uint32_t
+rgb_key(Maze::Maze const &, Render::Event const &e) {
+    return e.payload;
+}
+
+void
+write_rgb(Printer::Frame &frame, Maze::Maze const &, Maze::Point const &,
+          uint32_t key) {
+    append_rgb(frame, unpack_rgb(key));
+}
+
+Render::Summary
+summarize_rgb(uint32_t) {
+    return {.wall = false, .visited = true, .painted = true};
+}
+
+constexpr Render::Glyphs rgb_glyphs{rgb_key, write_rgb, summarize_rgb, 0};
+
+void
+append_wall(Printer::Frame &frame, Maze::Maze const &maze, Maze::Point p) {
+    Maze::Square const &square = maze[p.row][p.col];
+    frame.append(maze.wall_style()[(square & Maze::wall_mask).load()]);
+}
+
 } // namespace Rgb
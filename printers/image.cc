@@ -0,0 +1,527 @@
+/// File: image.cc
+/// --------------
+/// Writes a maze as a PPM or PNG image for mazes far too big for a terminal.
+/// Every square becomes a block of pixels in a color picked by the caller, so
+/// the same writer draws walls and paths, the colors of solver threads, or a
+/// painter's color field. The maze is encoded in bands of rows on several
+/// threads while the finished bands stream to disk in order, so only a few
+/// bands are ever in memory rather than the whole image. PNG output uses
+/// stored deflate blocks. The image is no smaller than the raw pixels but
+/// needs no zlib and costs little more than a copy to encode.
+module;
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+export module labyrinth:image;
+import :maze;
+import :solve_utilities;
+
+//////////////////////////////////   Exported Interface
+
+export namespace Image {
+
+using Color = std::array<uint8_t, 3>;
+
+constexpr Color wall_color{0, 0, 0};
+constexpr Color path_color{255, 255, 255};
+
+/// Picks the color of one square. It is called from many threads at once so it
+/// may only read the maze and whatever else it captured.
+using Square_colors = std::function<Color(Maze::Point const &)>;
+
+/// The xterm value of a 256 color palette code so an image matches the colors
+/// the terminal shows.
+constexpr Color
+ansi_color(uint8_t code) {
+    constexpr std::array<Color, 16> system_colors = {{
+        {0, 0, 0},
+        {205, 0, 0},
+        {0, 205, 0},
+        {205, 205, 0},
+        {0, 0, 238},
+        {205, 0, 205},
+        {0, 205, 205},
+        {229, 229, 229},
+        {127, 127, 127},
+        {255, 0, 0},
+        {0, 255, 0},
+        {255, 255, 0},
+        {92, 92, 255},
+        {255, 0, 255},
+        {0, 255, 255},
+        {255, 255, 255},
+    }};
+    constexpr std::array<uint8_t, 6> cube_levels = {0, 95, 135, 175, 215, 255};
+    if (code < 16) {
+        return system_colors.at(code);
+    }
+    if (code < 232) {
+        uint8_t const cube = code - 16;
+        return {cube_levels.at(cube / 36), cube_levels.at((cube / 6) % 6),
+                cube_levels.at(cube % 6)};
+    }
+    auto const gray = static_cast<uint8_t>(8 + ((code - 232) * 10));
+    return {gray, gray, gray};
+}
+
+/// Pixels per square so a small maze still makes an image about a thousand
+/// pixels across. Large mazes get one pixel a square.
+int default_scale(Maze::Maze const &maze);
+
+/// Writes a PNG if path ends in .png and a binary PPM otherwise. Each square
+/// is scale by scale pixels.
+void write_image(Maze::Maze const &maze, std::string const &path,
+                 Square_colors const &colors, int scale);
+
+/// Walls and paths only.
+void write_maze(Maze::Maze const &maze, std::string const &path);
+
+/// The maze as a solver left it, with every square a thread painted in that
+/// thread's color.
+void write_solution(Maze::Maze const &maze, std::string const &path);
+
+} // namespace Image
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+enum class Format {
+    ppm,
+    png,
+};
+
+// Stored deflate blocks hold at most this many bytes each.
+constexpr uint64_t max_stored_block = 65535;
+constexpr uint64_t target_band_bytes = uint64_t{1} << 20U;
+constexpr uint32_t adler_base = 65521;
+// The most bytes Adler-32 can sum before its 32 bit sums could overflow.
+constexpr uint64_t adler_run = 5552;
+constexpr std::string_view png_signature = "\x89PNG\r\n\x1a\n";
+// Deflate with a 32K window and no preset dictionary. The check bits make the
+// pair a multiple of 31.
+constexpr std::string_view zlib_header = "\x78\x01";
+// An empty stored block with the final bit set ends the deflate stream.
+constexpr std::string_view final_stored_block{"\x01\x00\x00\xff\xff", 5};
+
+constexpr std::array<uint32_t, 256> crc_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < table.size(); ++n) {
+        uint32_t c = n;
+        for (int bit = 0; bit < 8; ++bit) {
+            c = (c & 1U) ? 0xedb88320U ^ (c >> 1U) : c >> 1U;
+        }
+        table.at(n) = c;
+    }
+    return table;
+}();
+
+struct Image_shape {
+    Format format;
+    int scale;
+    uint64_t width;
+    uint64_t height;
+    // Bytes in one line of pixels. A PNG line starts with its filter byte.
+    uint64_t line_bytes;
+    int band_rows;
+    int bands;
+};
+
+struct Band {
+    int index{-1};
+    std::string bytes{};
+    // Adler-32 of the uncompressed PNG lines in the band and how many there
+    // are, so the writer can fold it into the checksum of the whole stream.
+    uint32_t adler{1};
+    uint64_t raw_bytes{0};
+};
+
+// Bands finish in any order but are written in order. Workers may only run a
+// window of bands ahead of the writer which bounds the memory we hold.
+struct Band_pipeline {
+    std::mutex lock{};
+    std::condition_variable band_done{};
+    std::condition_variable band_written{};
+    int next_band{0};
+    int written{0};
+    std::vector<Band> slots;
+    explicit Band_pipeline(uint64_t window) : slots(window) {
+    }
+};
+
+uint32_t
+crc32(std::string_view bytes, uint32_t crc = 0) {
+    crc = ~crc;
+    for (char const c : bytes) {
+        crc = crc_table.at((crc ^ static_cast<uint8_t>(c)) & 0xffU)
+              ^ (crc >> 8U);
+    }
+    return ~crc;
+}
+
+uint32_t
+adler32(std::string_view bytes, uint32_t adler) {
+    uint32_t a = adler & 0xffffU;
+    uint32_t b = adler >> 16U;
+    while (!bytes.empty()) {
+        uint64_t const run = std::min(adler_run, bytes.size());
+        for (uint64_t i = 0; i < run; ++i) {
+            a += static_cast<uint8_t>(bytes[i]);
+            b += a;
+        }
+        a %= adler_base;
+        b %= adler_base;
+        bytes.remove_prefix(run);
+    }
+    return (b << 16U) | a;
+}
+
+// The checksum of two runs joined from the checksums of each, the same math
+// zlib uses, so bands can be summed on their own threads.
+uint32_t
+adler32_combine(uint32_t first, uint32_t second, uint64_t second_bytes) {
+    uint32_t const rem = second_bytes % adler_base;
+    uint32_t a = first & 0xffffU;
+    uint32_t b = static_cast<uint32_t>((uint64_t{rem} * a) % adler_base);
+    a += (second & 0xffffU) + adler_base - 1;
+    b += (first >> 16U) + (second >> 16U) + adler_base - rem;
+    if (a >= adler_base) {
+        a -= adler_base;
+    }
+    if (a >= adler_base) {
+        a -= adler_base;
+    }
+    if (b >= (2 * adler_base)) {
+        b -= 2 * adler_base;
+    }
+    if (b >= adler_base) {
+        b -= adler_base;
+    }
+    return (b << 16U) | a;
+}
+
+void
+append_be32(std::string &out, uint32_t n) {
+    out.push_back(static_cast<char>((n >> 24U) & 0xffU));
+    out.push_back(static_cast<char>((n >> 16U) & 0xffU));
+    out.push_back(static_cast<char>((n >> 8U) & 0xffU));
+    out.push_back(static_cast<char>(n & 0xffU));
+}
+
+// Fills in the length and CRC of the chunk whose header starts at begin and
+// whose data runs to the end of out.
+void
+close_chunk(std::string &out, uint64_t begin) {
+    uint64_t const data_bytes = out.size() - begin - 8;
+    std::string length;
+    append_be32(length, static_cast<uint32_t>(data_bytes));
+    std::copy(length.begin(), length.end(), out.begin() + begin);
+    append_be32(out, crc32(std::string_view(out).substr(begin + 4)));
+}
+
+uint64_t
+open_chunk(std::string &out, std::string_view type) {
+    uint64_t const begin = out.size();
+    out.append(4, '\0');
+    out.append(type);
+    return begin;
+}
+
+Format
+format_of(std::string const &path) {
+    constexpr std::string_view png_suffix = ".png";
+    std::string lower = path;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return lower.ends_with(png_suffix) ? Format::png : Format::ppm;
+}
+
+Image_shape
+shape_of(Maze::Maze const &maze, Format format, int scale) {
+    Image_shape shape{};
+    shape.format = format;
+    shape.scale = scale;
+    shape.width = static_cast<uint64_t>(maze.col_size())
+                  * static_cast<uint64_t>(scale);
+    shape.height = static_cast<uint64_t>(maze.row_size())
+                   * static_cast<uint64_t>(scale);
+    shape.line_bytes = (shape.width * 3) + (format == Format::png ? 1 : 0);
+    uint64_t const square_row_bytes
+        = shape.line_bytes * static_cast<uint64_t>(scale);
+    shape.band_rows = static_cast<int>(std::clamp<uint64_t>(
+        target_band_bytes / square_row_bytes, 1,
+        static_cast<uint64_t>(maze.row_size())));
+    shape.bands = (maze.row_size() + shape.band_rows - 1) / shape.band_rows;
+    return shape;
+}
+
+std::string
+header(Image_shape const &shape) {
+    std::string out;
+    if (shape.format == Format::ppm) {
+        out.append("P6\n")
+            .append(std::to_string(shape.width))
+            .append(" ")
+            .append(std::to_string(shape.height))
+            .append("\n255\n");
+        return out;
+    }
+    out.append(png_signature);
+    uint64_t const ihdr = open_chunk(out, "IHDR");
+    append_be32(out, static_cast<uint32_t>(shape.width));
+    append_be32(out, static_cast<uint32_t>(shape.height));
+    // Eight bits a channel, truecolor, deflate, adaptive filters, no
+    // interlace.
+    out.append({'\x08', '\x02', '\x00', '\x00', '\x00'});
+    close_chunk(out, ihdr);
+    uint64_t const idat = open_chunk(out, "IDAT");
+    out.append(zlib_header);
+    close_chunk(out, idat);
+    return out;
+}
+
+// One line of pixels for a row of squares. A PNG line leads with filter type
+// zero so every line is stored as it is.
+void
+fill_line(Maze::Maze const &maze, Image::Square_colors const &colors,
+          Image_shape const &shape, int row, std::string &line) {
+    line.clear();
+    if (shape.format == Format::png) {
+        line.push_back('\0');
+    }
+    for (int col = 0; col < maze.col_size(); ++col) {
+        Image::Color const color = colors({row, col});
+        for (int pixel = 0; pixel < shape.scale; ++pixel) {
+            line.append(reinterpret_cast<char const *>(color.data()),
+                        color.size());
+        }
+    }
+}
+
+// The band's lines split into stored deflate blocks inside one IDAT chunk.
+void
+encode_png_band(Maze::Maze const &maze, Image::Square_colors const &colors,
+                Image_shape const &shape, int first_row, int last_row,
+                Band &band) {
+    std::string line;
+    line.reserve(shape.line_bytes);
+    band.raw_bytes = static_cast<uint64_t>(last_row - first_row)
+                     * static_cast<uint64_t>(shape.scale) * shape.line_bytes;
+    band.adler = 1;
+    uint64_t const blocks
+        = (band.raw_bytes + max_stored_block - 1) / max_stored_block;
+    band.bytes.reserve(band.raw_bytes + (blocks * 5) + 12);
+    uint64_t const chunk = open_chunk(band.bytes, "IDAT");
+    uint64_t raw_left = band.raw_bytes;
+    uint64_t block_left = 0;
+    for (int row = first_row; row < last_row; ++row) {
+        fill_line(maze, colors, shape, row, line);
+        for (int copy = 0; copy < shape.scale; ++copy) {
+            band.adler = adler32(line, band.adler);
+            std::string_view rest = line;
+            while (!rest.empty()) {
+                if (block_left == 0) {
+                    block_left = std::min(raw_left, max_stored_block);
+                    auto const len = static_cast<uint16_t>(block_left);
+                    auto const nlen = static_cast<uint16_t>(~len);
+                    band.bytes.append(
+                        {'\0', static_cast<char>(len & 0xffU),
+                         static_cast<char>(len >> 8U),
+                         static_cast<char>(nlen & 0xffU),
+                         static_cast<char>(nlen >> 8U)});
+                }
+                uint64_t const take = std::min(block_left, rest.size());
+                band.bytes.append(rest.substr(0, take));
+                rest.remove_prefix(take);
+                block_left -= take;
+                raw_left -= take;
+            }
+        }
+    }
+    close_chunk(band.bytes, chunk);
+}
+
+void
+encode_ppm_band(Maze::Maze const &maze, Image::Square_colors const &colors,
+                Image_shape const &shape, int first_row, int last_row,
+                Band &band) {
+    std::string line;
+    line.reserve(shape.line_bytes);
+    band.bytes.reserve(static_cast<uint64_t>(last_row - first_row)
+                       * static_cast<uint64_t>(shape.scale)
+                       * shape.line_bytes);
+    for (int row = first_row; row < last_row; ++row) {
+        fill_line(maze, colors, shape, row, line);
+        for (int copy = 0; copy < shape.scale; ++copy) {
+            band.bytes.append(line);
+        }
+    }
+}
+
+void
+encode_bands(Maze::Maze const &maze, Image::Square_colors const &colors,
+             Image_shape const &shape, Band_pipeline &pipeline) {
+    Band band{};
+    for (;;) {
+        int index = 0;
+        {
+            std::unique_lock lock(pipeline.lock);
+            if (pipeline.next_band == shape.bands) {
+                return;
+            }
+            index = pipeline.next_band++;
+            pipeline.band_written.wait(lock, [&] {
+                return index
+                       < pipeline.written
+                             + static_cast<int>(pipeline.slots.size());
+            });
+            band = std::move(pipeline.slots.at(index % pipeline.slots.size()));
+        }
+        band.bytes.clear();
+        int const first_row = index * shape.band_rows;
+        int const last_row
+            = std::min(first_row + shape.band_rows, maze.row_size());
+        if (shape.format == Format::png) {
+            encode_png_band(maze, colors, shape, first_row, last_row, band);
+        } else {
+            encode_ppm_band(maze, colors, shape, first_row, last_row, band);
+        }
+        band.index = index;
+        {
+            std::scoped_lock const lock(pipeline.lock);
+            pipeline.slots.at(index % pipeline.slots.size()) = std::move(band);
+        }
+        pipeline.band_done.notify_all();
+    }
+}
+
+void
+stream_bands(Image_shape const &shape, Band_pipeline &pipeline,
+             std::ofstream &file) {
+    uint32_t adler = 1;
+    Band band{};
+    for (int index = 0; index < shape.bands; ++index) {
+        Band &slot = pipeline.slots.at(index % pipeline.slots.size());
+        {
+            std::unique_lock lock(pipeline.lock);
+            pipeline.band_done.wait(lock,
+                                    [&] { return slot.index == index; });
+            band = std::move(slot);
+        }
+        file.write(band.bytes.data(),
+                   static_cast<std::streamsize>(band.bytes.size()));
+        adler = adler32_combine(adler, band.adler, band.raw_bytes);
+        {
+            std::scoped_lock const lock(pipeline.lock);
+            // The spent buffer goes back so a worker can reuse its capacity.
+            slot = std::move(band);
+            slot.index = -1;
+            pipeline.written = index + 1;
+        }
+        pipeline.band_written.notify_all();
+    }
+    if (shape.format == Format::png) {
+        std::string tail;
+        uint64_t const idat = open_chunk(tail, "IDAT");
+        tail.append(final_stored_block);
+        append_be32(tail, adler);
+        close_chunk(tail, idat);
+        close_chunk(tail, open_chunk(tail, "IEND"));
+        file.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+    }
+}
+
+} // namespace
+
+namespace Image {
+
+int
+default_scale(Maze::Maze const &maze) {
+    constexpr int target_pixels = 1024;
+    return std::max(1, target_pixels
+                           / std::max(maze.row_size(), maze.col_size()));
+}
+
+void
+write_image(Maze::Maze const &maze, std::string const &path,
+            Square_colors const &colors, int scale) {
+    if (scale < 1) {
+        std::cerr << "Image scale must be at least 1, got " << scale << ".\n";
+        std::abort();
+    }
+    Image_shape const shape = shape_of(maze, format_of(path), scale);
+    if (shape.format == Format::png
+        && std::max(shape.width, shape.height) > INT32_MAX) {
+        std::cerr << "Maze is too large for a PNG at scale " << scale << ".\n";
+        std::abort();
+    }
+    std::ofstream file(path,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Could not open " << path << " for writing.\n";
+        std::abort();
+    }
+    std::string const head = header(shape);
+    file.write(head.data(), static_cast<std::streamsize>(head.size()));
+    uint64_t const workers = std::clamp<uint64_t>(
+        std::thread::hardware_concurrency(), 1,
+        static_cast<uint64_t>(shape.bands));
+    Band_pipeline pipeline(workers * 2);
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (uint64_t i = 0; i < workers; ++i) {
+        threads.emplace_back(encode_bands, std::cref(maze), std::cref(colors),
+                             std::cref(shape), std::ref(pipeline));
+    }
+    stream_bands(shape, pipeline, file);
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    if (!file.flush()) {
+        std::cerr << "Could not finish writing " << path << ".\n";
+        std::abort();
+    }
+}
+
+void
+write_maze(Maze::Maze const &maze, std::string const &path) {
+    write_image(
+        maze, path,
+        [&maze](Maze::Point const &p) {
+            return (maze[p.row][p.col] & Maze::path_bit) ? path_color
+                                                          : wall_color;
+        },
+        default_scale(maze));
+}
+
+void
+write_solution(Maze::Maze const &maze, std::string const &path) {
+    write_image(
+        maze, path,
+        [&maze](Maze::Point const &p) {
+            Maze::Square_bits const square = maze[p.row][p.col].load();
+            if (square & (Sutil::start_bit | Sutil::finish_bit)) {
+                return ansi_color(Sutil::start_and_finish_color_code);
+            }
+            if (square & Sutil::thread_paint_mask) {
+                return ansi_color(Sutil::thread_color_codes.at(
+                    (square & Sutil::thread_paint_mask)
+                    >> Sutil::thread_paint_shift));
+            }
+            return (square & Maze::path_bit) ? path_color : wall_color;
+        },
+        default_scale(maze));
+}
+
+} // namespace Image
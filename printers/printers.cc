@@ -1,11 +1,45 @@
 module;
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <sys/ioctl.h>
+#include <unistd.h>
 export module labyrinth:printers;
 import :maze;
+import :recorder;
+import :trace;
 
 export namespace Printer {
 
+/// Enough for a cursor move to any row and column an int can hold.
+constexpr uint64_t max_cursor_bytes = 24;
+using Cursor_bytes = std::array<char, max_cursor_bytes>;
+
+/// Animations move the cursor once per square, so the escape is written into
+/// the caller's buffer with no allocation. The view is into out.
+inline std::string_view
+encode_cursor_position(Cursor_bytes &out, Maze::Point const &p) {
+    char *next = out.data();
+    *next++ = '\033';
+    *next++ = '[';
+    next = std::to_chars(next, out.data() + out.size(),
+                         static_cast<uint64_t>(p.row) + 1)
+               .ptr;
+    *next++ = ';';
+    next = std::to_chars(next, out.data() + out.size(),
+                         static_cast<uint64_t>(p.col) + 1)
+               .ptr;
+    *next++ = 'f';
+    return {out.data(), static_cast<uint64_t>(next - out.data())};
+}
+
 inline void
 clear_screen() {
     std::cout << "\033[2J\033[1;1H";
@@ -13,8 +47,183 @@ clear_screen() {
 
 inline void
 set_cursor_position(Maze::Point const &p) {
-    std::cout << "\033[" + std::to_string(p.row + 1) + ";"
-                     + std::to_string(p.col + 1) + "f";
+    Cursor_bytes bytes{};
+    std::cout << encode_cursor_position(bytes, p);
+}
+
+/// How an animation shows a maze with more squares than the terminal has
+/// cells. A maze that fits is always drawn one square to a cell.
+enum class View {
+    /// Each cell stands for a block of squares so the whole maze is on screen.
+    overview,
+    /// A window of full size squares that pans to keep the busiest thread in
+    /// sight.
+    follow,
+};
+
+inline std::atomic<View> &
+view_setting() {
+    static std::atomic<View> view{View::overview};
+    return view;
+}
+
+inline void
+set_view(View view) {
+    view_setting().store(view, std::memory_order_relaxed);
+}
+
+inline View
+view() {
+    return view_setting().load(std::memory_order_relaxed);
+}
+
+/// Programs that make mazes in bulk with nobody watching, such as batch, turn
+/// output off. Frames are then dropped instead of written, builders skip
+/// drawing the finished maze at all and solvers skip their closing messages.
+inline std::atomic_bool &
+headless_setting() {
+    static std::atomic_bool headless{false};
+    return headless;
+}
+
+inline void
+set_headless(bool headless) {
+    headless_setting().store(headless, std::memory_order_relaxed);
+}
+
+inline bool
+headless() {
+    return headless_setting().load(std::memory_order_relaxed);
+}
+
+/// Rows and columns of the terminal on standard output. When that is not a
+/// terminal the LINES and COLUMNS variables are used if both are set, and
+/// otherwise there is no limit to report.
+inline std::optional<Maze::Point>
+terminal_size() {
+    winsize size{};
+    if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row
+        && size.ws_col) {
+        return Maze::Point{size.ws_row, size.ws_col};
+    }
+    char const *const lines = std::getenv("LINES");
+    char const *const columns = std::getenv("COLUMNS");
+    if (!lines || !columns) {
+        return {};
+    }
+    int const rows = std::atoi(lines);
+    int const cols = std::atoi(columns);
+    if (rows <= 0 || cols <= 0) {
+        return {};
+    }
+    return Maze::Point{rows, cols};
 }
 
+/// Whole mazes are written in bands of about this many bytes. An 8001 by 8001
+/// maze is hundreds of megabytes of text that need not sit in memory at once.
+constexpr uint64_t band_bytes = uint64_t{1} << 20U;
+
+/// A whole screen of output gathered in one byte buffer and handed to the
+/// terminal with a single write(2). Streaming a large maze through std::cout
+/// one glyph at a time spends far more time in the stream than in the terminal.
+/// Glyphs are appended as the UTF-8 bytes they already are, so building a frame
+/// is little more than a series of memcpy calls. Clearing keeps the capacity
+/// so one Frame can be reused for every frame of an animation.
+class Frame {
+  public:
+    Frame() = default;
+
+    explicit Frame(uint64_t reserve_bytes) {
+        bytes_.reserve(reserve_bytes);
+    }
+
+    void
+    clear() {
+        bytes_.clear();
+    }
+
+    void
+    append(std::string_view glyph) {
+        bytes_.append(glyph);
+    }
+
+    void
+    append(char c) {
+        bytes_.push_back(c);
+    }
+
+    void
+    append_number(uint64_t n) {
+        std::array<char, 20> digits{};
+        auto const [end, err] = std::to_chars(digits.begin(), digits.end(), n);
+        static_cast<void>(err);
+        bytes_.append(digits.data(), end);
+    }
+
+    void
+    clear_screen() {
+        bytes_.append("\033[2J\033[1;1H");
+    }
+
+    void
+    set_cursor_position(Maze::Point const &p) {
+        Cursor_bytes bytes{};
+        bytes_.append(encode_cursor_position(bytes, p));
+    }
+
+    std::string_view
+    view() const {
+        return bytes_;
+    }
+
+    /// Writes the frame out once it holds a band. Call between rows.
+    void
+    write_band() {
+        if (bytes_.size() >= band_bytes) {
+            write_out();
+        }
+    }
+
+    /// Anything still waiting in std::cout goes first so output stays in the
+    /// order it was written. The frame is empty afterward.
+    void
+    write_out() {
+        std::cout << std::flush;
+        write_raw();
+    }
+
+    /// Skips std::cout entirely for a thread that does not own the stream.
+    /// While recording the bytes go to the cast instead of the terminal.
+    void
+    write_raw() {
+        Trace::Scope const trace("render");
+        if (headless()) {
+            bytes_.clear();
+            return;
+        }
+        if (Recorder::is_recording()) {
+            Recorder::write(bytes_);
+            bytes_.clear();
+            return;
+        }
+        char const *next = bytes_.data();
+        uint64_t left = bytes_.size();
+        while (left) {
+            ssize_t const wrote = ::write(STDOUT_FILENO, next, left);
+            if (wrote < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            next += wrote;
+            left -= static_cast<uint64_t>(wrote);
+        }
+        bytes_.clear();
+    }
+
+  private:
+    std::string bytes_;
+};
+
 } // namespace Printer
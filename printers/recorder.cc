@@ -0,0 +1,191 @@
+/// File: recorder.cc
+/// -----------------
+/// Records everything an animation would print as an asciicast v2 file that
+/// the replay tool, or any asciicast player, can play back later. While a
+/// Recording is alive std::cout and every Frame are captured instead of
+/// reaching the terminal, and animations are paced logically so they never
+/// sleep. Output is stamped with the frame it belongs to rather than the time
+/// it was computed, so a maze that takes minutes to watch is recorded as fast
+/// as it can be solved and still plays back at the speed that was chosen.
+module;
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+export module labyrinth:recorder;
+import :speed;
+
+//////////////////////////////////   Exported Interface
+
+export namespace Recorder {
+
+class Recording {
+  public:
+    /// The cast is sized to width by height terminal cells.
+    Recording(std::string const &path, int width, int height);
+    ~Recording();
+
+    Recording(Recording const &) = delete;
+    Recording &operator=(Recording const &) = delete;
+    Recording(Recording &&) = delete;
+    Recording &operator=(Recording &&) = delete;
+};
+
+bool is_recording();
+
+/// Appends bytes to the cast at the current frame, after anything that went
+/// to std::cout first.
+void write(std::string_view bytes);
+
+/// The frame new output is stamped with.
+uint64_t now();
+
+/// Moves the clock forward to frame. The clock never runs backward.
+void advance_to(uint64_t frame);
+
+} // namespace Recorder
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+struct Cast {
+    std::ofstream file;
+    std::stringbuf captured{};
+    std::streambuf *terminal{nullptr};
+    uint64_t frame{0};
+    std::mutex lock{};
+};
+
+std::unique_ptr<Cast> active_cast{};
+
+// JSON strings may not hold control characters, and every escape sequence
+// starts with one. Multibyte UTF-8 glyphs are copied as they are.
+void
+append_json_string(std::string &out, std::string_view bytes) {
+    constexpr std::string_view hex = "0123456789abcdef";
+    out.push_back('"');
+    for (char const c : bytes) {
+        auto const byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (c == '\n') {
+            out.append("\\n");
+        } else if (byte < 0x20 || byte == 0x7f) {
+            out.append("\\u00");
+            out.push_back(hex.at(byte >> 4U));
+            out.push_back(hex.at(byte & 0xfU));
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+void
+write_event(Cast &cast, std::string_view bytes) {
+    if (bytes.empty()) {
+        return;
+    }
+    uint64_t const micros
+        = cast.frame * static_cast<uint64_t>(Speed::frame_period.count());
+    // Seconds with six decimal places. The fraction is padded with zeros.
+    std::array<char, 32> time{};
+    char *next
+        = std::to_chars(time.begin(), time.end(), micros / 1'000'000).ptr;
+    *next++ = '.';
+    std::array<char, 6> fraction{};
+    fraction.fill('0');
+    uint64_t rest = micros % 1'000'000;
+    for (auto digit = fraction.rbegin(); digit != fraction.rend(); ++digit) {
+        *digit = static_cast<char>('0' + (rest % 10));
+        rest /= 10;
+    }
+    next = std::copy(fraction.begin(), fraction.end(), next);
+    std::string line = "[";
+    line.append(time.data(), next);
+    line.append(", \"o\", ");
+    append_json_string(line, bytes);
+    line.append("]\n");
+    cast.file << line;
+}
+
+// Whatever was streamed to std::cout came before the bytes we are handed now.
+void
+write_captured(Cast &cast) {
+    std::string const text = cast.captured.str();
+    cast.captured.str("");
+    write_event(cast, text);
+}
+
+} // namespace
+
+namespace Recorder {
+
+Recording::Recording(std::string const &path, int width, int height) {
+    if (active_cast) {
+        std::cerr << "Only one recording may run at a time.\n";
+        std::abort();
+    }
+    active_cast = std::make_unique<Cast>();
+    Cast *const cast = active_cast.get();
+    cast->file.open(path, std::ios::out | std::ios::trunc);
+    if (!cast->file) {
+        std::cerr << "Could not open " << path << " for recording.\n";
+        std::abort();
+    }
+    cast->file << "{\"version\": 2, \"width\": " << width
+               << ", \"height\": " << height << "}\n";
+    std::cout << std::flush;
+    cast->terminal = std::cout.rdbuf(&cast->captured);
+    Speed::set_pacing(Speed::Pacing::logical);
+}
+
+Recording::~Recording() {
+    {
+        std::scoped_lock const lock(active_cast->lock);
+        std::cout << std::flush;
+        write_captured(*active_cast);
+        std::cout.rdbuf(active_cast->terminal);
+    }
+    Speed::set_pacing(Speed::Pacing::real_time);
+    active_cast.reset();
+}
+
+bool
+is_recording() {
+    return active_cast != nullptr;
+}
+
+void
+write(std::string_view bytes) {
+    std::scoped_lock const lock(active_cast->lock);
+    write_captured(*active_cast);
+    write_event(*active_cast, bytes);
+}
+
+uint64_t
+now() {
+    std::scoped_lock const lock(active_cast->lock);
+    return active_cast->frame;
+}
+
+void
+advance_to(uint64_t frame) {
+    std::scoped_lock const lock(active_cast->lock);
+    if (frame > active_cast->frame) {
+        write_captured(*active_cast);
+        active_cast->frame = frame;
+    }
+}
+
+} // namespace Recorder
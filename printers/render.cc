@@ -0,0 +1,802 @@
+/// File: render.cc
+/// ---------------
+/// Animations used to print every square from the thread that changed it,
+/// taking a lock so escape sequences from different threads did not
+/// interleave. Every worker then waited on the terminal. Here workers only
+/// push small events into their own single producer single consumer ring and
+/// one render thread draws them at a fixed frame rate. Many updates to the
+/// same square within a frame become one glyph, and squares next to each other
+/// on a row need no cursor move between them.
+///
+/// The session also remembers what it last put in every cell. A square whose
+/// glyph is unchanged since the last frame is skipped, so a thread passing back
+/// over painted squares or toggling bits the glyph does not show costs nothing
+/// at the terminal.
+///
+/// A Session covers the part of an animation where workers are running. While
+/// one is active nothing else should print through std::cout, so start it
+/// after any headers are printed and stop it before any closing message.
+///
+/// A maze with more squares than the terminal has cells is shown through a
+/// viewport. The follow view is a window of full size squares that pans by
+/// half a screen whenever the thread with the most events nears its edge. The
+/// overview shrinks the maze so each cell stands for a square block, drawn
+/// from counts of the walls, visited and painted squares in it. The counts
+/// change with each event, so a frame redraws only the blocks whose counts
+/// moved and never rereads the squares behind them.
+///
+/// When a recording is running nobody is watching, so events carry the frame
+/// their thread was on and the glyph they showed at that moment. Frames are
+/// written to the cast in order once every thread still running has moved
+/// past them, and the render thread keeps up with the workers rather than
+/// the clock.
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+module labyrinth:render;
+import :maze;
+import :printers;
+import :speed;
+import :recorder;
+
+namespace Render {
+
+/// The glyph for a square is looked up when the frame is drawn, so most events
+/// need only their point and see whatever bits the square holds by then.
+/// Painters whose colors do not live in the maze pack them in the payload.
+struct Event {
+    Maze::Point p;
+    uint32_t payload;
+    uint32_t frame;
+};
+
+/// Two events with the same key must draw the same glyph. Glyphs read from the
+/// maze key on only the square bits the glyph shows, so a thread toggling any
+/// other bit leaves the key alone. Painters key on the color.
+using Cell_key = uint32_t (*)(Maze::Maze const &, Event const &);
+
+/// Draws the glyph a key stands for. Everything needed must be in the key
+/// because a recorded key may be drawn long after the square has changed.
+using Glyph_writer = void (*)(Printer::Frame &, Maze::Maze const &,
+                              Maze::Point const &, uint32_t key);
+
+/// What one square adds to the overview block it falls in.
+struct Summary {
+    bool wall;
+    bool visited;
+    bool painted;
+};
+
+/// Reads the summary from a key alone, as the glyph writer does.
+using Cell_summary = Summary (*)(uint32_t key);
+
+struct Glyphs {
+    Cell_key key;
+    Glyph_writer write;
+    Cell_summary summary;
+    // Square bits the summary reads that the glyph does not show. They join
+    // the key only in an overview, where the summary is what gets drawn.
+    uint32_t overview_bits;
+};
+
+/// What the terminal shows when a session starts. With maze the screen already
+/// matches the maze so only changes are drawn. With blank the session clears
+/// the screen and draws the whole maze itself. With unknown every square is
+/// drawn the first time it changes, as when a dark solver has hidden the maze.
+enum class Screen {
+    maze,
+    blank,
+    unknown,
+};
+
+constexpr uint64_t ring_capacity = 1U << 16;
+// How long a recording render thread rests when no worker has sent anything.
+constexpr std::chrono::microseconds record_rest{200};
+// No square or color uses every bit so this never matches a real key.
+constexpr uint32_t unknown_key = 0xFFFFFFFF;
+// Overview blocks with no paint draw one of these rather than a square's
+// glyph. Their keys sit above any square or color and below unknown_key.
+constexpr uint32_t block_key = 0xFE000000;
+constexpr std::array<std::string_view, 9> block_glyphs
+    = {" ", "░", "▒", "▓", "█", "·", "∙", "•", "●"};
+constexpr uint32_t first_wall_shade = 1;
+constexpr uint32_t first_visited_dot = 5;
+constexpr uint32_t block_glyph_levels = 4;
+
+template <class Value_type, uint64_t Capacity> class Spsc_ring {
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "Spsc_ring capacity must be a power of two.");
+
+  public:
+    Spsc_ring() : slots_(std::make_unique<Value_type[]>(Capacity)) {
+    }
+
+    // Producer only.
+    bool
+    push(Value_type const &elem) {
+        uint64_t const tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == Capacity) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == Capacity) {
+                return false;
+            }
+        }
+        slots_[tail & (Capacity - 1)] = elem;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Moves everything available into out.
+    void
+    drain(std::vector<Value_type> &out) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t const tail = tail_.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            out.push_back(slots_[head & (Capacity - 1)]);
+        }
+        head_.store(head, std::memory_order_release);
+    }
+
+  private:
+    std::unique_ptr<Value_type[]> slots_;
+    alignas(Maze::cache_line) std::atomic_uint64_t head_{0};
+    alignas(Maze::cache_line) std::atomic_uint64_t tail_{0};
+    // Producer's last look at head so a push rarely touches the consumer line.
+    alignas(Maze::cache_line) uint64_t head_cache_{0};
+};
+
+using Event_ring = Spsc_ring<Event, ring_capacity>;
+
+struct Producer {
+    Event_ring ring{};
+    // The newest frame pushed to the ring. No older frame will follow it.
+    alignas(Maze::cache_line) std::atomic_uint32_t frame{0};
+    // Set once the thread has exited and will push nothing more.
+    std::atomic_bool done{false};
+    // The thread that started the session usually only marks starts and
+    // finishes before handing the work to other threads.
+    bool owner{false};
+};
+
+// The part of the maze on screen. Terminal cell (row, col) shows the block by
+// block squares starting block squares past origin in each direction. When the
+// maze fits the viewport is the whole maze at one square to a cell.
+struct Viewport {
+    Maze::Point origin;
+    int rows;
+    int cols;
+    int block;
+};
+
+// Running counts for the squares behind one overview cell.
+struct Block {
+    int32_t walls;
+    int32_t visited;
+    int32_t painted;
+    // The newest painted key in the block, shown while any square is painted.
+    uint32_t paint_key;
+    bool dirty;
+};
+
+// How much a producer has sent, for choosing the thread the follow view keeps
+// in sight.
+struct Trail {
+    uint64_t events;
+    Maze::Point last;
+};
+
+class Session;
+
+std::atomic<Session *> &
+active_session() {
+    static std::atomic<Session *> active{nullptr};
+    return active;
+}
+
+class Session {
+  public:
+    Session(Maze::Maze const &maze, Glyphs glyphs, Screen screen)
+        : maze_(maze), glyphs_(glyphs), generation_(next_generation()),
+          owner_(std::this_thread::get_id()),
+          recording_(Recorder::is_recording()),
+          first_cast_frame_(recording_ ? Recorder::now() : 0),
+          front_(static_cast<uint64_t>(maze.row_size())
+                     * static_cast<uint64_t>(maze.col_size()),
+                 unknown_key),
+          view_(choose_viewport(maze, recording_)),
+          screen_(static_cast<uint64_t>(view_.rows)
+                      * static_cast<uint64_t>(view_.cols),
+                  unknown_key) {
+        Session *expected = nullptr;
+        if (!active_session().compare_exchange_strong(expected, this)) {
+            std::cerr << "Only one render session may run at a time.\n";
+            std::abort();
+        }
+        // Whatever the caller printed before us must reach the terminal
+        // before our first frame does.
+        std::cout << std::flush;
+        bool const fits = view_.rows == maze_.row_size()
+                          && view_.cols == maze_.col_size()
+                          && view_.block == 1;
+        if (screen != Screen::unknown) {
+            remember_maze();
+        }
+        if (view_.block > 1) {
+            count_blocks();
+        }
+        // A maze larger than the terminal was never shown whole, so whatever
+        // is on screen is replaced.
+        if (screen == Screen::maze && fits) {
+            screen_ = front_;
+        } else if (screen == Screen::blank || !fits) {
+            frame_.clear_screen();
+            draw_view();
+        }
+        painter_ = std::thread(&Session::run, this);
+    }
+
+    Session(Session const &) = delete;
+    Session &operator=(Session const &) = delete;
+    Session(Session &&) = delete;
+    Session &operator=(Session &&) = delete;
+
+    ~Session() {
+        stop();
+    }
+
+    /// Draws anything still waiting and returns once the terminal has it. Call
+    /// only after every worker thread that submits events has been joined.
+    void
+    stop() {
+        if (!painter_.joinable()) {
+            return;
+        }
+        running_.store(false, std::memory_order_release);
+        painter_.join();
+        active_session().store(nullptr, std::memory_order_release);
+    }
+
+    uint64_t
+    generation() const {
+        return generation_;
+    }
+
+    Producer *
+    join_producers() {
+        std::scoped_lock const lock(producers_lock_);
+        producers_.push_back(std::make_unique<Producer>());
+        producers_.back()->owner = std::this_thread::get_id() == owner_;
+        return producers_.back().get();
+    }
+
+    void
+    push(Producer &producer, Event e) {
+        if (recording_) {
+            // The square may change again long before this frame is written.
+            e.payload = key_of(e);
+        }
+        while (!producer.ring.push(e)) {
+            std::this_thread::yield();
+        }
+        producer.frame.store(e.frame, std::memory_order_release);
+    }
+
+  private:
+    Maze::Maze const &maze_;
+    Glyphs glyphs_;
+    uint64_t generation_;
+    std::thread::id owner_;
+    bool recording_;
+    uint64_t first_cast_frame_;
+    // The newest key of every square, row major, whether or not it is on
+    // screen.
+    std::vector<uint32_t> front_;
+    Viewport view_;
+    // The key of the glyph on screen for every terminal cell in the viewport.
+    std::vector<uint32_t> screen_;
+    std::vector<Block> blocks_{};
+    std::vector<uint64_t> dirty_blocks_{};
+    std::vector<Trail> trails_{};
+    // Where the last glyph drawn this frame left the terminal cursor.
+    Maze::Point cursor_{-1, -1};
+    std::mutex producers_lock_{};
+    std::vector<std::unique_ptr<Producer>> producers_{};
+    std::atomic_bool running_{true};
+    std::vector<Event> pending_{};
+    // Recorded events waiting for every producer to finish their frame, in
+    // frame order.
+    std::vector<Event> backlog_{};
+    Printer::Frame frame_{};
+    std::thread painter_{};
+
+    static uint64_t
+    next_generation() {
+        static std::atomic_uint64_t generation{0};
+        return ++generation;
+    }
+
+    // Frames follow the same clock the workers pace themselves by, so each
+    // frame shows one whole batch of their steps. A recording is stamped with
+    // the workers' own frames, so it is written as fast as they send events.
+    void
+    run() {
+        while (running_.load(std::memory_order_acquire)) {
+            if (!recording_) {
+                Speed::wait_for_next_frame();
+                draw();
+            } else if (!record(false)) {
+                std::this_thread::sleep_for(record_rest);
+            }
+        }
+        if (recording_) {
+            record(true);
+        } else {
+            draw();
+        }
+    }
+
+    void
+    draw() {
+        {
+            std::scoped_lock const lock(producers_lock_);
+            trails_.resize(producers_.size(), {0, {-1, -1}});
+            for (uint64_t i = 0; i < producers_.size(); ++i) {
+                uint64_t const before = pending_.size();
+                producers_[i]->ring.drain(pending_);
+                if (pending_.size() != before) {
+                    trails_[i].events += pending_.size() - before;
+                    trails_[i].last = pending_.back().p;
+                }
+            }
+        }
+        bool const panned = follow_lead();
+        draw_pending();
+        if (panned) {
+            draw_view();
+        }
+    }
+
+    // Centers the viewport on the newest square of the thread with the most
+    // events once that square leaves the middle half of the screen. Returns
+    // true if the viewport moved and every cell must be drawn again.
+    bool
+    follow_lead() {
+        bool const windowed = view_.block == 1
+                              && (view_.rows < maze_.row_size()
+                                  || view_.cols < maze_.col_size());
+        if (!windowed || trails_.empty()) {
+            return false;
+        }
+        Trail const &lead = *std::max_element(
+            trails_.begin(), trails_.end(), [](Trail const &a, Trail const &b) {
+                return a.events < b.events;
+            });
+        if (!lead.events) {
+            return false;
+        }
+        Maze::Point const origin{
+            pan(lead.last.row, view_.origin.row, view_.rows, maze_.row_size()),
+            pan(lead.last.col, view_.origin.col, view_.cols, maze_.col_size()),
+        };
+        if (origin.row == view_.origin.row && origin.col == view_.origin.col) {
+            return false;
+        }
+        view_.origin = origin;
+        return true;
+    }
+
+    // The new start of one axis of the viewport so target stays in sight.
+    static int
+    pan(int target, int start, int span, int size) {
+        int const margin = span / 4;
+        if (target >= start + margin && target < start + span - margin) {
+            return start;
+        }
+        return std::clamp(target - (span / 2), 0, size - span);
+    }
+
+    // Each ring holds its events in frame order, so once every running
+    // producer has pushed frame f all frames before f are complete and may be
+    // written. A finished thread holds nobody back, and neither does the
+    // owner while other threads are doing the work. Returns false if there
+    // was nothing new.
+    bool
+    record(bool everything) {
+        uint32_t complete = std::numeric_limits<uint32_t>::max();
+        uint32_t owner_frame = std::numeric_limits<uint32_t>::max();
+        bool workers = false;
+        uint64_t const before = backlog_.size();
+        {
+            std::scoped_lock const lock(producers_lock_);
+            for (std::unique_ptr<Producer> const &producer : producers_) {
+                bool const done
+                    = producer->done.load(std::memory_order_acquire);
+                uint32_t const frame
+                    = producer->frame.load(std::memory_order_acquire);
+                if (!done && producer->owner) {
+                    owner_frame = std::min(owner_frame, frame);
+                } else if (!done) {
+                    workers = true;
+                    complete = std::min(complete, frame);
+                }
+                drain_in_order(*producer);
+            }
+        }
+        if (!workers) {
+            complete = std::min(complete, owner_frame);
+        }
+        if (everything) {
+            complete = std::numeric_limits<uint32_t>::max();
+        }
+        auto const done = std::partition_point(
+            backlog_.begin(), backlog_.end(),
+            [complete](Event const &e) { return e.frame < complete; });
+        for (auto first = backlog_.begin(); first != done;) {
+            uint32_t const frame = first->frame;
+            auto const last
+                = std::find_if(first, done, [frame](Event const &e) {
+                      return e.frame != frame;
+                  });
+            pending_.assign(first, last);
+            Recorder::advance_to(first_cast_frame_ + frame);
+            draw_pending();
+            first = last;
+        }
+        if (everything) {
+            settle();
+        }
+        if (everything && done != backlog_.begin()) {
+            Recorder::advance_to(first_cast_frame_ + (done - 1)->frame + 1);
+        }
+        bool const fresh
+            = backlog_.size() != before || done != backlog_.begin();
+        backlog_.erase(backlog_.begin(), done);
+        return fresh;
+    }
+
+    // A ring's events are already in frame order, so they only need merging
+    // with the part of the backlog at or past their first frame.
+    void
+    drain_in_order(Producer &producer) {
+        uint64_t const before = backlog_.size();
+        producer.ring.drain(backlog_);
+        if (backlog_.size() == before) {
+            return;
+        }
+        auto const by_frame
+            = [](Event const &a, Event const &b) { return a.frame < b.frame; };
+        auto const run = backlog_.begin() + static_cast<std::ptrdiff_t>(before);
+        auto const overlap
+            = std::upper_bound(backlog_.begin(), run, *run, by_frame);
+        std::inplace_merge(overlap, run, backlog_.end(), by_frame);
+    }
+
+    // Threads are not held to the clock while recording, so one thread can
+    // reach frame 100 before another reaches frame 5. Two threads writing one
+    // square may then be stamped in the opposite order they wrote it. The last
+    // frame redraws any square whose recorded key has gone stale.
+    void
+    settle() {
+        cursor_ = {-1, -1};
+        for (int row = 0; row < maze_.row_size(); ++row) {
+            for (int col = 0; col < maze_.col_size(); ++col) {
+                uint32_t const shown = front_[cell({row, col})];
+                if (shown == unknown_key) {
+                    continue;
+                }
+                apply({row, col}, key_of({{row, col}, shown, 0}));
+            }
+        }
+        draw_dirty_blocks();
+        frame_.write_raw();
+    }
+
+    void
+    draw_pending() {
+        if (pending_.empty()) {
+            return;
+        }
+        // Row major order lets neighbors on a row share one cursor move. The
+        // sort is stable so the last event for a square is the one we keep.
+        std::stable_sort(
+            pending_.begin(), pending_.end(),
+            [](Event const &a, Event const &b) {
+                return a.p.row < b.p.row
+                       || (a.p.row == b.p.row && a.p.col < b.p.col);
+            });
+        cursor_ = {-1, -1};
+        for (uint64_t i = 0; i < pending_.size(); ++i) {
+            Event const &e = pending_[i];
+            if (i + 1 < pending_.size() && pending_[i + 1].p.row == e.p.row
+                && pending_[i + 1].p.col == e.p.col) {
+                continue;
+            }
+            apply(e.p, recording_ ? e.payload : key_of(e));
+        }
+        pending_.clear();
+        draw_dirty_blocks();
+        frame_.write_raw();
+    }
+
+    void
+    remember_maze() {
+        for (int row = 0; row < maze_.row_size(); ++row) {
+            for (int col = 0; col < maze_.col_size(); ++col) {
+                front_[cell({row, col})] = key_of({{row, col}, 0, 0});
+            }
+        }
+    }
+
+    // The one pass over the squares an overview makes. From here on events
+    // keep the counts current.
+    void
+    count_blocks() {
+        blocks_.assign(screen_.size(), {0, 0, 0, unknown_key, false});
+        for (int row = 0; row < maze_.row_size(); ++row) {
+            for (int col = 0; col < maze_.col_size(); ++col) {
+                tally(block_of({row, col}), front_[cell({row, col})], 1);
+            }
+        }
+    }
+
+    // Draws every cell in the viewport that differs from what is on screen,
+    // one cursor move a row when the screen starts blank.
+    void
+    draw_view() {
+        cursor_ = {-1, -1};
+        for (int row = 0; row < view_.rows; ++row) {
+            for (int col = 0; col < view_.cols; ++col) {
+                if (view_.block > 1) {
+                    draw_block({row, col});
+                    continue;
+                }
+                Maze::Point const p{view_.origin.row + row,
+                                    view_.origin.col + col};
+                show({row, col}, p, front_[cell(p)]);
+            }
+        }
+        frame_.write_raw();
+    }
+
+    static Viewport
+    choose_viewport(Maze::Maze const &maze, bool recording) {
+        std::optional<Maze::Point> const terminal = Printer::terminal_size();
+        // A cast is sized to the maze rather than to any terminal.
+        if (recording || !terminal
+            || (maze.row_size() <= terminal->row
+                && maze.col_size() <= terminal->col)) {
+            return {{0, 0}, maze.row_size(), maze.col_size(), 1};
+        }
+        if (Printer::view() == Printer::View::follow) {
+            return {{0, 0},
+                    std::min(maze.row_size(), terminal->row),
+                    std::min(maze.col_size(), terminal->col),
+                    1};
+        }
+        int const block
+            = std::max((maze.row_size() + terminal->row - 1) / terminal->row,
+                       (maze.col_size() + terminal->col - 1) / terminal->col);
+        return {{0, 0},
+                (maze.row_size() + block - 1) / block,
+                (maze.col_size() + block - 1) / block,
+                block};
+    }
+
+    uint64_t
+    cell(Maze::Point const &p) const {
+        return (static_cast<uint64_t>(p.row)
+                * static_cast<uint64_t>(maze_.col_size()))
+               + static_cast<uint64_t>(p.col);
+    }
+
+    uint64_t
+    screen_cell(Maze::Point const &at) const {
+        return (static_cast<uint64_t>(at.row)
+                * static_cast<uint64_t>(view_.cols))
+               + static_cast<uint64_t>(at.col);
+    }
+
+    Block &
+    block_of(Maze::Point const &p) {
+        return blocks_[screen_cell({p.row / view_.block, p.col / view_.block})];
+    }
+
+    uint32_t
+    key_of(Event const &e) const {
+        uint32_t key = glyphs_.key(maze_, e);
+        if (view_.block > 1) {
+            key |= maze_[e.p.row][e.p.col].load() & glyphs_.overview_bits;
+        }
+        return key;
+    }
+
+    // Records the newest key for p and shows it if it is in sight. In an
+    // overview the block only gets its counts moved and is drawn at the end
+    // of the frame.
+    void
+    apply(Maze::Point const &p, uint32_t key) {
+        uint32_t &known = front_[cell(p)];
+        if (key == known) {
+            return;
+        }
+        if (view_.block > 1) {
+            Block &b = block_of(p);
+            tally(b, known, -1);
+            tally(b, key, 1);
+            known = key;
+            if (!b.dirty) {
+                b.dirty = true;
+                dirty_blocks_.push_back(screen_cell(
+                    {p.row / view_.block, p.col / view_.block}));
+            }
+            return;
+        }
+        known = key;
+        Maze::Point const at{p.row - view_.origin.row,
+                             p.col - view_.origin.col};
+        if (at.row >= 0 && at.row < view_.rows && at.col >= 0
+            && at.col < view_.cols) {
+            show(at, p, key);
+        }
+    }
+
+    void
+    tally(Block &b, uint32_t key, int32_t step) {
+        if (key == unknown_key) {
+            return;
+        }
+        Summary const summary = glyphs_.summary(key);
+        b.walls += summary.wall ? step : 0;
+        b.visited += summary.visited ? step : 0;
+        b.painted += summary.painted ? step : 0;
+        if (summary.painted && step > 0) {
+            b.paint_key = key;
+        }
+    }
+
+    void
+    draw_dirty_blocks() {
+        if (dirty_blocks_.empty()) {
+            return;
+        }
+        std::sort(dirty_blocks_.begin(), dirty_blocks_.end());
+        for (uint64_t const i : dirty_blocks_) {
+            int const cols = view_.cols;
+            draw_block({static_cast<int>(i / static_cast<uint64_t>(cols)),
+                        static_cast<int>(i % static_cast<uint64_t>(cols))});
+        }
+        dirty_blocks_.clear();
+    }
+
+    // Paint wins because it is what the threads are showing. Otherwise a dot
+    // grows with how many squares threads have visited and a shade darkens
+    // with how many are wall.
+    void
+    draw_block(Maze::Point const &at) {
+        Block &b = blocks_[screen_cell(at)];
+        b.dirty = false;
+        Maze::Point const first{at.row * view_.block, at.col * view_.block};
+        if (b.painted > 0) {
+            show(at, first, b.paint_key);
+            return;
+        }
+        auto const squares = static_cast<uint32_t>(
+            (std::min(first.row + view_.block, maze_.row_size()) - first.row)
+            * (std::min(first.col + view_.block, maze_.col_size())
+               - first.col));
+        uint32_t level = 0;
+        if (b.visited > 0) {
+            level = first_visited_dot
+                    + ((static_cast<uint32_t>(b.visited) - 1)
+                       * block_glyph_levels / squares);
+        } else if (b.walls > 0) {
+            level = first_wall_shade
+                    + ((static_cast<uint32_t>(b.walls) - 1) * block_glyph_levels
+                       / squares);
+        }
+        show(at, first, block_key | level);
+    }
+
+    // Draws key in terminal cell at if it is not already there. The cursor
+    // only moves when the last glyph drawn was not our left neighbor.
+    void
+    show(Maze::Point const &at, Maze::Point const &p, uint32_t key) {
+        uint32_t &shown = screen_[screen_cell(at)];
+        if (key == shown) {
+            return;
+        }
+        shown = key;
+        if (cursor_.row != at.row || cursor_.col != at.col) {
+            frame_.set_cursor_position(at);
+        }
+        if (key == unknown_key) {
+            frame_.append(' ');
+        } else if (key >= block_key) {
+            frame_.append(block_glyphs.at(key & ~block_key));
+        } else {
+            glyphs_.write(frame_, maze_, p, key);
+        }
+        cursor_ = {at.row, at.col + 1};
+    }
+};
+
+struct Thread_producer {
+    uint64_t generation;
+    Producer *producer;
+    uint64_t first_frame;
+
+    // Tells the session a worker is gone when its thread exits, so a
+    // recording stops waiting on frames it will never send.
+    ~Thread_producer() {
+        Session *const session
+            = active_session().load(std::memory_order_acquire);
+        if (session && producer && generation == session->generation()) {
+            producer->done.store(true, std::memory_order_release);
+        }
+    }
+};
+
+/// Hands the square to the running session and returns true, or returns false
+/// so the caller can print it directly when no animation is being rendered.
+bool
+submit(Maze::Point const &p, uint32_t payload = 0) {
+    Session *const session = active_session().load(std::memory_order_acquire);
+    if (!session) {
+        return false;
+    }
+    static thread_local Thread_producer mine{0, nullptr, 0};
+    if (mine.generation != session->generation()) {
+        // Member by member, as a temporary would retire the producer when
+        // it is destroyed.
+        mine.generation = session->generation();
+        mine.producer = session->join_producers();
+        mine.first_frame = Speed::frames_paced();
+    }
+    session->push(*mine.producer,
+                  {p, payload,
+                   static_cast<uint32_t>(Speed::frames_paced()
+                                         - mine.first_frame)});
+    return true;
+}
+
+/// Builders and solvers are written once as templates over one of these. The
+/// static policy draws nothing, so its loops compile with no pacing or cursor
+/// work left in them, and code only an animation needs goes under an if
+/// constexpr on animated. A recording needs no policy of its own because the
+/// terminal policy's output is what the recorder captures.
+struct No_render {
+    static constexpr bool animated = false;
+
+    void
+    draw(Maze::Maze const &, Maze::Point const &) const {
+    }
+};
+
+/// Flush draws one square through the running session or straight to the
+/// terminal, and each draw is one paced step of the animation.
+template <void (*Flush)(Maze::Maze const &, Maze::Point const &)>
+struct Terminal_render {
+    static constexpr bool animated = true;
+    Speed::Speed_unit speed;
+
+    void
+    draw(Maze::Maze const &maze, Maze::Point const &p) const {
+        Flush(maze, p);
+        Speed::pace(speed);
+    }
+};
+
+} // namespace Render
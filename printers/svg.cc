@@ -0,0 +1,420 @@
+/// File: svg.cc
+/// ------------
+/// Writes a maze as an SVG drawing. A wall square already records which of
+/// its neighbors it joins, so walls are traced in one row major pass into the
+/// longest horizontal and vertical lines they form and all of them go in one
+/// path element. Each solver thread's path becomes polylines that only keep the
+/// squares where it turns. The file grows with the number of lines and turns,
+/// not the number of squares, so even large mazes stay small and draw quickly.
+module;
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+export module labyrinth:svg;
+import :maze;
+import :printers;
+import :image;
+import :solve_utilities;
+
+//////////////////////////////////   Exported Interface
+
+export namespace Svg {
+
+/// Walls only.
+void write_maze(Maze::Maze const &maze, std::string const &path);
+
+/// Walls, the starts and finishes, and the path of every solver thread drawn
+/// in that thread's color.
+void write_solution(Maze::Maze const &maze, std::string const &path);
+
+} // namespace Svg
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+// Squares are two units wide so every square center lands on a whole number.
+constexpr int unit = 2;
+constexpr uint64_t flush_bytes = uint64_t{1} << 20U;
+constexpr std::string_view wall_style
+    = R"(fill="none" stroke="#000" stroke-width="0.6" )"
+      R"(stroke-linecap="square")";
+constexpr std::string_view path_style
+    = R"(fill="none" stroke-width="1" stroke-linecap="round" )"
+      R"(stroke-linejoin="round" stroke-opacity="0.8")";
+
+// Buffers the drawing and hands it to the file in large writes.
+class Svg_file {
+  public:
+    explicit Svg_file(std::string const &path)
+        : path_(path), file_(path, std::ios::out | std::ios::trunc),
+          frame_(flush_bytes) {
+        if (!file_) {
+            std::cerr << "Could not open " << path << " for writing.\n";
+            std::abort();
+        }
+    }
+
+    Svg_file(Svg_file const &) = delete;
+    Svg_file &operator=(Svg_file const &) = delete;
+    Svg_file(Svg_file &&) = delete;
+    Svg_file &operator=(Svg_file &&) = delete;
+
+    ~Svg_file() {
+        flush();
+    }
+
+    // Writes what is left and reports a file that did not take every byte.
+    void
+    close() {
+        flush();
+        if (!file_.flush()) {
+            std::cerr << "Could not finish writing " << path_ << ".\n";
+            std::abort();
+        }
+    }
+
+    Svg_file &
+    operator<<(std::string_view text) {
+        frame_.append(text);
+        flush_if_full();
+        return *this;
+    }
+
+    Svg_file &
+    operator<<(int n) {
+        frame_.append_number(static_cast<uint64_t>(n));
+        return *this;
+    }
+
+  private:
+    std::string path_;
+    std::ofstream file_;
+    Printer::Frame frame_;
+
+    void
+    flush_if_full() {
+        if (frame_.view().size() >= flush_bytes) {
+            flush();
+        }
+    }
+
+    void
+    flush() {
+        std::string_view const bytes = frame_.view();
+        file_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        frame_.clear();
+    }
+};
+
+int
+center(int square) {
+    return (square * unit) + (unit / 2);
+}
+
+// Solvers that fill dead ends clear the path bit of squares they paint, and
+// those are drawn as the thread's trail rather than as walls.
+bool
+is_wall(Maze::Maze const &maze, int row, int col) {
+    return row >= 0 && row < maze.row_size() && col >= 0
+           && col < maze.col_size()
+           && !(maze[row][col] & (Maze::path_bit | Sutil::thread_paint_mask));
+}
+
+// A modification or solver may open a path through a wall, leaving its
+// neighbors still marked as joining it.
+bool
+joins(Maze::Maze const &maze, int row, int col, Maze::Wall_line line,
+      Maze::Point const &d) {
+    return is_wall(maze, row, col) && (maze[row][col] & line)
+           && is_wall(maze, row + d.row, col + d.col);
+}
+
+// A run of walls along a row ends at the first square that does not join its
+// east neighbor. Columns are tracked at the same time, each remembering the
+// row its open run started on, so one pass finds every line. A wall joined to
+// nothing is drawn as a dot so it is not lost.
+void
+write_walls(Svg_file &out, Maze::Maze const &maze) {
+    out << "<path " << wall_style << " d=\"";
+    std::vector<int> column_start(static_cast<uint64_t>(maze.col_size()), -1);
+    for (int row = 0; row < maze.row_size(); ++row) {
+        int row_start = -1;
+        for (int col = 0; col < maze.col_size(); ++col) {
+            if (!is_wall(maze, row, col)) {
+                continue;
+            }
+            bool const east = joins(maze, row, col, Maze::east_wall, {0, 1});
+            bool const south
+                = joins(maze, row, col, Maze::south_wall, {1, 0});
+            bool const west
+                = joins(maze, row, col, Maze::west_wall, {0, -1});
+            bool const north
+                = joins(maze, row, col, Maze::north_wall, {-1, 0});
+            if (east && row_start < 0) {
+                row_start = col;
+            }
+            if (!east && row_start >= 0) {
+                out << "M" << center(row_start) << " " << center(row) << "H"
+                    << center(col);
+                row_start = -1;
+            }
+            int &col_start = column_start.at(static_cast<uint64_t>(col));
+            if (south && col_start < 0) {
+                col_start = row;
+            }
+            if (!south && col_start >= 0) {
+                out << "M" << center(col) << " " << center(col_start) << "V"
+                    << center(row);
+                col_start = -1;
+            }
+            if (!east && !south && !west && !north) {
+                out << "M" << center(col) << " " << center(row) << "h0";
+            }
+        }
+    }
+    out << "\"/>\n";
+}
+
+std::string
+hex_color(Image::Color const &color) {
+    constexpr std::string_view digits = "0123456789abcdef";
+    std::string hex = "#";
+    for (uint8_t const channel : color) {
+        hex.push_back(digits.at(channel >> 4U));
+        hex.push_back(digits.at(channel & 0xfU));
+    }
+    return hex;
+}
+
+// The squares one thread painted and which of the steps between neighboring
+// squares have been drawn. Each square keeps the steps to its east and south
+// neighbors, so every step has exactly one owner.
+class Thread_trail {
+  public:
+    Thread_trail(Maze::Maze const &maze, Maze::Square_bits paint)
+        : maze_(maze), paint_(paint),
+          drawn_(static_cast<uint64_t>(maze.row_size())
+                     * static_cast<uint64_t>(maze.col_size()),
+                 0) {
+    }
+
+    bool
+    has(Maze::Point const &p) const {
+        return p.row >= 0 && p.row < maze_.row_size() && p.col >= 0
+               && p.col < maze_.col_size() && (maze_[p.row][p.col] & paint_);
+    }
+
+    int
+    degree(Maze::Point const &p) const {
+        int neighbors = 0;
+        for (Maze::Point const &d : Maze::dirs) {
+            neighbors += has({p.row + d.row, p.col + d.col});
+        }
+        return neighbors;
+    }
+
+    /// True if the step from p in Maze::dirs[dir] stays on the trail and has
+    /// not been drawn.
+    bool
+    can_step(Maze::Point const &p, uint64_t dir) const {
+        Maze::Point const &d = Maze::dirs.at(dir);
+        return has({p.row + d.row, p.col + d.col})
+               && !(drawn_.at(owner(p, dir)) & mask(dir));
+    }
+
+    void
+    draw_step(Maze::Point const &p, uint64_t dir) {
+        drawn_.at(owner(p, dir)) |= mask(dir);
+    }
+
+  private:
+    Maze::Maze const &maze_;
+    Maze::Square_bits paint_;
+    std::vector<uint8_t> drawn_;
+
+    // North and west steps belong to the neighbor on the other side.
+    uint64_t
+    owner(Maze::Point const &p, uint64_t dir) const {
+        Maze::Point o = p;
+        if (dir == north) {
+            --o.row;
+        } else if (dir == west) {
+            --o.col;
+        }
+        return (static_cast<uint64_t>(o.row)
+                * static_cast<uint64_t>(maze_.col_size()))
+               + static_cast<uint64_t>(o.col);
+    }
+
+    static uint8_t
+    mask(uint64_t dir) {
+        return (dir == east || dir == west) ? east_step : south_step;
+    }
+
+    static constexpr uint64_t north = 0;
+    static constexpr uint64_t east = 1;
+    static constexpr uint64_t west = 3;
+    static constexpr uint8_t east_step = 0b01;
+    static constexpr uint8_t south_step = 0b10;
+};
+
+// Points along a straight stretch are dropped so a polyline only holds its
+// ends and the squares where it turns.
+void
+add_point(std::vector<Maze::Point> &line, Maze::Point const &p) {
+    if (line.size() >= 2) {
+        Maze::Point const &a = line[line.size() - 2];
+        Maze::Point const &b = line.back();
+        if ((a.row == b.row && b.row == p.row)
+            || (a.col == b.col && b.col == p.col)) {
+            line.back() = p;
+            return;
+        }
+    }
+    line.push_back(p);
+}
+
+void
+write_polyline(Svg_file &out, std::vector<Maze::Point> const &line,
+               std::string const &color) {
+    out << "<polyline " << path_style << " stroke=\"" << color
+        << "\" points=\"";
+    for (Maze::Point const &p : line) {
+        out << center(p.col) << "," << center(p.row) << " ";
+    }
+    // A lone square still needs two points for its round caps to draw a dot.
+    if (line.size() == 1) {
+        out << center(line.front().col) << "," << center(line.front().row);
+    }
+    out << "\"/>\n";
+}
+
+// Draws undrawn steps from start until none are left where we stand. Going
+// straight is tried first so open areas become a few long lines rather than a
+// staircase.
+void
+walk(Svg_file &out, Thread_trail &trail, Maze::Point const &start,
+     std::string const &color, std::vector<Maze::Point> &line) {
+    line.assign({start});
+    Maze::Point cur = start;
+    uint64_t dir = 0;
+    for (;;) {
+        if (!trail.can_step(cur, dir)) {
+            uint64_t turn = 0;
+            while (turn < Maze::dirs.size() && !trail.can_step(cur, turn)) {
+                ++turn;
+            }
+            if (turn == Maze::dirs.size()) {
+                break;
+            }
+            dir = turn;
+        }
+        trail.draw_step(cur, dir);
+        cur = {cur.row + Maze::dirs.at(dir).row,
+               cur.col + Maze::dirs.at(dir).col};
+        add_point(line, cur);
+    }
+    write_polyline(out, line, color);
+}
+
+bool
+has_step(Thread_trail const &trail, Maze::Point const &p) {
+    for (uint64_t dir = 0; dir < Maze::dirs.size(); ++dir) {
+        if (trail.can_step(p, dir)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every line has to start or end at a square with an odd number of
+// neighbors, so starting there first leaves the fewest lines. What is left
+// after that are loops which may start anywhere. A square alone is a dot.
+void
+write_trail(Svg_file &out, Maze::Maze const &maze, uint16_t thread) {
+    Thread_trail trail(maze, static_cast<Maze::Square_bits>(
+                                 Sutil::thread_bits.at(thread)
+                                 << Sutil::thread_paint_shift));
+    std::string const color = hex_color(Image::ansi_color(
+        Sutil::thread_color_codes.at(Sutil::thread_bits.at(thread))));
+    std::vector<Maze::Point> line;
+    for (bool const odd_only : {true, false}) {
+        for (int row = 0; row < maze.row_size(); ++row) {
+            for (int col = 0; col < maze.col_size(); ++col) {
+                Maze::Point const p = {row, col};
+                if (!trail.has(p)) {
+                    continue;
+                }
+                int const degree = trail.degree(p);
+                if (odd_only && degree % 2 == 0) {
+                    continue;
+                }
+                if (!odd_only && degree == 0) {
+                    line.assign({p});
+                    write_polyline(out, line, color);
+                    continue;
+                }
+                while (has_step(trail, p)) {
+                    walk(out, trail, p, color, line);
+                }
+            }
+        }
+    }
+}
+
+void
+write_ends(Svg_file &out, Maze::Maze const &maze) {
+    std::string const color = hex_color(
+        Image::ansi_color(Sutil::start_and_finish_color_code));
+    for (int row = 0; row < maze.row_size(); ++row) {
+        for (int col = 0; col < maze.col_size(); ++col) {
+            if (!(maze[row][col] & (Sutil::start_bit | Sutil::finish_bit))) {
+                continue;
+            }
+            out << "<circle cx=\"" << center(col) << "\" cy=\"" << center(row)
+                << "\" r=\"0.8\" fill=\"" << color << "\"/>\n";
+        }
+    }
+}
+
+void
+write_svg(Maze::Maze const &maze, std::string const &path, bool solution) {
+    Svg_file out(path);
+    int const scale = Image::default_scale(maze);
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\""
+        << maze.col_size() * scale << "\" height=\""
+        << maze.row_size() * scale << "\" viewBox=\"0 0 "
+        << maze.col_size() * unit << " " << maze.row_size() * unit << "\">\n"
+        << "<rect width=\"100%\" height=\"100%\" fill=\"#fff\"/>\n";
+    write_walls(out, maze);
+    if (solution) {
+        for (uint16_t thread = 0; thread < Sutil::num_threads; ++thread) {
+            write_trail(out, maze, thread);
+        }
+        write_ends(out, maze);
+    }
+    out << "</svg>\n";
+    out.close();
+}
+
+} // namespace
+
+namespace Svg {
+
+void
+write_maze(Maze::Maze const &maze, std::string const &path) {
+    write_svg(maze, path, false);
+}
+
+void
+write_solution(Maze::Maze const &maze, std::string const &path) {
+    write_svg(maze, path, true);
+}
+
+} // namespace Svg
@@ -0,0 +1,241 @@
+/// File: replay.cc
+/// ---------------
+/// Plays back an asciicast v2 file such as the ones run_maze and measure write
+/// with the -rec flag. The first line is a header and every line after it is
+/// one event of the form [seconds, "o", "output"]. Output is written to the
+/// terminal at the time it is stamped with, divided by the speed multiplier.
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+struct Replay_args {
+    std::string path;
+    double speed{1.0};
+};
+
+struct Event {
+    double seconds;
+    std::string output;
+};
+
+Replay_args read_args(std::span<char *> args);
+bool parse_event(std::string_view line, Event &event);
+bool parse_json_string(std::string_view text, std::string &out);
+void append_utf8(std::string &out, uint32_t code_point);
+void print_usage();
+
+} // namespace
+
+int
+main(int argc, char **argv) {
+    Replay_args const args
+        = read_args(std::span(argv, static_cast<uint64_t>(argc)));
+    std::ifstream cast(args.path);
+    if (!cast) {
+        std::cerr << "Could not open " << args.path << "\n";
+        std::exit(1);
+    }
+    std::string line;
+    if (!std::getline(cast, line) || !line.starts_with("{")) {
+        std::cerr << args.path << " is not an asciicast file.\n";
+        std::exit(1);
+    }
+    auto const start = std::chrono::steady_clock::now();
+    Event event{};
+    uint64_t line_number = 1;
+    while (std::getline(cast, line)) {
+        ++line_number;
+        if (line.empty()) {
+            continue;
+        }
+        if (!parse_event(line, event)) {
+            std::cerr << "Malformed event on line " << line_number << "\n";
+            std::exit(1);
+        }
+        auto const due
+            = start
+              + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(event.seconds / args.speed));
+        if (due > std::chrono::steady_clock::now()) {
+            std::cout << std::flush;
+            std::this_thread::sleep_until(due);
+        }
+        std::cout << event.output;
+    }
+    std::cout << std::flush;
+    return 0;
+}
+
+namespace {
+
+Replay_args
+read_args(std::span<char *> args) {
+    Replay_args replay{};
+    for (uint64_t i = 1; i < args.size(); ++i) {
+        std::string_view const arg = args[i];
+        if (arg == "-h") {
+            print_usage();
+            std::exit(0);
+        }
+        if (arg == "-x") {
+            if (i + 1 == args.size()) {
+                print_usage();
+                std::exit(1);
+            }
+            std::string_view const speed = args[++i];
+            auto const [end, err] = std::from_chars(
+                speed.data(), speed.data() + speed.size(), replay.speed);
+            if (err != std::errc{} || end != speed.data() + speed.size()
+                || replay.speed <= 0.0) {
+                std::cerr << "Invalid speed multiplier: " << speed << "\n";
+                print_usage();
+                std::exit(1);
+            }
+            continue;
+        }
+        if (!replay.path.empty()) {
+            std::cerr << "Invalid argument: " << arg << "\n";
+            print_usage();
+            std::exit(1);
+        }
+        replay.path = arg;
+    }
+    if (replay.path.empty()) {
+        print_usage();
+        std::exit(1);
+    }
+    return replay;
+}
+
+// Only output events are played. Input and marker events some players write
+// are skipped by leaving the output empty.
+bool
+parse_event(std::string_view line, Event &event) {
+    event.output.clear();
+    if (!line.starts_with("[")) {
+        return false;
+    }
+    line.remove_prefix(1);
+    auto const [end, err] = std::from_chars(
+        line.data(), line.data() + line.size(), event.seconds);
+    if (err != std::errc{}) {
+        return false;
+    }
+    line.remove_prefix(static_cast<uint64_t>(end - line.data()));
+    uint64_t const type = line.find('"');
+    if (type == std::string_view::npos || type + 2 >= line.size()
+        || line[type + 2] != '"') {
+        return false;
+    }
+    char const event_type = line[type + 1];
+    uint64_t const data = line.find('"', type + 3);
+    if (data == std::string_view::npos) {
+        return false;
+    }
+    line.remove_prefix(data);
+    std::string output;
+    if (!parse_json_string(line, output)) {
+        return false;
+    }
+    if (event_type == 'o') {
+        event.output = std::move(output);
+    }
+    return true;
+}
+
+// The text starts at the opening quote. Escapes are decoded and \u code points,
+// including surrogate pairs, are written back out as UTF-8.
+bool
+parse_json_string(std::string_view text, std::string &out) {
+    uint64_t i = 1;
+    while (i < text.size()) {
+        char const c = text[i++];
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\') {
+            out.push_back(c);
+            continue;
+        }
+        if (i == text.size()) {
+            return false;
+        }
+        char const escape = text[i++];
+        if (escape == 'n') {
+            out.push_back('\n');
+        } else if (escape == 'r') {
+            out.push_back('\r');
+        } else if (escape == 't') {
+            out.push_back('\t');
+        } else if (escape == 'b') {
+            out.push_back('\b');
+        } else if (escape == 'f') {
+            out.push_back('\f');
+        } else if (escape == 'u') {
+            uint32_t code_point = 0;
+            if (i + 4 > text.size()
+                || std::from_chars(text.data() + i, text.data() + i + 4,
+                                   code_point, 16)
+                           .ptr
+                       != text.data() + i + 4) {
+                return false;
+            }
+            i += 4;
+            uint32_t low = 0;
+            if (code_point >= 0xd800 && code_point < 0xdc00
+                && text.substr(i, 2) == "\\u" && i + 6 <= text.size()
+                && std::from_chars(text.data() + i + 2, text.data() + i + 6,
+                                   low, 16)
+                           .ptr
+                       == text.data() + i + 6
+                && low >= 0xdc00 && low < 0xe000) {
+                code_point
+                    = 0x10000 + ((code_point - 0xd800) << 10U) + (low - 0xdc00);
+                i += 6;
+            }
+            append_utf8(out, code_point);
+        } else {
+            out.push_back(escape);
+        }
+    }
+    return false;
+}
+
+void
+append_utf8(std::string &out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xc0 | (code_point >> 6U)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3fU)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xe0 | (code_point >> 12U)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6U) & 0x3fU)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3fU)));
+    } else {
+        out.push_back(static_cast<char>(0xf0 | (code_point >> 18U)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12U) & 0x3fU)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6U) & 0x3fU)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3fU)));
+    }
+}
+
+void
+print_usage() {
+    std::cout << "Usage: replay <file> [-x speed]\n"
+                 "  <file> An animation recorded with the -rec flag.\n"
+                 "  -x     Speed multiplier. 2 plays twice as fast, 0.5 half "
+                 "as fast.\n"
+                 "  -h     Print this message.\n";
+}
+
+} // namespace
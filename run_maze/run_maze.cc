@@ -2,6 +2,7 @@ import labyrinth;
 
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <optional>
@@ -25,6 +26,9 @@ using Solve_function
 constexpr int static_image = 0;
 constexpr int animated_playback = 1;
 
+// The solver's key and closing message are printed below the maze.
+constexpr int cast_footer_height = 10;
+
 struct Flag_arg {
     std::string_view flag;
     std::string_view arg;
@@ -44,6 +48,13 @@ struct Maze_runner {
     int solver_view{static_image};
     Speed::Speed solver_speed{};
     Solve_function solver{Dfs::hunt, Dfs::animate_hunt};
+
+    std::optional<std::string> cast_path;
+    Printer::View view{Printer::View::overview};
+    std::optional<std::string> image_path;
+    std::optional<std::string> svg_path;
+    std::optional<std::string> stats_path;
+    std::optional<std::string> trace_path;
     Maze_runner() : args{} {
     }
 };
@@ -54,6 +65,7 @@ struct Lookup_tables {
     std::unordered_map<std::string, Build_function> modification_table;
     std::unordered_map<std::string, Solve_function> solver_table;
     std::unordered_map<std::string, Maze::Maze_style> style_table;
+    std::unordered_map<std::string, Printer::View> view_table;
     std::unordered_map<std::string, Speed::Speed> solver_animation_table;
     std::unordered_map<std::string, Speed::Speed> builder_animation_table;
 };
@@ -70,7 +82,7 @@ void print_usage();
 int
 main(int argc, char **argv) {
     Lookup_tables const tables = {
-        .argument_flags={"-r", "-c", "-b", "-s", "-h", "-g", "-d", "-m", "-sa", "-ba"},
+        .argument_flags={"-r", "-c", "-b", "-s", "-h", "-g", "-d", "-m", "-sa", "-ba", "-rec", "-img", "-svg", "-v", "-stats", "-trace"},
         .builder_table={
             {"rdfs",
              {Recursive_backtracker::generate_maze,
@@ -101,6 +113,10 @@ main(int argc, char **argv) {
             {"floodfs-hunt", {Floodfs::hunt, Floodfs::animate_hunt}},
             {"floodfs-gather", {Floodfs::gather, Floodfs::animate_gather}},
             {"floodfs-corners", {Floodfs::corners, Floodfs::animate_corners}},
+            {"deadend-hunt", {Dead_end::hunt, Dead_end::animate_hunt}},
+            {"deadend-gather", {Dead_end::gather, Dead_end::animate_gather}},
+            {"deadend-corners",
+             {Dead_end::corners, Dead_end::animate_corners}},
             {"rdfs-hunt", {Rdfs::hunt, Rdfs::animate_hunt}},
             {"rdfs-gather", {Rdfs::gather, Rdfs::animate_gather}},
             {"rdfs-corners", {Rdfs::corners, Rdfs::animate_corners}},
@@ -113,6 +129,17 @@ main(int argc, char **argv) {
             {"darkbfs-hunt", {Bfs::hunt, Dark_bfs::animate_hunt}},
             {"darkbfs-gather", {Bfs::gather, Dark_bfs::animate_gather}},
             {"darkbfs-corners", {Bfs::corners, Dark_bfs::animate_corners}},
+            {"stealdfs-hunt", {Steal_dfs::hunt, Steal_dfs::animate_hunt}},
+            {"stealdfs-gather",
+             {Steal_dfs::gather, Steal_dfs::animate_gather}},
+            {"stealdfs-corners",
+             {Steal_dfs::corners, Steal_dfs::animate_corners}},
+            {"stealbfs-hunt", {Steal_bfs::hunt, Steal_bfs::animate_hunt}},
+            {"stealbfs-gather",
+             {Steal_bfs::gather, Steal_bfs::animate_gather}},
+            {"stealbfs-corners",
+             {Steal_bfs::corners, Steal_bfs::animate_corners}},
+            {"junction-hunt", {Junction::hunt, Junction::animate_hunt}},
             {"darkfloodfs-hunt", {Floodfs::hunt, Dark_floodfs::animate_hunt}},
             {"darkfloodfs-gather",
              {Floodfs::gather, Dark_floodfs::animate_gather}},
@@ -130,6 +157,10 @@ main(int argc, char **argv) {
             {"contrast", Maze::Maze_style::contrast},
             {"spikes", Maze::Maze_style::spikes},
         },
+        .view_table={
+            {"overview", Printer::View::overview},
+            {"follow", Printer::View::follow},
+        },
         .solver_animation_table={
             {"0", Speed::Speed::instant},
             {"1", Speed::Speed::speed_1},
@@ -181,31 +212,89 @@ main(int argc, char **argv) {
 
     Maze::Maze maze(runner.args);
 
+    Printer::set_view(runner.view);
+
+    // Animations write to the cast instead of the terminal while this is alive
+    // and run as fast as they can be computed.
+    std::optional<Recorder::Recording> recording;
+    if (runner.cast_path) {
+        recording.emplace(*runner.cast_path, maze.col_size(),
+                          maze.row_size() + cast_footer_height);
+    }
+
+    // One line of counters for the build and one for the solve.
+    std::optional<std::ofstream> stats;
+    if (runner.stats_path) {
+        stats.emplace(*runner.stats_path);
+        if (!*stats) {
+            std::cerr << "Could not open stats file " << *runner.stats_path
+                      << "\n";
+            std::exit(1);
+        }
+    }
+    Stats::reset();
+
     // Functions are stored in tuples so use tuple get syntax and then call them
     // immidiately.
 
     if (runner.builder_view == animated_playback) {
-        std::get<animated_playback>(runner.builder)(maze, runner.builder_speed);
+        {
+            Trace::Scope const trace("build");
+            std::get<animated_playback>(runner.builder)(maze,
+                                                        runner.builder_speed);
+        }
         if (runner.modder) {
+            Trace::Scope const trace("mods");
             std::get<animated_playback>(runner.modder.value())(
                 maze, runner.builder_speed);
         }
     } else {
-        std::get<static_image>(runner.builder)(maze);
+        {
+            Trace::Scope const trace("build");
+            std::get<static_image>(runner.builder)(maze);
+        }
         if (runner.modder) {
+            Trace::Scope const trace("mods");
             std::get<static_image>(runner.modder.value())(maze);
         }
     }
 
+    if (stats) {
+        Stats::write_json(*stats, "build");
+    }
+    Stats::reset();
+
     // This helps ensure we have a smooth transition from build to solve with no
     // flashing from redrawing frame.
     Printer::set_cursor_position({.row = 0, .col = 0});
 
     if (runner.solver_view == animated_playback) {
+        Trace::Scope const trace("solve");
         std::get<animated_playback>(runner.solver)(maze, runner.solver_speed);
     } else {
+        Trace::Scope const trace("solve");
         std::get<static_image>(runner.solver)(maze);
     }
+    if (stats) {
+        Stats::write_json(*stats, "solve");
+    }
+    if (runner.image_path) {
+        Trace::Scope const trace("image");
+        Image::write_solution(maze, *runner.image_path);
+    }
+    if (runner.svg_path) {
+        Trace::Scope const trace("svg");
+        Svg::write_solution(maze, *runner.svg_path);
+    }
+    if (runner.trace_path) {
+        std::ofstream trace(*runner.trace_path);
+        if (!trace) {
+            std::cerr << "Could not open trace file " << *runner.trace_path
+                      << "\n";
+            std::exit(1);
+        }
+        Trace::write_json(trace);
+    }
     return 0;
 }
 
@@ -274,6 +363,44 @@ set_relevant_arg(Lookup_tables const &tables, Maze_runner &runner,
         runner.modification_getter = animated_playback;
         return;
     }
+    if (pairs.flag == "-v") {
+        auto const found = tables.view_table.find(arg_data);
+        if (found == tables.view_table.end()) {
+            print_invalid_arg(pairs);
+        }
+        runner.view = found->second;
+        return;
+    }
+    if (pairs.flag == "-rec") {
+        runner.cast_path = arg_data;
+        return;
+    }
+    if (pairs.flag == "-img") {
+        runner.image_path = arg_data;
+        return;
+    }
+    if (pairs.flag == "-svg") {
+        runner.svg_path = arg_data;
+        return;
+    }
+    if (pairs.flag == "-stats") {
+        if (!Stats::enabled) {
+            std::cerr << "Counting is compiled out. Configure the build with "
+                         "-DMAZE_STATS=ON to use -stats.\n";
+            std::exit(1);
+        }
+        runner.stats_path = arg_data;
+        return;
+    }
+    if (pairs.flag == "-trace") {
+        if (!Trace::enabled) {
+            std::cerr << "Tracing is compiled out. Configure the build with "
+                         "-DMAZE_TRACE=ON to use -trace.\n";
+            std::exit(1);
+        }
+        runner.trace_path = arg_data;
+        return;
+    }
     print_invalid_arg(pairs);
 }
 
@@ -341,12 +468,16 @@ print_usage() {
     │           floodfs-hunt - Depth First Search │   │   │   │ │ │       │
     │ ┌───────┬─floodfs-gather - Depth First Search ┌─┴─╴ │ ╶─┴─┤ └───────┤
     │ │       │ floodfs-corners - Depth First Search│     │     │         │
+    │ │       │ deadend-[game] - Dead End Filling   │     │     │         │
     │ │ ╷ ┌─╴ │ rdfs-hunt - Randomized Depth First Search─┴─┬─╴ │ ┌─────╴ │
     │ │ │ │   │ rdfs-gather - Randomized Depth First Search │   │ │       │
     │ └─┤ └───┤ rdfs-corners - Randomized Depth First Search┤ ┌─┘ │ ╶───┐ │
     │   │     │ bfs-hunt - Breadth First Search     │   │   │ │   │     │ │
     ├─┐ │ ┌─┐ └─bfs-gather - Breadth First Search─┐ ╵ ╷ ├─╴ │ └─┐ ├───╴ │ │
     │ │ │ │ │   bfs-corners - Breadth First Search│   │ │   │   │ │     │ │
+    │ │ │ │ │   stealdfs-[game] - Work Stealing DFS   │ │   │   │ │     │ │
+    │ │ │ │ │   stealbfs-[game] - Work Stealing BFS   │ │   │   │ │     │ │
+    │ │ │ │ │   junction-hunt - Junction Graph Search │ │   │   │ │     │ │
     │ │ │ │ │   dark[solver]-[game] - A mystery...    │ │   │   │ │     │ │
     │ │ │ ╵ └─-d Draw flag. Set the line style for the maze.┴─┐ └─┘ ┌─┬─┘ │
     │ │ │       sharp - The default straight lines. │   │     │     │ │   │
@@ -359,6 +490,19 @@ print_usage() {
     │ │ ╵ │ ╶─┤ Any number 1-7. Speed increases with number.┌─┘ ┌─┤ ╵ │ ╶─┤
     │ │   │   -ba Builder Animation flag. Watch the maze build. │ │   │   │
     │ ├─╴ ├─┐ └─Any number 1-7. Speed increases with number.┘ ┌─┘ │ ┌─┴─┐ │
+    │ │   │ │ -rec Record flag. Save it to a file.    │   │   │   │ │   │ │
+    │ │   │ │ Any file name. Play with ./replay.      │   │   │   │ │   │ │
+    │ │   │ │ -img Image flag. Save the solved maze.  │   │   │   │ │   │ │
+    │ │   │ │ File name ending .png or .ppm.          │   │   │   │ │   │ │
+    │ │   │ │ -svg Vector flag. Save the solved maze. │   │   │   │ │   │ │
+    │ │   │ │ File name ending .svg.                  │   │   │   │ │   │ │
+    │ │   │ │ -stats Stats flag. Count work per thread│   │   │   │ │   │ │
+    │ │   │ │ Any file name. Needs MAZE_STATS.        │   │   │   │ │   │ │
+    │ │   │ │ -trace Trace flag. Timeline of phases.  │   │   │   │ │   │ │
+    │ │   │ │ File name ending .json. Needs MAZE_TRACE│   │   │   │ │   │ │
+    │ │   │ │ -v View flag. For mazes over the screen.│   │   │   │ │   │ │
+    │ │   │ │ overview - The whole maze in blocks.    │   │   │   │ │   │ │
+    │ │   │ │ follow - Pan after the busiest thread.  │   │   │   │ │   │ │
     │ │   │ │ -h Help flag. Make this prompt appear.  │   │   │   │ │   │ │
     │ └─┐ ╵ └─┐ No arguments.─┘ ┌───┐ └─┐ ├─╴ │ ╵ └───┤ ┌─┘ ┌─┴─╴ │ ├─╴ │ │
     │   │     -If any flags are omitted, defaults are used. │     │ │   │ │
@@ -0,0 +1,162 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <thread>
+#include <vector>
+export module labyrinth:batch;
+import :maze;
+import :solve_utilities;
+import :my_queue;
+
+//////////////////////////////////   Exported Interface
+
+export namespace Batch {
+
+constexpr uint64_t no_path = UINT64_MAX;
+
+struct Query {
+    Maze::Point start;
+    Maze::Point finish;
+};
+
+struct Query_result {
+    // Steps taken along the shortest path from start to finish or no_path if
+    // the finish cannot be reached.
+    uint64_t path_len{no_path};
+    // Only filled when requested. Runs from start to finish inclusive.
+    std::vector<Maze::Point> path;
+};
+
+struct Batch_args {
+    bool keep_paths = false;
+    uint64_t workers = Sutil::num_threads;
+};
+
+/// Solves every start and finish pair against one maze with a shortest path
+/// breadth first search. The maze is only read, never painted, so it may be
+/// reused for as many batches as needed. Results are returned in query order.
+std::vector<Query_result> solve(Maze::Maze const &maze,
+                                std::span<Query const> queries,
+                                Batch_args const &args);
+
+} // namespace Batch
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+/// Each worker owns its scratch space for the entire batch. Rather than clear
+/// a visited set before every query we move the marks to a new epoch.
+struct Batch_worker {
+    Sutil::Epoch_marks seen;
+    std::vector<int> parents;
+    My_queue<int> bfs;
+    explicit Batch_worker(uint64_t squares) : parents(squares, 0) {
+        bfs.reserve(Sutil::initial_path_len);
+    }
+};
+
+bool
+is_open_interior(Maze::Maze const &maze, Maze::Point const &p) {
+    return p.row > 0 && p.row < maze.row_size() - 1 && p.col > 0
+           && p.col < maze.col_size() - 1
+           && (maze[p.row][p.col] & Maze::path_bit);
+}
+
+Batch::Query_result
+bfs_query(Maze::Maze const &maze, Batch_worker &worker,
+          Batch::Query const &query, bool keep_paths) {
+    Batch::Query_result result{};
+    if (!is_open_interior(maze, query.start)
+        || !is_open_interior(maze, query.finish)) {
+        return result;
+    }
+    int const cols = maze.col_size();
+    int const start = (query.start.row * cols) + query.start.col;
+    int const finish = (query.finish.row * cols) + query.finish.col;
+    worker.seen.next_epoch(maze);
+    worker.bfs.clear();
+    worker.seen.mark(query.start);
+    worker.parents[start] = start;
+    worker.bfs.push(start);
+    bool found = false;
+    while (!worker.bfs.empty()) {
+        int const cur = worker.bfs.front();
+        worker.bfs.pop();
+        if (cur == finish) {
+            found = true;
+            break;
+        }
+        Maze::Point const cur_p = {cur / cols, cur % cols};
+        for (Maze::Point const &p : Sutil::dirs) {
+            Maze::Point const next = {cur_p.row + p.row, cur_p.col + p.col};
+            int const next_i = (next.row * cols) + next.col;
+            if (!worker.seen.is_marked(next)
+                && (maze[next.row][next.col] & Maze::path_bit)) {
+                worker.seen.mark(next);
+                worker.parents[next_i] = cur;
+                worker.bfs.push(next_i);
+            }
+        }
+    }
+    if (!found) {
+        return result;
+    }
+    result.path_len = 0;
+    for (int cur = finish; cur != start; cur = worker.parents[cur]) {
+        if (keep_paths) {
+            result.path.push_back({cur / cols, cur % cols});
+        }
+        ++result.path_len;
+    }
+    if (keep_paths) {
+        result.path.push_back(query.start);
+        std::reverse(result.path.begin(), result.path.end());
+    }
+    return result;
+}
+
+void
+batch_worker(Maze::Maze const &maze, std::span<Batch::Query const> queries,
+             std::vector<Batch::Query_result> &results,
+             std::atomic_uint64_t &next_query, bool keep_paths) {
+    Batch_worker worker(static_cast<uint64_t>(maze.row_size())
+                        * static_cast<uint64_t>(maze.col_size()));
+    for (uint64_t i = next_query.fetch_add(1, std::memory_order_relaxed);
+         i < queries.size();
+         i = next_query.fetch_add(1, std::memory_order_relaxed)) {
+        results[i] = bfs_query(maze, worker, queries[i], keep_paths);
+    }
+}
+
+} // namespace
+
+namespace Batch {
+
+std::vector<Query_result>
+solve(Maze::Maze const &maze, std::span<Query const> queries,
+      Batch_args const &args) {
+    std::vector<Query_result> results(queries.size());
+    if (queries.empty()) {
+        return results;
+    }
+    // No sense in spinning up workers that will never claim a query.
+    uint64_t const workers
+        = std::clamp(args.workers, uint64_t{1}, uint64_t{queries.size()});
+    std::atomic_uint64_t next_query{0};
+    std::vector<std::thread> threads(workers);
+    for (std::thread &t : threads) {
+        t = std::thread(batch_worker, std::cref(maze), queries,
+                        std::ref(results), std::ref(next_query),
+                        args.keep_paths);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return results;
+}
+
+} // namespace Batch
@@ -1,6 +1,5 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -12,8 +11,11 @@ module;
 #include <vector>
 export module labyrinth:bfs;
 import :maze;
+import :stats;
+import :trace;
 import :speed;
 import :printers;
+import :render;
 import :solve_utilities;
 import :my_queue;
 
@@ -32,8 +34,13 @@ void animate_corners(Maze::Maze &maze, Speed::Speed speed);
 
 namespace {
 
+template <class Render_policy, Maze::Visit_marks Marks>
 void
-hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id) {
+hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id,
+       Render_policy const &render) {
+    Trace::Scope const trace("bfs hunter");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     // This will be how we rebuild the path because queue does not represent the
     // current path.
@@ -44,7 +51,7 @@ hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id) {
     bfs.push(monitor.starts.at(id.index));
     Maze::Point cur = monitor.starts.at(id.index);
     while (!bfs.empty()) {
-        if (monitor.winning_index.load() != Sutil::no_winner) {
+        if (monitor.cancelled.load(std::memory_order_relaxed)) {
             break;
         }
 
@@ -52,18 +59,26 @@ hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id) {
         bfs.pop();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            static_cast<void>(
-                monitor.winning_index.ces(Sutil::no_winner, id.index));
+            Stats::reached_finish();
+            Sutil::declare_winner(monitor, id.index);
             break;
         }
         // This creates a nice fanning out of mixed color for each searching
-        // thread.
-        maze[cur.row][cur.col] |= paint_bit;
+        // thread. An animation must paint the grid to show it.
+        if constexpr (Render_policy::animated
+                      || Marks == Maze::Visit_marks::grid) {
+            maze[cur.row][cur.col] |= paint_bit;
+            render.draw(maze, cur);
+        } else {
+            monitor.thread_marks[id.index].mark(cur);
+        }
 
+        ++stats.expanded;
         // Bias each thread towards the direction it was dispatched when we
         // first sent it.
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
             bool const seen_next = seen.contains(next);
@@ -84,65 +99,13 @@ hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id) {
     }
 }
 
+template <class Render_policy, Maze::Visit_marks Marks>
 void
-animate_hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
-               Sutil::Thread_id id) {
-    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
-    // This will be how we rebuild the path because queue does not represent the
-    // current path.
-    std::unordered_map<Maze::Point, Maze::Point> &seen
-        = monitor.thread_maps[id.index];
-    seen[monitor.starts.at(id.index)] = {-1, -1};
-    My_queue<Maze::Point> &bfs = monitor.thread_queues[id.index];
-    bfs.push(monitor.starts.at(id.index));
-    Maze::Point cur = monitor.starts.at(id.index);
-    while (!bfs.empty()) {
-        if (monitor.winning_index.load() != Sutil::no_winner) {
-            break;
-        }
-
-        cur = bfs.front();
-        bfs.pop();
-
-        if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            static_cast<void>(
-                monitor.winning_index.ces(Sutil::no_winner, id.index));
-            break;
-        }
-        // This creates a nice fanning out of mixed color for each searching
-        // thread.
-        maze[cur.row][cur.col] |= paint_bit;
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
-
-        // Bias each thread towards the direction it was dispatched when we
-        // first sent it.
-        for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
-             count++, ++i %= Sutil::dirs.size()) {
-            Maze::Point const &p = Sutil::dirs.at(i);
-            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
-
-            bool const push_next
-                = !seen.contains(next)
-                  && (maze[next.row][next.col] & Maze::path_bit);
-            if (push_next) {
-                seen[next] = cur;
-                bfs.push(next);
-            }
-        }
-    }
-    cur = seen.at(cur);
-    while (cur.row > 0) {
-        monitor.thread_paths[id.index].push_back(cur);
-        cur = seen.at(cur);
-    }
-}
-
-void
-gatherer(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id) {
+gatherer(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id,
+         Render_policy const &render) {
+    Trace::Scope const trace("bfs gatherer");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     std::unordered_map<Maze::Point, Maze::Point> &seen
         = monitor.thread_maps[id.index];
     Sutil::Thread_cache const seen_bit(id.bit << Sutil::thread_cache_shift);
@@ -157,64 +120,26 @@ gatherer(Maze::Maze &maze, Sutil::Bfs_monitor &monitor, Sutil::Thread_id id) {
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit
             && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
+            Stats::reached_finish();
             maze[cur.row][cur.col] |= seen_bit;
             break;
         }
-        maze[cur.row][cur.col] |= paint_bit;
-        maze[cur.row][cur.col] |= seen_bit;
-
-        for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
-             count++, ++i %= Sutil::dirs.size()) {
-            Maze::Point const &p = Sutil::dirs.at(i);
-            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
-            bool const push_next
-                = !seen.contains(next)
-                  && (maze[next.row][next.col] & Maze::path_bit);
-            if (push_next) {
-                seen[next] = cur;
-                bfs.push(next);
-            }
-        }
-    }
-    cur = seen.at(cur);
-    while (cur.row > 0) {
-        monitor.thread_paths[id.index].push_back(cur);
-        cur = seen.at(cur);
-    }
-    monitor.winning_index.store(id.index);
-}
-
-void
-animate_gatherer(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
-                 Sutil::Thread_id id) {
-    std::unordered_map<Maze::Point, Maze::Point> &seen
-        = monitor.thread_maps[id.index];
-    Sutil::Thread_cache const seen_bit(id.bit << Sutil::thread_cache_shift);
-    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
-    seen[monitor.starts[id.index]] = {-1, -1};
-    My_queue<Maze::Point> &bfs = monitor.thread_queues[id.index];
-    bfs.push(monitor.starts.at(id.index));
-    Maze::Point cur = monitor.starts.at(id.index);
-    while (!bfs.empty()) {
-        cur = bfs.front();
-        bfs.pop();
-
-        if (maze[cur.row][cur.col] & Sutil::finish_bit
-            && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
+        // Only a finish needs our cache bit, to claim it, so private marks
+        // leave the rest of the grid alone. An animation must paint the grid
+        // to show it.
+        if constexpr (Render_policy::animated
+                      || Marks == Maze::Visit_marks::grid) {
+            maze[cur.row][cur.col] |= paint_bit;
             maze[cur.row][cur.col] |= seen_bit;
-            break;
+            render.draw(maze, cur);
+        } else {
+            monitor.thread_marks[id.index].mark(cur);
         }
-        maze[cur.row][cur.col] |= paint_bit;
-        maze[cur.row][cur.col] |= seen_bit;
-
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
 
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
             bool const push_next
@@ -243,22 +168,29 @@ namespace Bfs {
 void
 hunt(Maze::Maze &maze) {
     Sutil::Bfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
                                               Sutil::pick_random_point(maze));
     maze[monitor.starts.at(0).row][monitor.starts.at(0).col]
         |= Sutil::start_bit;
     Maze::Point const finish = Sutil::pick_random_point(maze);
     maze[finish.row][finish.col] |= Sutil::finish_bit;
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? hunter<Render::No_render, grid>
+                             : hunter<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
     for (std::thread &t : threads) {
         t.join();
     }
+    Sutil::publish_paint(maze, monitor.thread_marks);
 
     if (monitor.winning_index.load() != Sutil::no_winner) {
         // It is cool to see the shortest path that the winning thread took to
@@ -276,13 +208,14 @@ hunt(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Bfs_monitor monitor;
     monitor.speed
         = Sutil::solver_speeds.at(static_cast<Speed::Speed_unit>(speed));
@@ -293,15 +226,16 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Maze::Point const finish = Sutil::pick_random_point(maze);
     maze[finish.row][finish.col] |= Sutil::finish_bit;
     Sutil::flush_cursor_path_coordinate(maze, finish);
-    std::this_thread::sleep_for(
-        std::chrono::microseconds(monitor.speed.value_or(0)));
+    Speed::pace(monitor.speed.value_or(0));
 
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            hunter<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -319,20 +253,20 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
             maze[p.row][p.col] &= ~Sutil::thread_paint_mask;
             maze[p.row][p.col] |= winner_color;
             Sutil::flush_cursor_path_coordinate(maze, p);
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            Speed::pace(monitor.speed.value_or(0));
         }
     }
 
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 gather(Maze::Maze &maze) {
     Sutil::Bfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
                                               Sutil::pick_random_point(maze));
     maze[monitor.starts.at(0).row][monitor.starts.at(0).col]
@@ -342,17 +276,23 @@ gather(Maze::Maze &maze) {
         Maze::Point const finish = Sutil::pick_random_point(maze);
         maze[finish.row][finish.col] |= Sutil::finish_bit;
     }
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? gatherer<Render::No_render, grid>
+                             : gatherer<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    Sutil::publish_paint(maze, monitor.thread_marks);
     int thread = 0;
     for (std::vector<Maze::Point> const &path : monitor.thread_paths) {
         Sutil::Thread_paint const color(Sutil::thread_bits.at(thread)
@@ -365,13 +305,14 @@ gather(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
 animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Bfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -383,16 +324,17 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
         Maze::Point const finish = Sutil::pick_random_point(maze);
         maze[finish.row][finish.col] |= Sutil::finish_bit;
         Sutil::flush_cursor_path_coordinate(maze, finish);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
 
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            gatherer<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -407,19 +349,19 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
         maze[p.row][p.col] &= ~Sutil::thread_paint_mask;
         maze[p.row][p.col] |= color;
         Sutil::flush_cursor_path_coordinate(maze, p);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
         ++i_thread;
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
 corners(Maze::Maze &maze) {
     Sutil::Bfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = Sutil::set_corner_starts(maze);
     for (Maze::Point const &p : monitor.starts) {
         maze[p.row][p.col] |= Sutil::start_bit;
@@ -432,62 +374,68 @@ corners(Maze::Maze &maze) {
     maze[finish.row][finish.col] |= Maze::path_bit;
     maze[finish.row][finish.col] |= Sutil::finish_bit;
 
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? hunter<Render::No_render, grid>
+                             : hunter<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
     for (std::thread &t : threads) {
         t.join();
     }
+    Sutil::publish_paint(maze, monitor.thread_marks);
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Bfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = Sutil::set_corner_starts(maze);
     for (Maze::Point const &p : monitor.starts) {
         maze[p.row][p.col] |= Sutil::start_bit;
         Sutil::flush_cursor_path_coordinate(maze, p);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
     Maze::Point const finish = {maze.row_size() / 2, maze.col_size() / 2};
     for (Maze::Point const &p : Sutil::all_dirs) {
         Maze::Point const next = {finish.row + p.row, finish.col + p.col};
         maze[next.row][next.col] |= Maze::path_bit;
         Sutil::flush_cursor_path_coordinate(maze, next);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
     maze[finish.row][finish.col] |= Maze::path_bit;
     maze[finish.row][finish.col] |= Sutil::finish_bit;
     Sutil::flush_cursor_path_coordinate(maze, finish);
-    std::this_thread::sleep_for(
-        std::chrono::microseconds(monitor.speed.value_or(0)));
+    Speed::pace(monitor.speed.value_or(0));
 
     std::vector<std::thread> threads(Sutil::num_threads);
     // Randomly shuffle start corners so colors mix differently each time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            hunter<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
     for (std::thread &t : threads) {
         t.join();
@@ -502,15 +450,14 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
             maze[p.row][p.col] &= ~Sutil::thread_paint_mask;
             maze[p.row][p.col] |= winner_color;
             Sutil::flush_cursor_path_coordinate(maze, p);
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            Speed::pace(monitor.speed.value_or(0));
         }
     }
 
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 } // namespace Bfs
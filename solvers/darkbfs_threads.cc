@@ -1,6 +1,5 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -12,8 +11,11 @@ module;
 #include <vector>
 export module labyrinth:dark_bfs;
 import :maze;
+import :stats;
+import :trace;
 import :speed;
 import :printers;
+import :render;
 import :solve_utilities;
 import :my_queue;
 
@@ -31,7 +33,10 @@ namespace {
 
 void
 animate_hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
-               Sutil::Thread_id id) {
+               Sutil::Thread_id id, Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkbfs animate_hunter");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     // This will be how we rebuild the path because queue does not represent the
     // current path.
@@ -44,7 +49,7 @@ animate_hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
     while (!bfs.empty()) {
         // Lock? Garbage read stolen mid write by winning thread is still ok for
         // program logic.
-        if (monitor.winning_index.load() != Sutil::no_winner) {
+        if (monitor.cancelled.load(std::memory_order_relaxed)) {
             break;
         }
 
@@ -52,25 +57,22 @@ animate_hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
         bfs.pop();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            if (monitor.winning_index.ces(Sutil::no_winner, id.index)) {
-                monitor.monitor.lock();
+            Stats::reached_finish();
+            if (Sutil::declare_winner(monitor, id.index)) {
                 Sutil::flush_cursor_path_coordinate(maze, cur);
-                monitor.monitor.unlock();
             }
             break;
         }
         // This creates fanning out of mixed color for each searching thread.
         maze[cur.row][cur.col] |= paint_bit;
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
+        ++stats.expanded;
         // Bias each thread towards the direction it was dispatched when we
         // first sent it.
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
 
@@ -93,7 +95,10 @@ animate_hunter(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
 
 void
 animate_gatherer(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
-                 Sutil::Thread_id id) {
+                 Sutil::Thread_id id, Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkbfs animate_gatherer");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     std::unordered_map<Maze::Point, Maze::Point> &seen
         = monitor.thread_maps[id.index];
     Sutil::Thread_cache const seen_bit(id.bit << Sutil::thread_cache_shift);
@@ -108,23 +113,20 @@ animate_gatherer(Maze::Maze &maze, Sutil::Bfs_monitor &monitor,
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit
             && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
+            Stats::reached_finish();
             maze[cur.row][cur.col] |= seen_bit;
-            monitor.monitor.lock();
             Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
             break;
         }
         maze[cur.row][cur.col] |= paint_bit;
         maze[cur.row][cur.col] |= seen_bit;
 
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
 
@@ -155,6 +157,8 @@ void
 animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Bfs_monitor monitor;
     Sutil::deluminate_maze(maze);
     monitor.speed
@@ -170,8 +174,9 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -189,15 +194,14 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
             maze[p.row][p.col] &= ~Sutil::thread_paint_mask;
             maze[p.row][p.col] |= winner_color;
             Sutil::flush_cursor_path_coordinate(maze, p);
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            Speed::pace(monitor.speed.value_or(0));
         }
     }
 
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
@@ -205,6 +209,8 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Bfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -221,8 +227,9 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_gatherer, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -237,14 +244,13 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
         maze[p.row][p.col] &= ~Sutil::thread_paint_mask;
         maze[p.row][p.col] |= color;
         Sutil::flush_cursor_path_coordinate(maze, p);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
         i_thread++;
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
@@ -252,6 +258,8 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Bfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = Sutil::set_corner_starts(maze);
@@ -268,12 +276,13 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
 
     std::vector<std::thread> threads(Sutil::num_threads);
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
     for (std::thread &t : threads) {
         t.join();
@@ -288,15 +297,14 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
             maze[p.row][p.col] &= ~Sutil::thread_paint_mask;
             maze[p.row][p.col] |= winner_color;
             Sutil::flush_cursor_path_coordinate(maze, p);
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            Speed::pace(monitor.speed.value_or(0));
         }
     }
 
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 } // namespace Dark_bfs
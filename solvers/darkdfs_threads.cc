@@ -1,7 +1,6 @@
 module;
 #include <algorithm>
 #include <array>
-#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -13,8 +12,11 @@ module;
 #include <vector>
 export module labyrinth:dark_dfs;
 import :maze;
+import :stats;
+import :trace;
 import :speed;
 import :printers;
+import :render;
 import :solve_utilities;
 import :my_queue;
 
@@ -36,7 +38,11 @@ struct Thread_light {
 };
 
 void
-animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Thread_light id) {
+animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Thread_light id,
+               Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkdfs animate_hunter");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
@@ -45,7 +51,7 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Thread_light id) {
     while (!dfs.empty()) {
         // Lock? Garbage read stolen mid write by winning thread is still ok for
         // program logic.
-        if (monitor.winning_index.load() != Sutil::no_winner) {
+        if (monitor.cancelled.load(std::memory_order_relaxed)) {
             return;
         }
 
@@ -53,27 +59,24 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Thread_light id) {
         cur = dfs.back();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            if (monitor.winning_index.ces(Sutil::no_winner, id.index)) {
-                monitor.monitor.lock();
+            Stats::reached_finish();
+            if (Sutil::declare_winner(monitor, id.index)) {
                 Sutil::flush_cursor_path_coordinate(maze, cur);
-                monitor.monitor.unlock();
             }
             dfs.pop_back();
             return;
         }
         maze[cur.row][cur.col] |= (paint | seen);
 
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
         // Bias each thread's first choice towards orginal dispatch direction.
         // More coverage.
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
             bool const push_next
@@ -88,19 +91,18 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Thread_light id) {
 
         if (!found_branch_to_explore) {
             maze[cur.row][cur.col] &= ~paint;
-            monitor.monitor.lock();
-            Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            render.draw(maze, cur);
             dfs.pop_back();
         }
     }
 }
 
 void
-animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-                 Thread_light id) {
+animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Thread_light id,
+                 Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkdfs animate_gatherer");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
@@ -111,24 +113,21 @@ animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
 
         if ((maze[cur.row][cur.col] & Sutil::finish_bit)
             && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
+            Stats::reached_finish();
             maze[cur.row][cur.col] |= seen;
-            monitor.monitor.lock();
             Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
             dfs.pop_back();
             return;
         }
         maze[cur.row][cur.col] |= (seen | paint);
 
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
             bool const push_next
@@ -142,11 +141,7 @@ animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
         }
         if (!found_branch_to_explore) {
             maze[cur.row][cur.col] &= ~paint;
-            monitor.monitor.lock();
-            Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            render.draw(maze, cur);
             dfs.pop_back();
         }
     }
@@ -162,6 +157,8 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
     Printer::set_cursor_position({0, 0});
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -175,17 +172,18 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Thread_light const this_thread{i_thread,
                                        Sutil::thread_bits.at(i_thread)};
-        threads.at(i_thread) = std::thread(animate_hunter, std::ref(maze),
-                                           std::ref(monitor), this_thread);
+        threads.at(i_thread) = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
@@ -193,6 +191,8 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -209,17 +209,18 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Thread_light const this_thread{i_thread,
                                        Sutil::thread_bits.at(i_thread)};
-        threads.at(i_thread) = std::thread(animate_gatherer, std::ref(maze),
-                                           std::ref(monitor), this_thread);
+        threads.at(i_thread) = std::thread(
+            animate_gatherer, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
@@ -227,6 +228,8 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = Sutil::set_corner_starts(maze);
@@ -245,20 +248,21 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Thread_light const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 } // namespace Dark_dfs
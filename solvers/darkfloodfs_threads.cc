@@ -1,6 +1,5 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -11,8 +10,11 @@ module;
 #include <vector>
 export module labyrinth:dark_floodfs;
 import :maze;
+import :stats;
+import :trace;
 import :speed;
 import :printers;
+import :render;
 import :solve_utilities;
 import :my_queue;
 
@@ -30,7 +32,10 @@ namespace {
 
 void
 animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-               Sutil::Thread_id id) {
+               Sutil::Thread_id id, Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkfloodfs animate_hunter");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
@@ -39,7 +44,7 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
     while (!dfs.empty()) {
         // Lock? Garbage read stolen mid write by winning thread is still ok for
         // program logic.
-        if (monitor.winning_index.load() != Sutil::no_winner) {
+        if (monitor.cancelled.load(std::memory_order_relaxed)) {
             return;
         }
 
@@ -47,26 +52,23 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
         cur = dfs.back();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            if (monitor.winning_index.ces(Sutil::no_winner, id.index)) {
-                monitor.monitor.lock();
+            Stats::reached_finish();
+            if (Sutil::declare_winner(monitor, id.index)) {
                 Sutil::flush_cursor_path_coordinate(maze, cur);
-                monitor.monitor.unlock();
             }
             dfs.pop_back();
             return;
         }
         maze[cur.row][cur.col] |= (seen | paint_bit);
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
         // Bias each thread's first choice towards orginal dispatch direction.
         // More coverage.
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
             bool const push_next
@@ -86,7 +88,10 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
 
 void
 animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-                 Sutil::Thread_id id) {
+                 Sutil::Thread_id id, Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkfloodfs animate_gatherer");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
@@ -97,24 +102,21 @@ animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
 
         if ((maze[cur.row][cur.col] & Sutil::finish_bit)
             && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
+            Stats::reached_finish();
             maze[cur.row][cur.col] |= seen;
-            monitor.monitor.lock();
             Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
             dfs.pop_back();
             return;
         }
 
         maze[cur.row][cur.col] |= (seen | paint_bit);
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
             bool const push_next
@@ -144,6 +146,8 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -157,8 +161,9 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -173,13 +178,12 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
             = monitor.thread_paths.at(monitor.winning_index.load()).back();
         maze[before_finish.row][before_finish.col] |= winner_color;
         Sutil::flush_cursor_path_coordinate(maze, before_finish);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
@@ -187,6 +191,8 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -203,8 +209,9 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_gatherer, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -219,14 +226,13 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
         maze[p.row][p.col] &= ~Sutil::thread_paint_mask;
         maze[p.row][p.col] |= color;
         Sutil::flush_cursor_path_coordinate(maze, p);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
         ++i_thread;
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
@@ -234,6 +240,8 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = Sutil::set_corner_starts(maze);
@@ -252,12 +260,13 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
     for (std::thread &t : threads) {
         t.join();
@@ -271,14 +280,13 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
             = monitor.thread_paths.at(monitor.winning_index.load()).back();
         maze[before_finish.row][before_finish.col] |= winner_color;
         Sutil::flush_cursor_path_coordinate(maze, before_finish);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
 
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 } // namespace Dark_floodfs
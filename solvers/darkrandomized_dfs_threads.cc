@@ -1,6 +1,5 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <functional>
 #include <iostream>
 #include <mutex>
@@ -11,8 +10,11 @@ module;
 #include <vector>
 export module labyrinth:dark_rdfs;
 import :maze;
+import :stats;
+import :trace;
 import :speed;
 import :printers;
+import :render;
 import :solve_utilities;
 import :my_queue;
 
@@ -30,7 +32,10 @@ namespace {
 
 void
 animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-               Sutil::Thread_id id) {
+               Sutil::Thread_id id, Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkrdfs animate_hunter");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
@@ -39,11 +44,11 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
     std::vector<int> random_direction_indices(Sutil::dirs.size());
     std::iota(begin(random_direction_indices), end(random_direction_indices),
               0);
-    std::mt19937 generator(std::random_device{}());
+    std::mt19937 generator(Maze::random_seed());
     while (!dfs.empty()) {
         // Lock? Garbage read stolen mid write by winning thread is still ok for
         // program logic.
-        if (monitor.winning_index.load() != Sutil::no_winner) {
+        if (monitor.cancelled.load(std::memory_order_relaxed)) {
             return;
         }
 
@@ -51,27 +56,24 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
         cur = dfs.back();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            if (monitor.winning_index.ces(Sutil::no_winner, id.index)) {
-                monitor.monitor.lock();
+            Stats::reached_finish();
+            if (Sutil::declare_winner(monitor, id.index)) {
                 Sutil::flush_cursor_path_coordinate(maze, cur);
-                monitor.monitor.unlock();
             }
             dfs.pop_back();
             return;
         }
         maze[cur.row][cur.col] |= (seen | paint_bit);
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
         // Bias each thread's first choice towards orginal dispatch direction.
         // More coverage.
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         shuffle(begin(random_direction_indices), end(random_direction_indices),
                 generator);
         for (int const &i : random_direction_indices) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
 
@@ -88,11 +90,7 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
 
         if (!found_branch_to_explore) {
             maze[cur.row][cur.col] &= ~paint_bit;
-            monitor.monitor.lock();
-            Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            render.draw(maze, cur);
             dfs.pop_back();
         }
     }
@@ -100,7 +98,10 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
 
 void
 animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-                 Sutil::Thread_id id) {
+                 Sutil::Thread_id id, Sutil::Terminal_render const &render) {
+    Trace::Scope const trace("darkrdfs animate_gatherer");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
     Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
@@ -109,30 +110,27 @@ animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
     std::vector<int> random_direction_indices(Sutil::dirs.size());
     std::iota(begin(random_direction_indices), end(random_direction_indices),
               0);
-    std::mt19937 generator(std::random_device{}());
+    std::mt19937 generator(Maze::random_seed());
     while (!dfs.empty()) {
         cur = dfs.back();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit
             && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
+            Stats::reached_finish();
             maze[cur.row][cur.col] |= seen;
-            monitor.monitor.lock();
             Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
             dfs.pop_back();
             return;
         }
         maze[cur.row][cur.col] |= (seen | paint_bit);
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        render.draw(maze, cur);
 
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         shuffle(begin(random_direction_indices), end(random_direction_indices),
                 generator);
         for (int const &i : random_direction_indices) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
 
@@ -149,11 +147,7 @@ animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
 
         if (!found_branch_to_explore) {
             maze[cur.row][cur.col] &= ~paint_bit;
-            monitor.monitor.lock();
-            Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
+            render.draw(maze, cur);
             dfs.pop_back();
         }
     }
@@ -170,6 +164,8 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -183,17 +179,18 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
@@ -201,6 +198,8 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -217,17 +216,18 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_gatherer, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
@@ -235,6 +235,8 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
     Sutil::deluminate_maze(maze);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::unknown);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = Sutil::set_corner_starts(maze);
@@ -253,20 +255,21 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            animate_hunter, std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 } // namespace Dark_rdfs
@@ -0,0 +1,332 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <vector>
+export module labyrinth:dead_end;
+import :maze;
+import :speed;
+import :printers;
+import :render;
+import :solve_utilities;
+
+//////////////////////////////////   Exported Interface
+
+/// Dead end filling needs no search at all. Any open square other than a start
+/// or finish with at most one open neighbor is a dead end and is filled, which
+/// may make its neighbor a dead end in turn. When nothing is left to fill only
+/// the paths joining the starts and finishes remain. Each thread fills the
+/// dead ends in its own band of rows and is painted in its color.
+export namespace Dead_end {
+
+/// Fills every dead end in the maze not holding a start or finish bit. Filled
+/// squares lose their path bit so any solver run afterward treats them as
+/// walls and searches a much smaller maze. Returns the squares filled.
+uint64_t fill(Maze::Maze &maze);
+
+void hunt(Maze::Maze &maze);
+void animate_hunt(Maze::Maze &maze, Speed::Speed speed);
+void gather(Maze::Maze &maze);
+void animate_gather(Maze::Maze &maze, Speed::Speed speed);
+void corners(Maze::Maze &maze);
+void animate_corners(Maze::Maze &maze, Speed::Speed speed);
+
+} // namespace Dead_end
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+struct Band {
+    int first_row;
+    int last_row;
+};
+
+struct Fill_monitor {
+    std::vector<Band> bands{};
+    std::atomic_uint64_t filled{0};
+};
+
+constexpr Maze::Square_bits keep_mask = Sutil::start_bit | Sutil::finish_bit;
+
+bool
+is_open(Maze::Maze const &maze, Maze::Point const &p) {
+    return (maze[p.row][p.col] & Maze::path_bit).load() != 0;
+}
+
+// Neighbors only ever close as we fill so a dead end seen once stays a dead
+// end no matter what the thread next door does afterward.
+std::optional<Maze::Point>
+dead_end_exit(Maze::Maze const &maze, Maze::Point const &p, bool &is_dead_end) {
+    std::optional<Maze::Point> exit{};
+    int open = 0;
+    for (Maze::Point const &d : Sutil::dirs) {
+        Maze::Point const next = {p.row + d.row, p.col + d.col};
+        if (is_open(maze, next)) {
+            exit = next;
+            ++open;
+        }
+    }
+    is_dead_end = open <= 1;
+    return exit;
+}
+
+bool
+is_in_band(Band const &band, Maze::Point const &p) {
+    return p.row >= band.first_row && p.row < band.last_row;
+}
+
+// Fills from p down the corridor for as long as each square is a dead end in
+// our band. Squares across the seam are left for the other thread or the next
+// fixup round.
+template <class Render_policy>
+uint64_t
+fill_chain(Maze::Maze &maze, Band const &band, Sutil::Thread_id id,
+           Maze::Point p, Render_policy const &render) {
+    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
+    uint64_t filled = 0;
+    for (;;) {
+        Maze::Square const &square = maze[p.row][p.col];
+        if (!(square & Maze::path_bit) || (square & keep_mask)) {
+            return filled;
+        }
+        bool is_dead_end = false;
+        std::optional<Maze::Point> const exit
+            = dead_end_exit(maze, p, is_dead_end);
+        if (!is_dead_end) {
+            return filled;
+        }
+        maze[p.row][p.col] &= static_cast<Maze::Square_bits>(~Maze::path_bit);
+        maze[p.row][p.col] |= paint_bit;
+        ++filled;
+        render.draw(maze, p);
+        if (!exit || !is_in_band(band, *exit)) {
+            return filled;
+        }
+        p = *exit;
+    }
+}
+
+template <class Render_policy>
+void
+fill_rows(Maze::Maze &maze, Fill_monitor &monitor, Sutil::Thread_id id,
+          std::vector<int> const &rows, Render_policy const &render) {
+    Band const &band = monitor.bands.at(id.index);
+    uint64_t filled = 0;
+    for (int const row : rows) {
+        for (int col = 1; col < maze.col_size() - 1; ++col) {
+            filled += fill_chain(maze, band, id, {row, col}, render);
+        }
+    }
+    monitor.filled.fetch_add(filled, std::memory_order_relaxed);
+}
+
+std::vector<Band>
+split_rows(Maze::Maze const &maze) {
+    std::vector<Band> bands;
+    int const interior = std::max(maze.row_size() - 2, 0);
+    int const per_band
+        = std::max((interior + Sutil::num_threads - 1) / Sutil::num_threads, 1);
+    for (int row = 1; row < maze.row_size() - 1; row += per_band) {
+        bands.push_back({row, std::min(row + per_band, maze.row_size() - 1)});
+    }
+    return bands;
+}
+
+template <class Render_policy>
+uint64_t
+fill_round(Maze::Maze &maze, Fill_monitor &monitor, bool seams_only,
+           Render_policy const &render) {
+    uint64_t const before = monitor.filled.load();
+    std::vector<std::thread> threads(monitor.bands.size());
+    std::vector<std::vector<int>> rows(monitor.bands.size());
+    for (uint16_t i_band = 0; i_band < monitor.bands.size(); ++i_band) {
+        Band const &band = monitor.bands[i_band];
+        if (seams_only) {
+            rows[i_band] = {band.first_row, band.last_row - 1};
+        } else {
+            for (int row = band.first_row; row < band.last_row; ++row) {
+                rows[i_band].push_back(row);
+            }
+        }
+        Sutil::Thread_id const this_thread{i_band,
+                                           Sutil::thread_bits.at(i_band)};
+        threads[i_band] = std::thread(
+            fill_rows<Render_policy>, std::ref(maze), std::ref(monitor),
+            this_thread, std::cref(rows[i_band]), render);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return monitor.filled.load() - before;
+}
+
+// One full pass over every band. After that the only dead ends left are ones
+// whose neighbor across a seam was filled too late for us to notice, so only
+// seam rows are revisited until a round fills nothing.
+template <class Render_policy>
+uint64_t
+fill_dead_ends(Maze::Maze &maze, Fill_monitor &monitor,
+               Render_policy const &render) {
+    monitor.bands = split_rows(maze);
+    static_cast<void>(fill_round(maze, monitor, false, render));
+    while (fill_round(maze, monitor, true, render) != 0) {
+    }
+    return monitor.filled.load();
+}
+
+template <class Render_policy>
+void
+paint_remaining(Maze::Maze &maze) {
+    for (int row = 1; row < maze.row_size() - 1; ++row) {
+        for (int col = 1; col < maze.col_size() - 1; ++col) {
+            if (!is_open(maze, {row, col})) {
+                continue;
+            }
+            maze[row][col] |= Sutil::thread_paint_mask;
+            if constexpr (Render_policy::animated) {
+                Sutil::flush_cursor_path_coordinate(maze, {row, col});
+            }
+        }
+    }
+}
+
+void
+print_fill_message(Maze::Maze const &maze, uint64_t filled) {
+    if (Printer::headless()) {
+        return;
+    }
+    uint64_t remaining = 0;
+    for (int row = 1; row < maze.row_size() - 1; ++row) {
+        for (int col = 1; col < maze.col_size() - 1; ++col) {
+            remaining += is_open(maze, {row, col});
+        }
+    }
+    std::cout << Sutil::ansi_wit << " " << filled
+              << " dead end squares filled leaving " << remaining
+              << " squares of path.\n\n";
+}
+
+template <class Render_policy>
+void
+place_corners(Maze::Maze &maze, Render_policy const &render) {
+    for (Maze::Point const &p : Sutil::set_corner_starts(maze)) {
+        maze[p.row][p.col] |= Sutil::start_bit;
+        render.draw(maze, p);
+    }
+    Maze::Point const finish = {maze.row_size() / 2, maze.col_size() / 2};
+    for (Maze::Point const &p : Sutil::all_dirs) {
+        Maze::Point const next = {finish.row + p.row, finish.col + p.col};
+        maze[next.row][next.col] |= Maze::path_bit;
+        render.draw(maze, next);
+    }
+    maze[finish.row][finish.col] |= Maze::path_bit;
+    maze[finish.row][finish.col] |= Sutil::finish_bit;
+    render.draw(maze, finish);
+}
+
+template <class Render_policy>
+void
+place_start_and_finishes(Maze::Maze &maze, int finishes,
+                         Render_policy const &render) {
+    Maze::Point const start = Sutil::pick_random_point(maze);
+    maze[start.row][start.col] |= Sutil::start_bit;
+    if constexpr (Render_policy::animated) {
+        Sutil::flush_cursor_path_coordinate(maze, start);
+    }
+    for (int finish_square = 0; finish_square < finishes; finish_square++) {
+        Maze::Point const finish = Sutil::pick_random_point(maze);
+        maze[finish.row][finish.col] |= Sutil::finish_bit;
+        render.draw(maze, finish);
+    }
+}
+
+void
+solve(Maze::Maze &maze) {
+    Fill_monitor monitor;
+    uint64_t const filled = fill_dead_ends(maze, monitor, Render::No_render{});
+    paint_remaining<Render::No_render>(maze);
+    Sutil::print_maze(maze);
+    Sutil::print_overlap_key();
+    print_fill_message(maze, filled);
+}
+
+void
+animate_solve(Maze::Maze &maze, Speed::Speed_unit speed) {
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
+    Fill_monitor monitor;
+    uint64_t const filled
+        = fill_dead_ends(maze, monitor, Sutil::Terminal_render{speed});
+    paint_remaining<Sutil::Terminal_render>(maze);
+    session.stop();
+    Printer::set_cursor_position(
+        {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
+    print_fill_message(maze, filled);
+}
+
+} // namespace
+
+namespace Dead_end {
+
+uint64_t
+fill(Maze::Maze &maze) {
+    Fill_monitor monitor;
+    return fill_dead_ends(maze, monitor, Render::No_render{});
+}
+
+void
+hunt(Maze::Maze &maze) {
+    place_start_and_finishes(maze, 1, Render::No_render{});
+    solve(maze);
+}
+
+void
+gather(Maze::Maze &maze) {
+    place_start_and_finishes(maze, Sutil::num_gather_finishes,
+                             Render::No_render{});
+    solve(maze);
+}
+
+void
+corners(Maze::Maze &maze) {
+    place_corners(maze, Render::No_render{});
+    solve(maze);
+}
+
+void
+animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
+    Printer::set_cursor_position({maze.row_size(), 0});
+    Sutil::print_overlap_key();
+    Speed::Speed_unit const step
+        = Sutil::solver_speeds.at(static_cast<int>(speed));
+    place_start_and_finishes(maze, 1, Sutil::Terminal_render{step});
+    animate_solve(maze, step);
+}
+
+void
+animate_gather(Maze::Maze &maze, Speed::Speed speed) {
+    Printer::set_cursor_position({maze.row_size(), 0});
+    Sutil::print_overlap_key();
+    Speed::Speed_unit const step
+        = Sutil::solver_speeds.at(static_cast<int>(speed));
+    place_start_and_finishes(maze, Sutil::num_gather_finishes,
+                             Sutil::Terminal_render{step});
+    animate_solve(maze, step);
+}
+
+void
+animate_corners(Maze::Maze &maze, Speed::Speed speed) {
+    Printer::set_cursor_position({maze.row_size(), 0});
+    Sutil::print_overlap_key();
+    Speed::Speed_unit const step
+        = Sutil::solver_speeds.at(static_cast<int>(speed));
+    place_corners(maze, Sutil::Terminal_render{step});
+    animate_solve(maze, step);
+}
+
+} // namespace Dead_end
@@ -1,6 +1,5 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -11,7 +10,10 @@ module;
 #include <vector>
 export module labyrinth:dfs;
 import :maze;
+import :stats;
+import :trace;
 import :printers;
+import :render;
 import :speed;
 import :solve_utilities;
 import :my_queue;
@@ -31,20 +33,23 @@ void animate_corners(Maze::Maze &maze, Speed::Speed speed);
 
 namespace {
 
+template <class Render_policy, Maze::Visit_marks Marks>
 void
-hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
-    // We have useful bits in a square. Each square can use a unique bit to
-    // track seen threads. Each thread could maintain its own hashset, but this
-    // is much more space efficient. Use the space the maze already occupies and
-    // provides.
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
+hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id,
+       Render_policy const &render) {
+    Trace::Scope const trace("dfs hunter");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
+    auto &&seen = Sutil::marks_for<Marks>(maze, monitor, id);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     // Each thread only needs enough space for an O(current path length) stack.
     std::vector<Maze::Point> &dfs = monitor.thread_paths[id.index];
     dfs.push_back(monitor.starts.at(id.index));
     Maze::Point cur = monitor.starts.at(id.index);
     while (!dfs.empty()) {
-        if (monitor.winning_index.load() != Sutil::no_winner) {
+        // Lock? Garbage read stolen mid write by winning thread is still ok for
+        // program logic.
+        if (monitor.cancelled.load(std::memory_order_relaxed)) {
             break;
         }
 
@@ -52,23 +57,29 @@ hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
         cur = dfs.back();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            static_cast<void>(
-                monitor.winning_index.ces(Sutil::no_winner, id.index));
+            Stats::reached_finish();
+            Sutil::declare_winner(monitor, id.index);
             dfs.pop_back();
             break;
         }
-        maze[cur.row][cur.col] |= seen;
+        seen.mark(cur);
+        if constexpr (Render_policy::animated) {
+            maze[cur.row][cur.col] |= paint_bit;
+            render.draw(maze, cur);
+        }
 
         // Bias each thread's first choice towards orginal dispatch direction.
         // More coverage.
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
 
             bool const push_next
-                = !(maze[next.row][next.col] & seen)
+                = !seen.is_marked(next)
                   && (maze[next.row][next.col] & Maze::path_bit);
 
             if (push_next) {
@@ -78,80 +89,32 @@ hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
             }
         }
         if (!found_branch_to_explore) {
+            if constexpr (Render_policy::animated) {
+                maze[cur.row][cur.col] &= ~paint_bit;
+                render.draw(maze, cur);
+            }
             dfs.pop_back();
         }
     }
     // Another benefit of true depth first search is our stack holds path to
-    // exact location.
-    for (Maze::Point const &p : dfs) {
-        maze[p.row][p.col] |= paint_bit;
-    }
-}
-
-void
-animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-               Sutil::Thread_id id) {
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
-    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
-    std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
-    dfs.push_back(monitor.starts.at(id.index));
-    Maze::Point cur = monitor.starts.at(id.index);
-    while (!dfs.empty()) {
-        // Lock? Garbage read stolen mid write by winning thread is still ok for
-        // program logic.
-        if (monitor.winning_index.load() != Sutil::no_winner) {
-            return;
-        }
-
-        // Don't pop() yet!
-        cur = dfs.back();
-
-        if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            static_cast<void>(
-                monitor.winning_index.ces(Sutil::no_winner, id.index));
-            dfs.pop_back();
-            return;
-        }
-        maze[cur.row][cur.col] |= (seen | paint_bit);
-
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
-
-        // Bias each thread's first choice towards orginal dispatch direction.
-        // More coverage.
-        bool found_branch_to_explore = false;
-        for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
-             count++, ++i %= Sutil::dirs.size()) {
-            Maze::Point const &p = Sutil::dirs.at(i);
-            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
-            bool const push_next
-                = !(maze[next.row][next.col] & seen)
-                  && (maze[next.row][next.col] & Maze::path_bit);
-            if (push_next) {
-                found_branch_to_explore = true;
-                dfs.push_back(next);
-                break;
-            }
-        }
-
-        if (!found_branch_to_explore) {
-            maze[cur.row][cur.col] &= ~paint_bit;
-            monitor.monitor.lock();
-            Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
-            dfs.pop_back();
+    // exact location. An animation has painted it already.
+    if constexpr (!Render_policy::animated) {
+        for (Maze::Point const &p : dfs) {
+            maze[p.row][p.col] |= paint_bit;
         }
     }
 }
 
+template <class Render_policy, Maze::Visit_marks Marks>
 void
-gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
+gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id,
+         Render_policy const &render) {
+    Trace::Scope const trace("dfs gatherer");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
+    auto &&seen = Sutil::marks_for<Marks>(maze, monitor, id);
+    // Finish squares are shared so claiming one still uses our cache bit.
+    Sutil::Thread_cache const claim(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths[id.index];
     dfs.push_back(monitor.starts.at(id.index));
@@ -162,24 +125,33 @@ gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
         // We are the first thread to this finish! Claim it!
         if ((maze[cur.row][cur.col] & Sutil::finish_bit)
             && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
-            maze[cur.row][cur.col] |= seen;
+            Stats::reached_finish();
+            maze[cur.row][cur.col] |= claim;
             dfs.pop_back();
-            for (Maze::Point const &p : dfs) {
-                maze[p.row][p.col] |= paint_bit;
+            if constexpr (!Render_policy::animated) {
+                for (Maze::Point const &p : dfs) {
+                    maze[p.row][p.col] |= paint_bit;
+                }
             }
             return;
         }
-        maze[cur.row][cur.col] |= seen;
+        seen.mark(cur);
+        if constexpr (Render_policy::animated) {
+            maze[cur.row][cur.col] |= paint_bit;
+            render.draw(maze, cur);
+        }
 
         // Bias each thread's first choice towards orginal dispatch direction.
         // More coverage.
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
             bool const push_next
-                = !(maze[next.row][next.col] & seen)
+                = !seen.is_marked(next)
                   && (maze[next.row][next.col] & Maze::path_bit);
             if (push_next) {
                 found_branch_to_explore = true;
@@ -187,58 +159,11 @@ gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
                 break;
             }
         }
-
         if (!found_branch_to_explore) {
-            dfs.pop_back();
-        }
-    }
-}
-
-void
-animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-                 Sutil::Thread_id id) {
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
-    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
-    std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
-    dfs.push_back(monitor.starts.at(id.index));
-    Maze::Point cur = monitor.starts.at(id.index);
-    while (!dfs.empty()) {
-        cur = dfs.back();
-
-        if ((maze[cur.row][cur.col] & Sutil::finish_bit)
-            && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
-            maze[cur.row][cur.col] |= seen;
-            dfs.pop_back();
-            return;
-        }
-        maze[cur.row][cur.col] |= (seen | paint_bit);
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
-
-        bool found_branch_to_explore = false;
-        for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
-             count++, ++i %= Sutil::dirs.size()) {
-            Maze::Point const &p = Sutil::dirs.at(i);
-            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
-            bool const push_next
-                = !(maze[next.row][next.col] & seen)
-                  && (maze[next.row][next.col] & Maze::path_bit);
-            if (push_next) {
-                found_branch_to_explore = true;
-                dfs.push_back(next);
-                break;
+            if constexpr (Render_policy::animated) {
+                maze[cur.row][cur.col] &= ~paint_bit;
+                render.draw(maze, cur);
             }
-        }
-        if (!found_branch_to_explore) {
-            maze[cur.row][cur.col] &= ~paint_bit;
-            monitor.monitor.lock();
-            Sutil::flush_cursor_path_coordinate(maze, cur);
-            monitor.monitor.unlock();
-            std::this_thread::sleep_for(
-                std::chrono::microseconds(monitor.speed.value_or(0)));
             dfs.pop_back();
         }
     }
@@ -253,18 +178,24 @@ namespace Dfs {
 void
 hunt(Maze::Maze &maze) {
     Sutil::Dfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
                                               Sutil::pick_random_point(maze));
     maze[monitor.starts.at(0).row][monitor.starts.at(0).col]
         |= Sutil::start_bit;
     Maze::Point const finish = Sutil::pick_random_point(maze);
     maze[finish.row][finish.col] |= Sutil::finish_bit;
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? hunter<Render::No_render, grid>
+                             : hunter<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
 
     for (std::thread &t : threads) {
@@ -273,12 +204,12 @@ hunt(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 gather(Maze::Maze &maze) {
     Sutil::Dfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
                                               Sutil::pick_random_point(maze));
     maze[monitor.starts.at(0).row][monitor.starts.at(0).col]
@@ -288,12 +219,17 @@ gather(Maze::Maze &maze) {
         Maze::Point const finish = Sutil::pick_random_point(maze);
         maze[finish.row][finish.col] |= Sutil::finish_bit;
     }
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? gatherer<Render::No_render, grid>
+                             : gatherer<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
 
     for (std::thread &t : threads) {
@@ -302,12 +238,12 @@ gather(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
 corners(Maze::Maze &maze) {
     Sutil::Dfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = Sutil::set_corner_starts(maze);
     for (Maze::Point const &p : monitor.starts) {
         maze[p.row][p.col] |= Sutil::start_bit;
@@ -320,16 +256,21 @@ corners(Maze::Maze &maze) {
     maze[finish.row][finish.col] |= Maze::path_bit;
     maze[finish.row][finish.col] |= Sutil::finish_bit;
 
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? hunter<Render::No_render, grid>
+                             : hunter<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
     for (std::thread &t : threads) {
         t.join();
@@ -337,13 +278,14 @@ corners(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -353,30 +295,33 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Maze::Point const finish = Sutil::pick_random_point(maze);
     maze[finish.row][finish.col] |= Sutil::finish_bit;
     Sutil::flush_cursor_path_coordinate(maze, finish);
-    std::this_thread::sleep_for(
-        std::chrono::microseconds(monitor.speed.value_or(0)));
+    Speed::pace(monitor.speed.value_or(0));
 
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            hunter<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -388,72 +333,74 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
         Maze::Point const finish = Sutil::pick_random_point(maze);
         maze[finish.row][finish.col] |= Sutil::finish_bit;
         Sutil::flush_cursor_path_coordinate(maze, finish);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
 
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            gatherer<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
 animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = Sutil::set_corner_starts(maze);
     for (Maze::Point const &p : monitor.starts) {
         maze[p.row][p.col] |= Sutil::start_bit;
         Sutil::flush_cursor_path_coordinate(maze, p);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
     Maze::Point const finish = {maze.row_size() / 2, maze.col_size() / 2};
     for (Maze::Point const &p : Sutil::all_dirs) {
         Maze::Point const next = {finish.row + p.row, finish.col + p.col};
         maze[next.row][next.col] |= Maze::path_bit;
         Sutil::flush_cursor_path_coordinate(maze, next);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
     maze[finish.row][finish.col] |= Maze::path_bit;
     maze[finish.row][finish.col] |= Sutil::finish_bit;
     Sutil::flush_cursor_path_coordinate(maze, finish);
-    std::this_thread::sleep_for(
-        std::chrono::microseconds(monitor.speed.value_or(0)));
+    Speed::pace(monitor.speed.value_or(0));
 
     std::vector<std::thread> threads(Sutil::num_threads);
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            hunter<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
     for (std::thread &t : threads) {
         t.join();
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 } // namespace Dfs
@@ -1,6 +1,5 @@
 module;
 #include <algorithm>
-#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -11,8 +10,11 @@ module;
 #include <vector>
 export module labyrinth:floodfs;
 import :maze;
+import :stats;
+import :trace;
 import :speed;
 import :printers;
+import :render;
 import :solve_utilities;
 import :my_queue;
 
@@ -31,13 +33,14 @@ void animate_corners(Maze::Maze &maze, Speed::Speed speed);
 
 namespace {
 
+template <class Render_policy, Maze::Visit_marks Marks>
 void
-hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
-    // We have useful bits in a square. Each square can use a unique bit to
-    // track seen threads. Each thread could maintain its own hashset, but this
-    // is much more space efficient. Use the space the maze already occupies and
-    // provides.
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
+hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id,
+       Render_policy const &render) {
+    Trace::Scope const trace("floodfs hunter");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
+    auto &&seen = Sutil::marks_for<Marks>(maze, monitor, id);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     // Each thread only needs enough space for an O(current path length) stack.
     std::vector<Maze::Point> &dfs = monitor.thread_paths[id.index];
@@ -46,57 +49,7 @@ hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
     while (!dfs.empty()) {
         // Lock? Garbage read stolen mid write by winning thread is still ok for
         // program logic.
-        if (monitor.winning_index.load() != Sutil::no_winner) {
-            break;
-        }
-
-        // Don't pop() yet!
-        cur = dfs.back();
-
-        if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            static_cast<void>(
-                monitor.winning_index.ces(Sutil::no_winner, id.index));
-            dfs.pop_back();
-            break;
-        }
-        maze[cur.row][cur.col] |= (seen | paint_bit);
-
-        // Bias each thread's first choice towards orginal dispatch direction.
-        // More coverage.
-        bool found_branch_to_explore = false;
-        for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
-             count++, ++i %= Sutil::dirs.size()) {
-            Maze::Point const &p = Sutil::dirs.at(i);
-            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
-
-            bool const push_next
-                = !(maze[next.row][next.col] & seen)
-                  && (maze[next.row][next.col] & Maze::path_bit);
-
-            if (push_next) {
-                found_branch_to_explore = true;
-                dfs.push_back(next);
-                break;
-            }
-        }
-        if (!found_branch_to_explore) {
-            dfs.pop_back();
-        }
-    }
-}
-
-void
-animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-               Sutil::Thread_id id) {
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
-    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
-    std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
-    dfs.push_back(monitor.starts.at(id.index));
-    Maze::Point cur = monitor.starts.at(id.index);
-    while (!dfs.empty()) {
-        // Lock? Garbage read stolen mid write by winning thread is still ok for
-        // program logic.
-        if (monitor.winning_index.load() != Sutil::no_winner) {
+        if (monitor.cancelled.load(std::memory_order_relaxed)) {
             return;
         }
 
@@ -104,28 +57,31 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
         cur = dfs.back();
 
         if (maze[cur.row][cur.col] & Sutil::finish_bit) {
-            static_cast<void>(
-                monitor.winning_index.ces(Sutil::no_winner, id.index));
+            Stats::reached_finish();
+            Sutil::declare_winner(monitor, id.index);
             dfs.pop_back();
             return;
         }
-        maze[cur.row][cur.col] |= (seen | paint_bit);
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        seen.mark(cur);
+        // Private marks are painted into the maze once the threads are done.
+        if constexpr (Render_policy::animated
+                      || Marks == Maze::Visit_marks::grid) {
+            maze[cur.row][cur.col] |= paint_bit;
+            render.draw(maze, cur);
+        }
 
         // Bias each thread's first choice towards orginal dispatch direction.
         // More coverage.
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
 
             bool const push_next
-                = !(maze[next.row][next.col] & seen)
+                = !seen.is_marked(next)
                   && (maze[next.row][next.col] & Maze::path_bit);
 
             if (push_next) {
@@ -134,16 +90,22 @@ animate_hunter(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
                 break;
             }
         }
-
         if (!found_branch_to_explore) {
             dfs.pop_back();
         }
     }
 }
 
+template <class Render_policy, Maze::Visit_marks Marks>
 void
-gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
+gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id,
+         Render_policy const &render) {
+    Trace::Scope const trace("floodfs gatherer");
+    Stats::Counters &stats = Stats::local();
+    Stats::Path_scope const path_len(monitor.thread_paths[id.index]);
+    auto &&seen = Sutil::marks_for<Marks>(maze, monitor, id);
+    // Finish squares are shared so claiming one still uses our cache bit.
+    Sutil::Thread_cache const claim(id.bit << Sutil::thread_cache_shift);
     Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
     std::vector<Maze::Point> &dfs = monitor.thread_paths[id.index];
     dfs.push_back(monitor.starts.at(id.index));
@@ -151,76 +113,35 @@ gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor, Sutil::Thread_id id) {
     while (!dfs.empty()) {
         cur = dfs.back();
 
-        // We are the first thread to this finish! Claim it!
+        // We are the first thread to this finish! Claim it! Every square on
+        // the way here was painted when it was first visited.
         if (maze[cur.row][cur.col] & Sutil::finish_bit
             && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
-            maze[cur.row][cur.col] |= seen;
+            Stats::reached_finish();
+            maze[cur.row][cur.col] |= claim;
             dfs.pop_back();
-            for (Maze::Point const &p : dfs) {
-                maze[p.row][p.col] |= paint_bit;
-            }
             return;
         }
-        maze[cur.row][cur.col] |= (seen | paint_bit);
+        seen.mark(cur);
+        // Private marks are painted into the maze once the threads are done.
+        if constexpr (Render_policy::animated
+                      || Marks == Maze::Visit_marks::grid) {
+            maze[cur.row][cur.col] |= paint_bit;
+            render.draw(maze, cur);
+        }
 
         // Bias each thread's first choice towards orginal dispatch direction.
         // More coverage.
         bool found_branch_to_explore = false;
+        ++stats.expanded;
         for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
              count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
             Maze::Point const &p = Sutil::dirs.at(i);
             Maze::Point const next = {cur.row + p.row, cur.col + p.col};
 
             bool const push_next
-                = !(maze[next.row][next.col] & seen)
-                  && (maze[next.row][next.col] & Maze::path_bit);
-
-            if (push_next) {
-                found_branch_to_explore = true;
-                dfs.push_back(next);
-                break;
-            }
-        }
-
-        if (!found_branch_to_explore) {
-            dfs.pop_back();
-        }
-    }
-}
-
-void
-animate_gatherer(Maze::Maze &maze, Sutil::Dfs_monitor &monitor,
-                 Sutil::Thread_id id) {
-    Sutil::Thread_cache const seen(id.bit << Sutil::thread_cache_shift);
-    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
-    std::vector<Maze::Point> &dfs = monitor.thread_paths.at(id.index);
-    dfs.push_back(monitor.starts.at(id.index));
-    Maze::Point cur = monitor.starts.at(id.index);
-    while (!dfs.empty()) {
-        cur = dfs.back();
-
-        if (maze[cur.row][cur.col] & Sutil::finish_bit
-            && !(maze[cur.row][cur.col] & Sutil::cache_mask)) {
-            maze[cur.row][cur.col] |= seen;
-            dfs.pop_back();
-            return;
-        }
-
-        maze[cur.row][cur.col] |= (seen | paint_bit);
-        monitor.monitor.lock();
-        Sutil::flush_cursor_path_coordinate(maze, cur);
-        monitor.monitor.unlock();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
-
-        bool found_branch_to_explore = false;
-        for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
-             count++, ++i %= Sutil::dirs.size()) {
-            Maze::Point const &p = Sutil::dirs.at(i);
-            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
-
-            bool const push_next
-                = !(maze[next.row][next.col] & seen)
+                = !seen.is_marked(next)
                   && (maze[next.row][next.col] & Maze::path_bit);
 
             if (push_next) {
@@ -244,23 +165,30 @@ namespace Floodfs {
 void
 hunt(Maze::Maze &maze) {
     Sutil::Dfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
                                               Sutil::pick_random_point(maze));
     maze[monitor.starts.at(0).row][monitor.starts.at(0).col]
         |= Sutil::start_bit;
     Maze::Point const finish = Sutil::pick_random_point(maze);
     maze[finish.row][finish.col] |= Sutil::finish_bit;
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? hunter<Render::No_render, grid>
+                             : hunter<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    Sutil::publish_paint(maze, monitor.thread_marks);
 
     if (monitor.winning_index.load() != Sutil::no_winner) {
         Sutil::Thread_paint const winner_color(
@@ -275,12 +203,12 @@ hunt(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 gather(Maze::Maze &maze) {
     Sutil::Dfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
                                               Sutil::pick_random_point(maze));
     maze[monitor.starts.at(0).row][monitor.starts.at(0).col]
@@ -290,17 +218,23 @@ gather(Maze::Maze &maze) {
         Maze::Point const finish = Sutil::pick_random_point(maze);
         maze[finish.row][finish.col] |= Sutil::finish_bit;
     }
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? gatherer<Render::No_render, grid>
+                             : gatherer<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
 
     for (std::thread &t : threads) {
         t.join();
     }
+    Sutil::publish_paint(maze, monitor.thread_marks);
     uint16_t i_thread = 0;
     for (std::vector<Maze::Point> const &path : monitor.thread_paths) {
         Sutil::Thread_paint const color(Sutil::thread_bits.at(i_thread)
@@ -313,12 +247,12 @@ gather(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
 corners(Maze::Maze &maze) {
     Sutil::Dfs_monitor monitor;
+    monitor.thread_marks = Sutil::next_thread_marks(maze);
     monitor.starts = Sutil::set_corner_starts(maze);
     for (Maze::Point const &p : monitor.starts) {
         maze[p.row][p.col] |= Sutil::start_bit;
@@ -331,20 +265,26 @@ corners(Maze::Maze &maze) {
     maze[finish.row][finish.col] |= Maze::path_bit;
     maze[finish.row][finish.col] |= Sutil::finish_bit;
 
+    using enum Maze::Visit_marks;
+    auto *const search = Maze::visit_marks() == grid
+                             ? hunter<Render::No_render, grid>
+                             : hunter<Render::No_render, bits>;
     std::vector<std::thread> threads(Sutil::num_threads);
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(search, std::ref(maze),
+                                        std::ref(monitor), this_thread,
+                                        Render::No_render{});
     }
     for (std::thread &t : threads) {
         t.join();
     }
+    Sutil::publish_paint(maze, monitor.thread_marks);
 
     if (monitor.winning_index.load() != Sutil::no_winner) {
         Sutil::Thread_paint const winner_color(
@@ -358,13 +298,14 @@ corners(Maze::Maze &maze) {
     Sutil::print_maze(maze);
     Sutil::print_overlap_key();
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -374,15 +315,16 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
     Maze::Point const finish = Sutil::pick_random_point(maze);
     maze[finish.row][finish.col] |= Sutil::finish_bit;
     Sutil::flush_cursor_path_coordinate(maze, finish);
-    std::this_thread::sleep_for(
-        std::chrono::microseconds(monitor.speed.value_or(0)));
+    Speed::pace(monitor.speed.value_or(0));
 
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            hunter<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -397,19 +339,20 @@ animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
             = monitor.thread_paths.at(monitor.winning_index.load()).back();
         maze[before_finish.row][before_finish.col] |= winner_color;
         Sutil::flush_cursor_path_coordinate(maze, before_finish);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 void
 animate_gather(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = std::vector<Maze::Point>(Sutil::num_threads,
@@ -421,16 +364,17 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
         Maze::Point const finish = Sutil::pick_random_point(maze);
         maze[finish.row][finish.col] |= Sutil::finish_bit;
         Sutil::flush_cursor_path_coordinate(maze, finish);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
 
     std::vector<std::thread> threads(Sutil::num_threads);
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread{i_thread,
                                            Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_gatherer, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            gatherer<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
 
     for (std::thread &t : threads) {
@@ -446,52 +390,52 @@ animate_gather(Maze::Maze &maze, Speed::Speed speed) {
         maze[p.row][p.col] |= color;
         ++i_thread;
         Sutil::flush_cursor_path_coordinate(maze, p);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_gather_solution_message();
-    std::cout << "\n";
 }
 
 void
 animate_corners(Maze::Maze &maze, Speed::Speed speed) {
     Printer::set_cursor_position({maze.row_size(), 0});
     Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
     Sutil::Dfs_monitor monitor;
     monitor.speed = Sutil::solver_speeds.at(static_cast<int>(speed));
     monitor.starts = Sutil::set_corner_starts(maze);
     for (Maze::Point const &p : monitor.starts) {
         maze[p.row][p.col] |= Sutil::start_bit;
         Sutil::flush_cursor_path_coordinate(maze, p);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
     Maze::Point const finish = {maze.row_size() / 2, maze.col_size() / 2};
     for (Maze::Point const &p : Sutil::all_dirs) {
         Maze::Point const next = {finish.row + p.row, finish.col + p.col};
         maze[next.row][next.col] |= Maze::path_bit;
         Sutil::flush_cursor_path_coordinate(maze, next);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
     maze[finish.row][finish.col] |= Maze::path_bit;
     maze[finish.row][finish.col] |= Sutil::finish_bit;
     Sutil::flush_cursor_path_coordinate(maze, finish);
-    std::this_thread::sleep_for(
-        std::chrono::microseconds(monitor.speed.value_or(0)));
+    Speed::pace(monitor.speed.value_or(0));
 
     std::vector<std::thread> threads(Sutil::num_threads);
     // Randomly shuffle thread start corners so colors mix differently each
     // time.
     shuffle(begin(monitor.starts), end(monitor.starts),
-            std::mt19937(std::random_device{}()));
+            std::mt19937(Maze::random_seed()));
     for (uint16_t i_thread = 0; i_thread < Sutil::num_threads; i_thread++) {
         Sutil::Thread_id const this_thread
             = {i_thread, Sutil::thread_bits.at(i_thread)};
-        threads[i_thread] = std::thread(animate_hunter, std::ref(maze),
-                                        std::ref(monitor), this_thread);
+        threads[i_thread] = std::thread(
+            hunter<Sutil::Terminal_render, Maze::Visit_marks::grid>,
+            std::ref(maze), std::ref(monitor), this_thread,
+            Sutil::Terminal_render{monitor.speed.value_or(0)});
     }
     for (std::thread &t : threads) {
         t.join();
@@ -505,14 +449,13 @@ animate_corners(Maze::Maze &maze, Speed::Speed speed) {
             = monitor.thread_paths.at(monitor.winning_index.load()).back();
         maze[before_finish.row][before_finish.col] |= winner_color;
         Sutil::flush_cursor_path_coordinate(maze, before_finish);
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(monitor.speed.value_or(0)));
+        Speed::pace(monitor.speed.value_or(0));
     }
 
+    session.stop();
     Printer::set_cursor_position(
         {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
     Sutil::print_hunt_solution_message(monitor.winning_index.load());
-    std::cout << "\n";
 }
 
 } // namespace Floodfs
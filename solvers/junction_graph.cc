@@ -0,0 +1,552 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+export module labyrinth:junction;
+import :maze;
+import :speed;
+import :printers;
+import :render;
+import :solve_utilities;
+import :my_queue;
+
+//////////////////////////////////   Exported Interface
+
+export namespace Junction {
+
+constexpr uint64_t no_path = UINT64_MAX;
+
+/// A perfect maze is mostly corridors of squares with exactly two open
+/// neighbors. Here only dead ends and branch points become nodes and every
+/// corridor between them becomes one weighted edge, stored in compressed
+/// sparse row form. An edge remembers the direction it leaves its node so the
+/// corridor can be walked again when a path needs painting.
+struct Graph {
+    int cols{0};
+    // Flat maze index of each node, sorted ascending so lookup is a search.
+    std::vector<int> squares;
+    // Edges of node i live in [offsets[i], offsets[i + 1]).
+    std::vector<uint32_t> offsets;
+    std::vector<int> targets;
+    std::vector<uint32_t> weights;
+    std::vector<uint8_t> dirs;
+
+    uint64_t
+    node_count() const {
+        return squares.size();
+    }
+
+    // The node id of a square or -1 if the square is in a corridor.
+    int node_of(Maze::Point const &p) const;
+};
+
+struct Route {
+    // Steps taken from start to finish or no_path if finish is unreachable.
+    uint64_t path_len{no_path};
+    // Graph nodes taken off the frontier during the search.
+    uint64_t nodes_visited{0};
+    // Runs from start to finish inclusive with every corridor expanded.
+    std::vector<Maze::Point> path;
+};
+
+/// Builds the graph for the maze as it is now. Rows are split into bands that
+/// are scanned in parallel, first for nodes and then for the corridors that
+/// leave them. The maze is only read.
+Graph build_graph(Maze::Maze const &maze);
+
+/// Fewest junctions from start to finish. In a perfect maze this is also the
+/// shortest path because there is only one.
+Route bfs(Graph const &graph, Maze::Maze const &maze, Maze::Point const &start,
+          Maze::Point const &finish);
+
+/// Fewest steps from start to finish, weighing each corridor by its length.
+Route dijkstra(Graph const &graph, Maze::Maze const &maze,
+               Maze::Point const &start, Maze::Point const &finish);
+
+void hunt(Maze::Maze &maze);
+void animate_hunt(Maze::Maze &maze, Speed::Speed speed);
+
+} // namespace Junction
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+constexpr int no_node = -1;
+constexpr uint64_t unreached = std::numeric_limits<uint64_t>::max();
+constexpr std::array<int, 4> reverse_dir = {2, 3, 0, 1};
+
+struct Band {
+    int first_row;
+    int last_row;
+};
+
+// Where a walk from a query point down one corridor ended up.
+struct Endpoint {
+    int node;
+    uint64_t dist;
+    uint8_t dir;
+};
+
+struct Walk {
+    Maze::Point end;
+    uint64_t steps;
+    bool hit_stop;
+};
+
+struct Query_ends {
+    std::vector<Endpoint> ends;
+    // Set if start and finish share a corridor with no node between them.
+    uint64_t direct{unreached};
+    uint8_t direct_dir{0};
+};
+
+struct Search_tree {
+    std::vector<uint64_t> dist;
+    std::vector<int> parent;
+    std::vector<uint32_t> parent_edge;
+    uint64_t visited{0};
+    explicit Search_tree(uint64_t nodes)
+        : dist(nodes, unreached), parent(nodes, no_node), parent_edge(nodes) {
+    }
+};
+
+bool
+is_path(Maze::Maze const &maze, Maze::Point const &p) {
+    return (maze[p.row][p.col] & Maze::path_bit).load() != 0;
+}
+
+int
+degree(Maze::Maze const &maze, Maze::Point const &p) {
+    int open = 0;
+    for (Maze::Point const &d : Sutil::dirs) {
+        open += is_path(maze, {p.row + d.row, p.col + d.col});
+    }
+    return open;
+}
+
+bool
+is_node(Maze::Maze const &maze, Maze::Point const &p) {
+    return degree(maze, p) != 2;
+}
+
+// Follows a corridor from p leaving in dir until a node, the stop square, or
+// back where we began on a loop with no junctions. Squares stepped on are
+// appended to trail when one is given.
+Walk
+walk(Maze::Maze const &maze, Maze::Point const &p, uint8_t dir,
+     std::optional<Maze::Point> stop, std::vector<Maze::Point> *trail) {
+    Maze::Point cur = p;
+    uint64_t steps = 0;
+    for (;;) {
+        cur = {cur.row + Sutil::dirs.at(dir).row,
+               cur.col + Sutil::dirs.at(dir).col};
+        ++steps;
+        if (trail) {
+            trail->push_back(cur);
+        }
+        if (stop && cur.row == stop->row && cur.col == stop->col) {
+            return {cur, steps, true};
+        }
+        if ((cur.row == p.row && cur.col == p.col) || is_node(maze, cur)) {
+            return {cur, steps, false};
+        }
+        for (uint8_t next = 0; next < Sutil::dirs.size(); ++next) {
+            Maze::Point const &d = Sutil::dirs.at(next);
+            if (next != reverse_dir.at(dir)
+                && is_path(maze, {cur.row + d.row, cur.col + d.col})) {
+                dir = next;
+                break;
+            }
+        }
+    }
+}
+
+std::vector<Band>
+split_rows(Maze::Maze const &maze) {
+    std::vector<Band> bands;
+    int const interior = std::max(maze.row_size() - 2, 0);
+    int const per_band
+        = std::max((interior + Sutil::num_threads - 1) / Sutil::num_threads, 1);
+    for (int row = 1; row < maze.row_size() - 1; row += per_band) {
+        bands.push_back({row, std::min(row + per_band, maze.row_size() - 1)});
+    }
+    return bands;
+}
+
+void
+find_nodes(Maze::Maze const &maze, Band band, std::vector<int> &found) {
+    for (int row = band.first_row; row < band.last_row; ++row) {
+        for (int col = 1; col < maze.col_size() - 1; ++col) {
+            if (is_path(maze, {row, col}) && is_node(maze, {row, col})) {
+                found.push_back((row * maze.col_size()) + col);
+            }
+        }
+    }
+}
+
+void
+find_edges(Maze::Maze const &maze, Junction::Graph &graph, int first_node,
+           int last_node) {
+    for (int node = first_node; node < last_node; ++node) {
+        Maze::Point const p = {graph.squares[node] / graph.cols,
+                               graph.squares[node] % graph.cols};
+        uint32_t edge = graph.offsets[node];
+        for (uint8_t dir = 0; dir < Sutil::dirs.size(); ++dir) {
+            Maze::Point const &d = Sutil::dirs.at(dir);
+            if (!is_path(maze, {p.row + d.row, p.col + d.col})) {
+                continue;
+            }
+            Walk const w = walk(maze, p, dir, {}, nullptr);
+            graph.targets[edge] = graph.node_of(w.end);
+            graph.weights[edge] = static_cast<uint32_t>(w.steps);
+            graph.dirs[edge] = dir;
+            ++edge;
+        }
+    }
+}
+
+Query_ends
+query_ends(Junction::Graph const &graph, Maze::Maze const &maze,
+           Maze::Point const &p, std::optional<Maze::Point> other) {
+    Query_ends q{};
+    int const node = graph.node_of(p);
+    if (node != no_node) {
+        q.ends.push_back({node, 0, 0});
+        return q;
+    }
+    for (uint8_t dir = 0; dir < Sutil::dirs.size(); ++dir) {
+        Maze::Point const &d = Sutil::dirs.at(dir);
+        if (!is_path(maze, {p.row + d.row, p.col + d.col})) {
+            continue;
+        }
+        Walk const w = walk(maze, p, dir, other, nullptr);
+        if (w.hit_stop) {
+            q.direct = w.steps;
+            q.direct_dir = dir;
+            continue;
+        }
+        int const end = graph.node_of(w.end);
+        if (end != no_node) {
+            q.ends.push_back({end, w.steps, dir});
+        }
+    }
+    return q;
+}
+
+std::optional<Endpoint>
+finish_end(Query_ends const &finish, int node) {
+    for (Endpoint const &e : finish.ends) {
+        if (e.node == node) {
+            return e;
+        }
+    }
+    return {};
+}
+
+// Lays the corridors back down from start to finish once the search has
+// settled on the node where it meets the finish.
+Junction::Route
+expand_route(Junction::Graph const &graph, Maze::Maze const &maze,
+             Search_tree const &tree, Maze::Point const &start,
+             Maze::Point const &finish, Query_ends const &start_q,
+             Endpoint const &meet) {
+    Junction::Route route{};
+    route.nodes_visited = tree.visited;
+    std::vector<int> chain;
+    for (int node = meet.node; node != no_node; node = tree.parent[node]) {
+        chain.push_back(node);
+    }
+    std::reverse(chain.begin(), chain.end());
+    route.path.push_back(start);
+    int const first = chain.front();
+    for (Endpoint const &e : start_q.ends) {
+        if (e.node == first && e.dist == tree.dist[first]) {
+            if (e.dist != 0) {
+                static_cast<void>(walk(maze, start, e.dir, {}, &route.path));
+            }
+            break;
+        }
+    }
+    for (uint64_t i = 1; i < chain.size(); ++i) {
+        uint32_t const edge = tree.parent_edge[chain[i]];
+        Maze::Point const from = {graph.squares[chain[i - 1]] / graph.cols,
+                                  graph.squares[chain[i - 1]] % graph.cols};
+        static_cast<void>(
+            walk(maze, from, graph.dirs[edge], {}, &route.path));
+    }
+    if (meet.dist != 0) {
+        std::vector<Maze::Point> tail;
+        static_cast<void>(walk(maze, finish, meet.dir, {}, &tail));
+        tail.pop_back();
+        std::reverse(tail.begin(), tail.end());
+        route.path.insert(route.path.end(), tail.begin(), tail.end());
+        route.path.push_back(finish);
+    }
+    route.path_len = route.path.size() - 1;
+    return route;
+}
+
+Junction::Route
+direct_route(Maze::Maze const &maze, Maze::Point const &start,
+             Query_ends const &start_q, uint64_t visited) {
+    Junction::Route route{};
+    route.nodes_visited = visited;
+    route.path.push_back(start);
+    static_cast<void>(
+        walk(maze, start, start_q.direct_dir, {}, &route.path));
+    route.path.resize(start_q.direct + 1);
+    route.path_len = start_q.direct;
+    return route;
+}
+
+Junction::Route
+search(Junction::Graph const &graph, Maze::Maze const &maze,
+       Maze::Point const &start, Maze::Point const &finish, bool weighted) {
+    if (start.row == finish.row && start.col == finish.col) {
+        return {0, 0, {start}};
+    }
+    Query_ends const start_q = query_ends(graph, maze, start, finish);
+    // No junction between them beats any route through the graph for fewest
+    // junctions. Dijkstra still checks whether going around is shorter.
+    if (!weighted && start_q.direct != unreached) {
+        return direct_route(maze, start, start_q, 0);
+    }
+    Query_ends const finish_q = query_ends(graph, maze, finish, {});
+    Search_tree tree(graph.node_count());
+
+    // Best total so far and the finish side node that gave it to us.
+    uint64_t best = start_q.direct;
+    std::optional<Endpoint> best_meet{};
+
+    using Frontier_entry = std::pair<uint64_t, int>;
+    std::priority_queue<Frontier_entry, std::vector<Frontier_entry>,
+                        std::greater<>>
+        heap;
+    My_queue<int> queue;
+    for (Endpoint const &e : start_q.ends) {
+        if (e.dist < tree.dist[e.node]) {
+            tree.dist[e.node] = e.dist;
+            if (weighted) {
+                heap.push({e.dist, e.node});
+            } else {
+                queue.push(e.node);
+            }
+        }
+    }
+    for (;;) {
+        int cur = no_node;
+        if (weighted) {
+            if (heap.empty()) {
+                break;
+            }
+            auto const [d, node] = heap.top();
+            heap.pop();
+            if (d != tree.dist[node]) {
+                continue;
+            }
+            // Nothing left on the frontier can beat what we have.
+            if (d >= best) {
+                break;
+            }
+            cur = node;
+        } else {
+            if (queue.empty()) {
+                break;
+            }
+            cur = queue.front();
+            queue.pop();
+        }
+        ++tree.visited;
+        if (std::optional<Endpoint> const meet = finish_end(finish_q, cur)) {
+            if (tree.dist[cur] + meet->dist < best) {
+                best = tree.dist[cur] + meet->dist;
+                best_meet = meet;
+            }
+            if (!weighted) {
+                break;
+            }
+        }
+        for (uint32_t edge = graph.offsets[cur]; edge < graph.offsets[cur + 1];
+             ++edge) {
+            int const next = graph.targets[edge];
+            if (next == no_node) {
+                continue;
+            }
+            uint64_t const d = tree.dist[cur] + graph.weights[edge];
+            bool const relax = weighted ? d < tree.dist[next]
+                                        : tree.dist[next] == unreached;
+            if (relax) {
+                tree.dist[next] = d;
+                tree.parent[next] = cur;
+                tree.parent_edge[next] = edge;
+                if (weighted) {
+                    heap.push({d, next});
+                } else {
+                    queue.push(next);
+                }
+            }
+        }
+    }
+    if (best_meet) {
+        return expand_route(graph, maze, tree, start, finish, start_q,
+                            *best_meet);
+    }
+    if (start_q.direct != unreached) {
+        return direct_route(maze, start, start_q, tree.visited);
+    }
+    Junction::Route route{};
+    route.nodes_visited = tree.visited;
+    return route;
+}
+
+// The search never stepped through the corridors so there is nothing to show
+// but the route itself, painted in the color of all threads as a single search
+// stands in for every one of them.
+void
+paint_route(Maze::Maze &maze, Junction::Route const &route,
+            std::optional<Speed::Speed_unit> speed) {
+    for (Maze::Point const &p : route.path) {
+        maze[p.row][p.col] |= Sutil::thread_paint_mask;
+        if (speed) {
+            Sutil::flush_cursor_path_coordinate(maze, p);
+            Speed::pace(*speed);
+        }
+    }
+}
+
+void
+print_route_message(Junction::Graph const &graph,
+                    Junction::Route const &route) {
+    if (Printer::headless()) {
+        return;
+    }
+    if (route.path_len == Junction::no_path) {
+        std::cout << Sutil::thread_colors.at(Sutil::all_threads_failed_index)
+                  << "\n\n";
+        return;
+    }
+    std::cout << Sutil::ansi_wit << " path of " << route.path_len
+              << " steps found visiting " << route.nodes_visited << " of "
+              << graph.node_count() << " junctions.\n\n";
+}
+
+} // namespace
+
+namespace Junction {
+
+int
+Graph::node_of(Maze::Point const &p) const {
+    int const square = (p.row * cols) + p.col;
+    auto const found = std::lower_bound(squares.begin(), squares.end(), square);
+    if (found == squares.end() || *found != square) {
+        return no_node;
+    }
+    return static_cast<int>(found - squares.begin());
+}
+
+Graph
+build_graph(Maze::Maze const &maze) {
+    Graph graph{};
+    graph.cols = maze.col_size();
+    std::vector<Band> const bands = split_rows(maze);
+    std::vector<std::vector<int>> band_nodes(bands.size());
+    std::vector<std::thread> threads(bands.size());
+    for (uint64_t i = 0; i < bands.size(); ++i) {
+        threads[i] = std::thread(find_nodes, std::cref(maze), bands[i],
+                                 std::ref(band_nodes[i]));
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    // Bands are in row order so their nodes concatenate already sorted.
+    std::vector<int> band_first_node(bands.size() + 1, 0);
+    for (uint64_t i = 0; i < bands.size(); ++i) {
+        band_first_node[i + 1]
+            = band_first_node[i] + static_cast<int>(band_nodes[i].size());
+        graph.squares.insert(graph.squares.end(), band_nodes[i].begin(),
+                             band_nodes[i].end());
+    }
+    graph.offsets.assign(graph.node_count() + 1, 0);
+    for (uint64_t node = 0; node < graph.node_count(); ++node) {
+        Maze::Point const p = {graph.squares[node] / graph.cols,
+                               graph.squares[node] % graph.cols};
+        graph.offsets[node + 1]
+            = graph.offsets[node] + static_cast<uint32_t>(degree(maze, p));
+    }
+    graph.targets.resize(graph.offsets.back());
+    graph.weights.resize(graph.offsets.back());
+    graph.dirs.resize(graph.offsets.back());
+
+    // Every node knows where its edges go in the arrays so bands can fill
+    // their own slices without talking to each other.
+    for (uint64_t i = 0; i < bands.size(); ++i) {
+        threads[i] = std::thread(find_edges, std::cref(maze), std::ref(graph),
+                                 band_first_node[i], band_first_node[i + 1]);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return graph;
+}
+
+Route
+bfs(Graph const &graph, Maze::Maze const &maze, Maze::Point const &start,
+    Maze::Point const &finish) {
+    return search(graph, maze, start, finish, false);
+}
+
+Route
+dijkstra(Graph const &graph, Maze::Maze const &maze, Maze::Point const &start,
+         Maze::Point const &finish) {
+    return search(graph, maze, start, finish, true);
+}
+
+void
+hunt(Maze::Maze &maze) {
+    Maze::Point const start = Sutil::pick_random_point(maze);
+    maze[start.row][start.col] |= Sutil::start_bit;
+    Maze::Point const finish = Sutil::pick_random_point(maze);
+    maze[finish.row][finish.col] |= Sutil::finish_bit;
+    Graph const graph = build_graph(maze);
+    Route const route = dijkstra(graph, maze, start, finish);
+    paint_route(maze, route, {});
+    Sutil::print_maze(maze);
+    Sutil::print_overlap_key();
+    print_route_message(graph, route);
+}
+
+void
+animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
+    Printer::set_cursor_position({maze.row_size(), 0});
+    Sutil::print_overlap_key();
+    Speed::Speed_unit const step
+        = Sutil::solver_speeds.at(static_cast<int>(speed));
+    Maze::Point const start = Sutil::pick_random_point(maze);
+    maze[start.row][start.col] |= Sutil::start_bit;
+    Sutil::flush_cursor_path_coordinate(maze, start);
+    Maze::Point const finish = Sutil::pick_random_point(maze);
+    maze[finish.row][finish.col] |= Sutil::finish_bit;
+    Sutil::flush_cursor_path_coordinate(maze, finish);
+    Speed::pace(step);
+    Graph const graph = build_graph(maze);
+    Route const route = dijkstra(graph, maze, start, finish);
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
+    paint_route(maze, route, step);
+    session.stop();
+    Printer::set_cursor_position(
+        {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
+    print_route_message(graph, route);
+}
+
+} // namespace Junction
@@ -0,0 +1,252 @@
+/// File: mpmc_queue.cc
+/// -------------------
+/// This file contains two queues that any number of threads may push to and
+/// pop from at once without a lock. My_queue belongs to one thread and grows
+/// by copying, so sharing it would mean a mutex around every call. These are
+/// for work that many threads feed and drain together.
+///
+/// Bounded_queue is a ring of slots that each carry a sequence number. The
+/// sequence tells a thread whether the slot is ready for the lap it wants, so
+/// claiming a push or pop is a single compare and swap on a shared index and
+/// the ring never moves. The capacity is rounded up to a power of two so an
+/// index maps to its slot with a mask.
+///
+/// Segmented_queue never fills up. When pushes run past the last chunk a new
+/// chunk is linked after it, so nothing already queued is copied. Threads may
+/// still be reading a chunk after everyone has moved past it, so chunks are
+/// freed with the queue, not before. A queue that sees every square of a maze
+/// about once costs about as much as the maze itself.
+///
+/// Both queues hand back an empty optional from try_pop when nothing is
+/// ready, which includes a slot another thread has claimed but not finished
+/// writing. Callers decide for themselves when the work is truly done.
+module;
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+export module labyrinth:mpmc_queue;
+import :maze;
+import :stats;
+
+export template <class Value_type> class Bounded_queue {
+
+  public:
+    explicit Bounded_queue(uint64_t capacity)
+        : mask_(std::bit_ceil(capacity ? capacity : 1) - 1),
+          slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+        for (uint64_t i = 0; i <= mask_; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // False if the queue was full.
+    bool
+    try_push(Value_type const &elem) {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &s = slots_[pos & mask_];
+            uint64_t const seq = s.seq.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    s.elem = elem;
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos) {
+                // The slot still holds an element from the last lap.
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<Value_type>
+    try_pop() {
+        uint64_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &s = slots_[pos & mask_];
+            uint64_t const seq = s.seq.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (head_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    Value_type elem = s.elem;
+                    s.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return elem;
+                }
+            } else if (seq < pos + 1) {
+                return {};
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    uint64_t
+    capacity() const {
+        return mask_ + 1;
+    }
+
+    // Only a hint while other threads are pushing or popping.
+    bool
+    empty() const {
+        return head_.load(std::memory_order_relaxed)
+               >= tail_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Slot {
+        std::atomic_uint64_t seq;
+        Value_type elem;
+    };
+
+    uint64_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(Maze::cache_line) std::atomic_uint64_t tail_{0};
+    alignas(Maze::cache_line) std::atomic_uint64_t head_{0};
+};
+
+export template <class Value_type> class Segmented_queue {
+
+  public:
+    explicit Segmented_queue(uint64_t chunk_size = default_chunk_size)
+        : mask_(std::bit_ceil(chunk_size ? chunk_size : 1) - 1),
+          first_(std::make_unique<Chunk>(0, mask_ + 1)) {
+        push_chunk_.store(first_.get(), std::memory_order_relaxed);
+        pop_chunk_.store(first_.get(), std::memory_order_relaxed);
+    }
+
+    Segmented_queue(Segmented_queue const &) = delete;
+    Segmented_queue &operator=(Segmented_queue const &) = delete;
+    Segmented_queue(Segmented_queue &&) = delete;
+    Segmented_queue &operator=(Segmented_queue &&) = delete;
+
+    ~Segmented_queue() {
+        // Unlink iteratively so a long chain of chunks cannot overflow the
+        // stack through nested destructors.
+        std::unique_ptr<Chunk> c = std::move(first_);
+        while (c) {
+            c = std::unique_ptr<Chunk>(
+                c->next.exchange(nullptr, std::memory_order_relaxed));
+        }
+    }
+
+    void
+    push(Value_type const &elem) {
+        // The hint is read before the index is claimed. It only ever moves to
+        // the chunk of an index someone already holds, so it can not be past
+        // the one we are about to take.
+        Chunk *c = push_chunk_.load(std::memory_order_acquire);
+        uint64_t const pos = tail_.fetch_add(1, std::memory_order_relaxed);
+        if (pos == full_queue) {
+            std::cerr << "Segmented_queue is at max capacity.\n";
+            std::abort();
+        }
+        c = find(c, pos, push_chunk_, true);
+        Slot &s = c->slots[pos & mask_];
+        s.elem = elem;
+        s.ready.store(true, std::memory_order_release);
+    }
+
+    std::optional<Value_type>
+    try_pop() {
+        Chunk *c = pop_chunk_.load(std::memory_order_acquire);
+        uint64_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (pos >= tail_.load(std::memory_order_relaxed)) {
+                return {};
+            }
+            c = find(c, pos, pop_chunk_, false);
+            if (!c) {
+                return {};
+            }
+            Slot &s = c->slots[pos & mask_];
+            if (!s.ready.load(std::memory_order_acquire)) {
+                return {};
+            }
+            if (head_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+                return s.elem;
+            }
+        }
+    }
+
+    // Only a hint while other threads are pushing or popping.
+    bool
+    empty() const {
+        return head_.load(std::memory_order_relaxed)
+               >= tail_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static constexpr uint64_t default_chunk_size = 1024;
+    static constexpr uint64_t full_queue = UINT64_MAX;
+
+    struct Slot {
+        std::atomic_bool ready{false};
+        Value_type elem;
+    };
+
+    struct Chunk {
+        uint64_t first;
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<Chunk *> next{nullptr};
+        Chunk(uint64_t first_index, uint64_t size)
+            : first(first_index), slots(std::make_unique<Slot[]>(size)) {
+        }
+    };
+
+    uint64_t mask_;
+    std::unique_ptr<Chunk> first_;
+    alignas(Maze::cache_line) std::atomic_uint64_t tail_{0};
+    alignas(Maze::cache_line) std::atomic<Chunk *> push_chunk_{nullptr};
+    alignas(Maze::cache_line) std::atomic_uint64_t head_{0};
+    alignas(Maze::cache_line) std::atomic<Chunk *> pop_chunk_{nullptr};
+
+    // Walks forward from c to the chunk holding pos and moves the hint along
+    // with it. Pushers link a new chunk when the walk runs off the end and
+    // poppers give up with nullptr because nothing was pushed there yet.
+    Chunk *
+    find(Chunk *c, uint64_t pos, std::atomic<Chunk *> &hint, bool grow) {
+        Chunk *const start = c;
+        while (pos - c->first > mask_) {
+            Chunk *next = c->next.load(std::memory_order_acquire);
+            if (!next) {
+                if (!grow) {
+                    return nullptr;
+                }
+                next = append(c);
+            }
+            c = next;
+        }
+        if (c != start) {
+            Chunk *seen = start;
+            while (seen->first < c->first
+                   && !hint.compare_exchange_weak(seen, c,
+                                                  std::memory_order_release,
+                                                  std::memory_order_acquire)) {
+            }
+        }
+        return c;
+    }
+
+    Chunk *
+    append(Chunk *last) {
+        auto fresh = std::make_unique<Chunk>(last->first + mask_ + 1,
+                                             mask_ + 1);
+        Chunk *expected = nullptr;
+        if (last->next.compare_exchange_strong(expected, fresh.get(),
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+            ++Stats::local().queue_growths;
+            return fresh.release();
+        }
+        // Another pusher linked one first and ours is thrown away.
+        return expected;
+    }
+};
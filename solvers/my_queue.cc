@@ -12,9 +12,10 @@ module;
 #include <cstdlib>
 #include <iostream>
 #include <vector>
-module labyrinth:my_queue;
+export module labyrinth:my_queue;
+import :stats;
 
-template <class Value_type> class My_queue {
+export template <class Value_type> class My_queue {
 
   public:
     My_queue() : elems_(initial_size), capacity_(initial_size) {
@@ -83,6 +84,14 @@ template <class Value_type> class My_queue {
         return size_ == 0;
     }
 
+    // Forget all elements but keep the capacity we have grown to so far.
+    void
+    clear() {
+        size_ = 0;
+        front_ = 0;
+        back_ = 0;
+    }
+
   private:
     static constexpr size_t initial_size = 8;
     static constexpr size_t full_queue = 1UL << 63;
@@ -94,6 +103,7 @@ template <class Value_type> class My_queue {
 
     void
     grow() {
+        ++Stats::local().queue_growths;
         std::vector<Value_type> new_elems(capacity_ * 2);
         size_t const first_chunk = std::min(size_, capacity_ - front_);
         std::copy_n(&elems_[front_], first_chunk, new_elems.data());
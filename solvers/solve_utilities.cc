@@ -1,18 +1,25 @@
 module;
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <mutex>
 #include <optional>
 #include <random>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 module labyrinth:solve_utilities;
 import :maze;
+import :stats;
+import :trace;
 import :my_queue;
 import :speed;
 import :printers;
+import :render;
 
 namespace Sutil {
 
@@ -120,6 +127,11 @@ constexpr std::array<std::string_view, 16> thread_colors = {
     ansi_grn_blu_prp,  // 0b1110
     ansi_wit,          // 0b1111
 };
+// The 256 color palette codes behind thread_colors for output that is not a
+// terminal, such as an image.
+constexpr std::array<uint8_t, 16> thread_color_codes
+    = {15, 1, 2, 3, 4, 201, 87, 121, 183, 204, 106, 105, 57, 89, 60, 231};
+constexpr uint8_t start_and_finish_color_code = 87;
 // north, east, south, west
 constexpr std::array<Maze::Point, 4> dirs
     = {{{-1, 0}, {0, 1}, {1, 0}, {0, -1}}};
@@ -128,15 +140,84 @@ constexpr std::array<Maze::Point, 7> all_dirs
     = {{{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}}};
 constexpr int overlap_key_and_message_height = 9;
 constexpr std::array<Speed::Speed_unit, 8> solver_speeds
-    = {0, 20000, 10000, 5000, 2000, 1000, 500, 250};
+    = {0, 1, 2, 3, 8, 17, 33, 67};
 
+/// Visited marks that live beside the maze in a flat array rather than in the
+/// thread cache bits of each Square. A square is marked only if its stamp
+/// matches the current epoch so starting a new search forgets every old mark
+/// in O(1). We only sweep the array when the small counter wraps around or
+/// the dimensions of the maze change.
+class Epoch_marks {
+  public:
+    void
+    next_epoch(Maze::Maze const &maze) {
+        uint64_t const squares = static_cast<uint64_t>(maze.row_size())
+                                 * static_cast<uint64_t>(maze.col_size());
+        if (squares != stamps_.size() || maze.col_size() != cols_) {
+            stamps_.assign(squares, 0);
+            cols_ = maze.col_size();
+            epoch_ = 1;
+            return;
+        }
+        if (++epoch_ == 0) {
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    void
+    mark(Maze::Point const &p) {
+        stamps_[(static_cast<uint64_t>(p.row) * cols_) + p.col] = epoch_;
+    }
+
+    bool
+    is_marked(Maze::Point const &p) const {
+        return stamps_[(static_cast<uint64_t>(p.row) * cols_) + p.col]
+               == epoch_;
+    }
+
+  private:
+    std::vector<uint16_t> stamps_;
+    int cols_{0};
+    uint16_t epoch_{0};
+};
+
+/// Visited marks kept in one thread's cache bit of each Square, where an
+/// animation frame can show them.
+class Cache_marks {
+  public:
+    Cache_marks(Maze::Maze &maze, Thread_cache bit) : maze_(maze), bit_(bit) {
+    }
+
+    void
+    mark(Maze::Point const &p) {
+        maze_[p.row][p.col] |= bit_;
+    }
+
+    bool
+    is_marked(Maze::Point const &p) const {
+        return (maze_[p.row][p.col] & bit_).load() != 0;
+    }
+
+  private:
+    Maze::Maze &maze_;
+    Thread_cache bit_;
+};
+
+/// Every thread polls cancelled on every step, so it sits alone on its line
+/// where the one store that ends the search is the only write it ever sees.
+/// The winner is kept apart from it because a late thread still tries to
+/// swap into winning_index, and each thread's path or queue is padded so one
+/// thread's pushes do not evict the line its neighbor is pushing to.
 struct Dfs_monitor {
     std::mutex monitor{};
     std::optional<Speed::Speed_unit> speed{};
     std::vector<Maze::Point> starts{};
-    Maze::Square winning_index{no_winner};
-    std::vector<std::vector<Maze::Point>> thread_paths;
-    Dfs_monitor() : thread_paths{num_threads, std::vector<Maze::Point>{}} {
+    alignas(Maze::cache_line) std::atomic_bool cancelled{false};
+    alignas(Maze::cache_line) Maze::Square winning_index{no_winner};
+    std::vector<Maze::Padded<std::vector<Maze::Point>>> thread_paths;
+    std::span<Maze::Bit_marks> thread_marks{};
+    Dfs_monitor() : thread_paths(num_threads) {
         for (std::vector<Maze::Point> &path : thread_paths) {
             path.reserve(initial_path_len);
         }
@@ -146,14 +227,17 @@ struct Dfs_monitor {
 struct Bfs_monitor {
     std::mutex monitor{};
     std::optional<Speed::Speed_unit> speed{};
-    std::vector<std::unordered_map<Maze::Point, Maze::Point>> thread_maps;
-    std::vector<My_queue<Maze::Point>> thread_queues;
+    std::vector<Maze::Padded<std::unordered_map<Maze::Point, Maze::Point>>>
+        thread_maps;
+    std::vector<Maze::Padded<My_queue<Maze::Point>>> thread_queues;
     std::vector<Maze::Point> starts{};
-    Maze::Square winning_index{no_winner};
-    std::vector<std::vector<Maze::Point>> thread_paths;
+    alignas(Maze::cache_line) std::atomic_bool cancelled{false};
+    alignas(Maze::cache_line) Maze::Square winning_index{no_winner};
+    std::vector<Maze::Padded<std::vector<Maze::Point>>> thread_paths;
+    std::span<Maze::Bit_marks> thread_marks{};
     Bfs_monitor()
-        : thread_maps{num_threads}, thread_queues{num_threads},
-          thread_paths{num_threads, std::vector<Maze::Point>{}} {
+        : thread_maps(num_threads), thread_queues(num_threads),
+          thread_paths(num_threads) {
         for (std::vector<Maze::Point> &path : thread_paths) {
             path.reserve(initial_path_len);
         }
@@ -163,6 +247,62 @@ struct Bfs_monitor {
     }
 };
 
+/// The first thread to call this wins. Every call also tells the other
+/// threads to stop so they never need to read the winner's line to find out.
+template <class Monitor>
+bool
+declare_winner(Monitor &monitor, uint16_t index) {
+    bool const won = monitor.winning_index.ces(no_winner, index);
+    monitor.cancelled.store(true, std::memory_order_relaxed);
+    return won;
+}
+
+/// Searches that share their squares claim each one with their cache bit. Only
+/// the first thread to claim a square gets true, so it is expanded once.
+bool
+claim_square(Maze::Square &square, Thread_cache claim) {
+    for (Maze::Square_bits seen = square.load(); !(seen & cache_mask);
+         seen = square.load()) {
+        bool const claimed = square.ces(seen, seen | claim);
+        Stats::count_cas(claimed);
+        if (claimed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Animations and static solves asked for grid marks keep visits in the
+/// thread's cache bit. Otherwise they go in the thread's Maze::Bit_marks.
+template <Maze::Visit_marks Marks>
+decltype(auto)
+marks_for(Maze::Maze &maze, Dfs_monitor &monitor, Thread_id id) {
+    if constexpr (Marks == Maze::Visit_marks::grid) {
+        return Cache_marks(maze, Thread_cache(id.bit << thread_cache_shift));
+    } else {
+        return (monitor.thread_marks[id.index]);
+    }
+}
+
+/// Call this from the dispatching thread before the workers start. Marks
+/// from the last solve of this maze are forgotten without touching them.
+std::span<Maze::Bit_marks>
+next_thread_marks(Maze::Maze &maze) {
+    return maze.next_thread_marks(num_threads);
+}
+
+/// Threads that kept their visits private paint them here after they are
+/// joined, so each square is written by one thread with no one to race.
+void
+publish_paint(Maze::Maze &maze,
+              std::span<Maze::Bit_marks const> thread_marks) {
+    for (uint64_t i = 0; i < thread_marks.size(); ++i) {
+        Thread_paint const paint_bit(thread_bits.at(i) << thread_paint_shift);
+        thread_marks[i].for_each(
+            [&](Maze::Point const &p) { maze[p.row][p.col] |= paint_bit; });
+    }
+}
+
 bool
 is_valid_start_or_finish(Maze::Maze const &maze, Maze::Point const &choice) {
     return choice.row > 0 && choice.row < maze.row_size() - 1 && choice.col > 0
@@ -172,58 +312,119 @@ is_valid_start_or_finish(Maze::Maze const &maze, Maze::Point const &choice) {
            && !(maze[choice.row][choice.col] & start_bit);
 }
 
-void
-print_point(Maze::Maze const &maze, Maze::Point const &point) {
-    Maze::Square const &square = maze[point.row][point.col];
+// Works from a copy of the bits so a recorded square draws as it was then.
+std::string_view
+point_glyph(Maze::Maze const &maze, Maze::Square_bits square) {
     if (square & finish_bit) {
-        std::cout << ansi_finish;
-        return;
+        return ansi_finish;
     }
     if (square & start_bit) {
-        std::cout << ansi_start;
-        return;
+        return ansi_start;
     }
     if (square & thread_paint_mask) {
         Thread_paint const thread_color
-            = (square & thread_paint_mask).load() >> thread_paint_shift;
-        std::cout << thread_colors.at(thread_color);
-        return;
+            = (square & thread_paint_mask) >> thread_paint_shift;
+        return thread_colors.at(thread_color);
     }
     if (!(square & Maze::path_bit)) {
-        std::cout << maze.wall_style()[(square & Maze::wall_mask).load()];
-        return;
+        return maze.wall_style()[square & Maze::wall_mask];
     }
     if (square & Maze::path_bit) {
-        std::cout << " ";
-        return;
+        return " ";
     }
     std::cerr << "Printed maze and a square was not categorized."
               << "\n";
     std::abort();
 }
 
+std::string_view
+point_glyph(Maze::Maze const &maze, Maze::Point const &point) {
+    return point_glyph(maze, maze[point.row][point.col].load());
+}
+
 void
-print_maze(Maze::Maze const &maze) {
+print_point(Maze::Maze const &maze, Maze::Point const &point) {
+    std::cout << point_glyph(maze, point);
+}
+
+// A frame is written once it holds a band, so it never needs more than a band
+// and one row of the widest glyphs, start and finish.
+uint64_t
+frame_bytes(Maze::Maze const &maze) {
+    uint64_t const row_bytes = (static_cast<uint64_t>(maze.col_size()) + 1)
+                               * ansi_finish.size();
+    return std::min(static_cast<uint64_t>(maze.row_size()) * row_bytes,
+                    Printer::band_bytes + row_bytes)
+           + 16;
+}
+
+void
+append_maze(Printer::Frame &frame, Maze::Maze const &maze) {
     for (int row = 0; row < maze.row_size(); row++) {
         for (int col = 0; col < maze.col_size(); col++) {
-            print_point(maze, {row, col});
+            frame.append(point_glyph(maze, {row, col}));
         }
-        std::cout << "\n";
+        frame.append('\n');
+        frame.write_band();
     }
-    std::cout << std::flush;
 }
 
+void
+print_maze(Maze::Maze const &maze) {
+    Trace::Scope const trace("paint paths");
+    Printer::Frame frame(frame_bytes(maze));
+    append_maze(frame, maze);
+    frame.write_out();
+}
+
+// Every bit point_glyph reads. The cache bits a thread sets on each square it
+// visits only matter to an overview.
+constexpr Maze::Square_bits point_glyph_bits
+    = finish_bit | start_bit | thread_paint_mask | Maze::path_bit
+      | Maze::wall_mask;
+
+uint32_t
+point_key(Maze::Maze const &maze, Render::Event const &e) {
+    return maze[e.p.row][e.p.col].load() & point_glyph_bits;
+}
+
+void
+write_point(Printer::Frame &frame, Maze::Maze const &maze, Maze::Point const &,
+            uint32_t key) {
+    frame.append(point_glyph(maze, static_cast<Maze::Square_bits>(key)));
+}
+
+Render::Summary
+summarize_point(uint32_t key) {
+    auto const square = static_cast<Maze::Square_bits>(key);
+    return {
+        .wall = !(square & Maze::path_bit),
+        .visited = (square & cache_mask) != 0,
+        .painted = (square & (thread_paint_mask | start_bit | finish_bit)) != 0,
+    };
+}
+
+constexpr Render::Glyphs path_glyphs{point_key, write_point, summarize_point,
+                                     cache_mask};
+
 void
 flush_cursor_path_coordinate(Maze::Maze const &maze, Maze::Point const &point) {
+    if (Render::submit(point)) {
+        return;
+    }
     Printer::set_cursor_position(point);
     print_point(maze, point);
     std::cout << std::flush;
 }
 
+using Terminal_render = Render::Terminal_render<flush_cursor_path_coordinate>;
+
 void
 clear_and_flush_paths(Maze::Maze const &maze) {
-    Printer::clear_screen();
-    print_maze(maze);
+    Printer::Frame frame(frame_bytes(maze));
+    frame.clear_screen();
+    append_maze(frame, maze);
+    frame.write_out();
 }
 
 Maze::Point
@@ -253,6 +454,7 @@ find_nearest_square(Maze::Maze const &maze, Maze::Point const &choice) {
 
 std::vector<Maze::Point>
 set_corner_starts(Maze::Maze const &maze) {
+    Trace::Scope const trace("place starts");
     Maze::Point point1 = {1, 1};
     if (!(maze[point1.row][point1.col] & Maze::path_bit)) {
         point1 = find_nearest_square(maze, point1);
@@ -274,7 +476,8 @@ set_corner_starts(Maze::Maze const &maze) {
 
 Maze::Point
 pick_random_point(Maze::Maze const &maze) {
-    std::mt19937 generator(std::random_device{}());
+    Trace::Scope const trace("place point");
+    std::mt19937 generator(Maze::random_seed());
     std::uniform_int_distribution<int> row_random(1, maze.row_size() - 2);
     std::uniform_int_distribution<int> col_random(1, maze.col_size() - 2);
     Maze::Point choice = {row_random(generator), col_random(generator)};
@@ -286,36 +489,52 @@ pick_random_point(Maze::Maze const &maze) {
 
 void
 print_hunt_solution_message(uint16_t winning_index) {
+    if (Printer::headless()) {
+        return;
+    }
     if (winning_index == Sutil::no_winner) {
-        std::cout << thread_colors.at(all_threads_failed_index);
+        std::cout << thread_colors.at(all_threads_failed_index) << "\n";
         return;
     }
     std::cout << (thread_colors.at(thread_bits.at(winning_index)))
-              << " thread won!\n";
+              << " thread won!\n\n";
 }
 
 void
 print_gather_solution_message() {
+    if (Printer::headless()) {
+        return;
+    }
     for (uint16_t const &mask : thread_bits) {
         std::cout << thread_colors.at(mask);
     }
-    std::cout << " All threads found their finish squares!\n";
+    std::cout << " All threads found their finish squares!\n\n";
 }
 
 void
 deluminate_maze(Maze::Maze &maze) {
+    // Every square is overwritten in order so one cursor move per row will do.
+    uint64_t const row_bytes = static_cast<uint64_t>(maze.col_size())
+                               + Printer::max_cursor_bytes + 1;
+    Printer::Frame frame(
+        std::min(static_cast<uint64_t>(maze.row_size()) * row_bytes,
+                 Printer::band_bytes + row_bytes));
     for (int row = 0; row < maze.row_size(); ++row) {
+        frame.set_cursor_position({row, 0});
         for (int col = 0; col < maze.col_size(); ++col) {
-            Printer::set_cursor_position({row, col});
-            std::cout << " ";
+            frame.append(' ');
         }
-        std::cout << "\n";
+        frame.append('\n');
+        frame.write_band();
     }
-    std::cout << std::flush;
+    frame.write_out();
 }
 
 void
 print_overlap_key() {
+    if (Printer::headless()) {
+        return;
+    }
     std::cout << "┌────────────────────────────────────────────────────────────"
                  "────┐\n"
               << "│     Overlap Key: 3_THREAD | 2_THREAD | 1_THREAD | 0_THREAD "
@@ -0,0 +1,457 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+export module labyrinth:steal;
+import :maze;
+import :stats;
+import :trace;
+import :speed;
+import :printers;
+import :render;
+import :solve_utilities;
+import :work_deque;
+
+//////////////////////////////////   Exported Interface
+
+/// Unlike the other depth first searches the threads here do not race each
+/// other. They share one search, each working a private deque as its stack.
+/// When a thread runs dry it steals the oldest branch waiting in another
+/// thread's deque, which is the subtree split off at the junction closest to
+/// the start. Every square is claimed once through the shared thread cache
+/// bits so no square is ever expanded twice. Every square a thread expands
+/// keeps its color as in floodfs, so this is also the team form of floodfs.
+export namespace Steal_dfs {
+void hunt(Maze::Maze &maze);
+void animate_hunt(Maze::Maze &maze, Speed::Speed speed);
+void gather(Maze::Maze &maze);
+void animate_gather(Maze::Maze &maze, Speed::Speed speed);
+void corners(Maze::Maze &maze);
+void animate_corners(Maze::Maze &maze, Speed::Speed speed);
+} // namespace Steal_dfs
+
+/// The breadth first partner of Steal_dfs. It is the same team and the same
+/// search, but each thread takes the oldest square in its own deque rather
+/// than the newest, so the team spreads out from the start in rough breadth
+/// first order. The path found is not always the shortest because a thief
+/// may run a little ahead of the others.
+export namespace Steal_bfs {
+void hunt(Maze::Maze &maze);
+void animate_hunt(Maze::Maze &maze, Speed::Speed speed);
+void gather(Maze::Maze &maze);
+void animate_gather(Maze::Maze &maze, Speed::Speed speed);
+void corners(Maze::Maze &maze);
+void animate_corners(Maze::Maze &maze, Speed::Speed speed);
+} // namespace Steal_bfs
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+/// Which end of its own deque a thread works from. Thieves always take the
+/// oldest square whatever the order.
+enum class Take_order {
+    newest, // Depth first, the deque is a stack.
+    oldest, // Breadth first, the deque is a queue.
+};
+
+struct Steal_monitor {
+    std::mutex monitor{};
+    // One per worker. Maze::team_workers picks how many, one per color if 0.
+    std::vector<Work_deque<Maze::Point>> deques;
+    // Flat index of the square that claimed us. Starts point to themselves.
+    std::vector<int> parents;
+    // Squares pushed to any deque but not yet fully expanded. The search is
+    // over when this reaches zero because no thread can make more work.
+    std::atomic_int64_t pending{0};
+    std::atomic_bool done{false};
+    Maze::Square winning_index{Sutil::no_winner};
+    int finishes_goal{1};
+    std::vector<Maze::Point> finishes{};
+    explicit Steal_monitor(Maze::Maze const &maze)
+        : deques(Maze::team_workers() ? Maze::team_workers()
+                                      : Sutil::num_threads),
+          parents(static_cast<uint64_t>(maze.row_size())
+                  * static_cast<uint64_t>(maze.col_size())) {
+    }
+};
+
+// Workers past the fourth share colors. A claim only asks whether any thread
+// holds the square so two workers with one cache bit still never meet.
+Sutil::Thread_id
+worker_color(uint64_t worker) {
+    auto const color = static_cast<uint16_t>(worker % Sutil::num_threads);
+    return {color, Sutil::thread_bits.at(color)};
+}
+
+void
+seed(Maze::Maze &maze, Steal_monitor &monitor, uint64_t worker,
+     Maze::Point const &start) {
+    Sutil::Thread_id const id = worker_color(worker);
+    int const start_i = (start.row * maze.col_size()) + start.col;
+    if (!Sutil::claim_square(maze[start.row][start.col],
+                             id.bit << Sutil::thread_cache_shift)) {
+        return;
+    }
+    monitor.parents[start_i] = start_i;
+    monitor.pending.fetch_add(1, std::memory_order_relaxed);
+    monitor.deques.at(worker).push(start);
+}
+
+std::optional<Maze::Point>
+steal_work(Steal_monitor &monitor, uint64_t worker) {
+    uint64_t const workers = monitor.deques.size();
+    for (uint64_t count = 1, i = (worker + 1) % workers; count < workers;
+         count++, ++i %= workers) {
+        std::optional<Maze::Point> work = monitor.deques.at(i).steal();
+        if (work) {
+            return work;
+        }
+    }
+    return {};
+}
+
+void
+reach_finish(Steal_monitor &monitor, Sutil::Thread_id id,
+             Maze::Point const &finish) {
+    static_cast<void>(monitor.winning_index.ces(Sutil::no_winner, id.index));
+    std::scoped_lock const lock(monitor.monitor);
+    monitor.finishes.push_back(finish);
+    if (static_cast<int>(monitor.finishes.size()) >= monitor.finishes_goal) {
+        monitor.done.store(true, std::memory_order_relaxed);
+    }
+}
+
+template <Take_order Order>
+std::optional<Maze::Point>
+take(Work_deque<Maze::Point> &mine) {
+    if constexpr (Order == Take_order::newest) {
+        return mine.pop();
+    } else {
+        return mine.steal();
+    }
+}
+
+template <class Render_policy, Take_order Order>
+void
+stealer(Maze::Maze &maze, Steal_monitor &monitor, uint64_t worker,
+        Render_policy const &render) {
+    Trace::Scope const trace(Order == Take_order::newest ? "stealdfs stealer"
+                                                         : "stealbfs stealer");
+    Stats::Counters &stats = Stats::local();
+    Sutil::Thread_id const id = worker_color(worker);
+    Sutil::Thread_cache const claim(id.bit << Sutil::thread_cache_shift);
+    Sutil::Thread_paint const paint_bit(id.bit << Sutil::thread_paint_shift);
+    Work_deque<Maze::Point> &mine = monitor.deques.at(worker);
+    int const cols = maze.col_size();
+    while (!monitor.done.load(std::memory_order_relaxed)
+           && monitor.pending.load(std::memory_order_relaxed) > 0) {
+        std::optional<Maze::Point> work = take<Order>(mine);
+        if (!work) {
+            work = steal_work(monitor, worker);
+        }
+        if (!work) {
+            std::this_thread::yield();
+            continue;
+        }
+        Maze::Point const cur = *work;
+        // Keep expanding past a finish. In a gather another finish may only be
+        // reachable through this one.
+        if (maze[cur.row][cur.col] & Sutil::finish_bit) {
+            Stats::reached_finish();
+            reach_finish(monitor, id, cur);
+        }
+        maze[cur.row][cur.col] |= paint_bit;
+        render.draw(maze, cur);
+
+        ++stats.expanded;
+        // Every open branch goes on our deque, not just the first. The ones we
+        // do not get to right away are what the other threads steal. Biased
+        // towards the dispatch direction like the other searches.
+        for (uint64_t count = 0, i = id.index; count < Sutil::dirs.size();
+             count++, ++i %= Sutil::dirs.size()) {
+            ++stats.neighbor_checks;
+            Maze::Point const &p = Sutil::dirs.at(i);
+            Maze::Point const next = {cur.row + p.row, cur.col + p.col};
+            if ((maze[next.row][next.col] & Maze::path_bit)
+                && Sutil::claim_square(maze[next.row][next.col], claim)) {
+                monitor.parents[(next.row * cols) + next.col]
+                    = (cur.row * cols) + cur.col;
+                monitor.pending.fetch_add(1, std::memory_order_relaxed);
+                mine.push(next);
+            }
+        }
+        // Only after our children are counted so pending never hits zero
+        // while work remains.
+        monitor.pending.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+template <class Render_policy, Take_order Order>
+void
+solve_with_stealing(Maze::Maze &maze, Steal_monitor &monitor,
+                    Render_policy const &render) {
+    std::vector<std::thread> threads(monitor.deques.size());
+    for (uint64_t worker = 0; worker < threads.size(); worker++) {
+        threads[worker]
+            = std::thread(stealer<Render_policy, Order>, std::ref(maze),
+                          std::ref(monitor), worker, render);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+}
+
+// Every thread may have had a hand in the path to a finish so it is painted
+// in the color of all threads overlapping.
+template <class Render_policy>
+void
+paint_solutions(Maze::Maze &maze, Steal_monitor const &monitor,
+                Render_policy const &render) {
+    int const cols = maze.col_size();
+    for (Maze::Point const &finish : monitor.finishes) {
+        int cur = (finish.row * cols) + finish.col;
+        for (; monitor.parents[cur] != cur; cur = monitor.parents[cur]) {
+            Maze::Point const p = {cur / cols, cur % cols};
+            maze[p.row][p.col] |= Sutil::thread_paint_mask;
+            render.draw(maze, p);
+        }
+    }
+}
+
+template <Take_order Order>
+void
+team_hunt(Maze::Maze &maze) {
+    Steal_monitor monitor(maze);
+    Maze::Point const start = Sutil::pick_random_point(maze);
+    maze[start.row][start.col] |= Sutil::start_bit;
+    Maze::Point const finish = Sutil::pick_random_point(maze);
+    maze[finish.row][finish.col] |= Sutil::finish_bit;
+    // One thread starts with all the work. The rest steal their share.
+    seed(maze, monitor, 0, start);
+    solve_with_stealing<Render::No_render, Order>(maze, monitor,
+                                                  Render::No_render{});
+    paint_solutions(maze, monitor, Render::No_render{});
+    Sutil::print_maze(maze);
+    Sutil::print_overlap_key();
+    Sutil::print_hunt_solution_message(monitor.winning_index.load());
+}
+
+template <Take_order Order>
+void
+team_gather(Maze::Maze &maze) {
+    Steal_monitor monitor(maze);
+    monitor.finishes_goal = Sutil::num_gather_finishes;
+    Maze::Point const start = Sutil::pick_random_point(maze);
+    maze[start.row][start.col] |= Sutil::start_bit;
+    for (int finish_square = 0; finish_square < Sutil::num_gather_finishes;
+         finish_square++) {
+        Maze::Point const finish = Sutil::pick_random_point(maze);
+        maze[finish.row][finish.col] |= Sutil::finish_bit;
+    }
+    seed(maze, monitor, 0, start);
+    solve_with_stealing<Render::No_render, Order>(maze, monitor,
+                                                  Render::No_render{});
+    paint_solutions(maze, monitor, Render::No_render{});
+    Sutil::print_maze(maze);
+    Sutil::print_overlap_key();
+    Sutil::print_gather_solution_message();
+}
+
+template <Take_order Order>
+void
+team_corners(Maze::Maze &maze) {
+    Steal_monitor monitor(maze);
+    std::vector<Maze::Point> starts = Sutil::set_corner_starts(maze);
+    for (Maze::Point const &p : starts) {
+        maze[p.row][p.col] |= Sutil::start_bit;
+    }
+    Maze::Point const finish = {maze.row_size() / 2, maze.col_size() / 2};
+    for (Maze::Point const &p : Sutil::all_dirs) {
+        Maze::Point const next = {finish.row + p.row, finish.col + p.col};
+        maze[next.row][next.col] |= Maze::path_bit;
+    }
+    maze[finish.row][finish.col] |= Maze::path_bit;
+    maze[finish.row][finish.col] |= Sutil::finish_bit;
+    // Randomly shuffle thread start corners so colors mix differently each
+    // time.
+    shuffle(begin(starts), end(starts), std::mt19937(Maze::random_seed()));
+    for (uint64_t i = 0; i < starts.size(); i++) {
+        seed(maze, monitor, i % monitor.deques.size(), starts.at(i));
+    }
+    solve_with_stealing<Render::No_render, Order>(maze, monitor,
+                                                  Render::No_render{});
+    paint_solutions(maze, monitor, Render::No_render{});
+    Sutil::print_maze(maze);
+    Sutil::print_overlap_key();
+    Sutil::print_hunt_solution_message(monitor.winning_index.load());
+}
+
+template <Take_order Order>
+void
+animate_team_hunt(Maze::Maze &maze, Speed::Speed speed) {
+    Printer::set_cursor_position({maze.row_size(), 0});
+    Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
+    Sutil::Terminal_render const render{
+        Sutil::solver_speeds.at(static_cast<int>(speed))};
+    Steal_monitor monitor(maze);
+    Maze::Point const start = Sutil::pick_random_point(maze);
+    maze[start.row][start.col] |= Sutil::start_bit;
+    Sutil::flush_cursor_path_coordinate(maze, start);
+    Maze::Point const finish = Sutil::pick_random_point(maze);
+    maze[finish.row][finish.col] |= Sutil::finish_bit;
+    render.draw(maze, finish);
+    seed(maze, monitor, 0, start);
+    solve_with_stealing<Sutil::Terminal_render, Order>(maze, monitor, render);
+    paint_solutions(maze, monitor, render);
+    session.stop();
+    Printer::set_cursor_position(
+        {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
+    Sutil::print_hunt_solution_message(monitor.winning_index.load());
+}
+
+template <Take_order Order>
+void
+animate_team_gather(Maze::Maze &maze, Speed::Speed speed) {
+    Printer::set_cursor_position({maze.row_size(), 0});
+    Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
+    Sutil::Terminal_render const render{
+        Sutil::solver_speeds.at(static_cast<int>(speed))};
+    Steal_monitor monitor(maze);
+    monitor.finishes_goal = Sutil::num_gather_finishes;
+    Maze::Point const start = Sutil::pick_random_point(maze);
+    maze[start.row][start.col] |= Sutil::start_bit;
+    Sutil::flush_cursor_path_coordinate(maze, start);
+    for (int finish_square = 0; finish_square < Sutil::num_gather_finishes;
+         finish_square++) {
+        Maze::Point const finish = Sutil::pick_random_point(maze);
+        maze[finish.row][finish.col] |= Sutil::finish_bit;
+        render.draw(maze, finish);
+    }
+    seed(maze, monitor, 0, start);
+    solve_with_stealing<Sutil::Terminal_render, Order>(maze, monitor, render);
+    paint_solutions(maze, monitor, render);
+    session.stop();
+    Printer::set_cursor_position(
+        {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
+    Sutil::print_gather_solution_message();
+}
+
+template <Take_order Order>
+void
+animate_team_corners(Maze::Maze &maze, Speed::Speed speed) {
+    Printer::set_cursor_position({maze.row_size(), 0});
+    Sutil::print_overlap_key();
+    Render::Session session(maze, Sutil::path_glyphs,
+                            Render::Screen::maze);
+    Sutil::Terminal_render const render{
+        Sutil::solver_speeds.at(static_cast<int>(speed))};
+    Steal_monitor monitor(maze);
+    std::vector<Maze::Point> starts = Sutil::set_corner_starts(maze);
+    for (Maze::Point const &p : starts) {
+        maze[p.row][p.col] |= Sutil::start_bit;
+        render.draw(maze, p);
+    }
+    Maze::Point const finish = {maze.row_size() / 2, maze.col_size() / 2};
+    for (Maze::Point const &p : Sutil::all_dirs) {
+        Maze::Point const next = {finish.row + p.row, finish.col + p.col};
+        maze[next.row][next.col] |= Maze::path_bit;
+        render.draw(maze, next);
+    }
+    maze[finish.row][finish.col] |= Maze::path_bit;
+    maze[finish.row][finish.col] |= Sutil::finish_bit;
+    render.draw(maze, finish);
+    shuffle(begin(starts), end(starts), std::mt19937(Maze::random_seed()));
+    for (uint64_t i = 0; i < starts.size(); i++) {
+        seed(maze, monitor, i % monitor.deques.size(), starts.at(i));
+    }
+    solve_with_stealing<Sutil::Terminal_render, Order>(maze, monitor, render);
+    paint_solutions(maze, monitor, render);
+    session.stop();
+    Printer::set_cursor_position(
+        {maze.row_size() + Sutil::overlap_key_and_message_height, 0});
+    Sutil::print_hunt_solution_message(monitor.winning_index.load());
+}
+
+} // namespace
+
+///////////  Multithreaded Dispatcher Functions from Header Interface
+
+namespace Steal_dfs {
+
+void
+hunt(Maze::Maze &maze) {
+    team_hunt<Take_order::newest>(maze);
+}
+
+void
+animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
+    animate_team_hunt<Take_order::newest>(maze, speed);
+}
+
+void
+gather(Maze::Maze &maze) {
+    team_gather<Take_order::newest>(maze);
+}
+
+void
+animate_gather(Maze::Maze &maze, Speed::Speed speed) {
+    animate_team_gather<Take_order::newest>(maze, speed);
+}
+
+void
+corners(Maze::Maze &maze) {
+    team_corners<Take_order::newest>(maze);
+}
+
+void
+animate_corners(Maze::Maze &maze, Speed::Speed speed) {
+    animate_team_corners<Take_order::newest>(maze, speed);
+}
+
+} // namespace Steal_dfs
+
+namespace Steal_bfs {
+
+void
+hunt(Maze::Maze &maze) {
+    team_hunt<Take_order::oldest>(maze);
+}
+
+void
+animate_hunt(Maze::Maze &maze, Speed::Speed speed) {
+    animate_team_hunt<Take_order::oldest>(maze, speed);
+}
+
+void
+gather(Maze::Maze &maze) {
+    team_gather<Take_order::oldest>(maze);
+}
+
+void
+animate_gather(Maze::Maze &maze, Speed::Speed speed) {
+    animate_team_gather<Take_order::oldest>(maze, speed);
+}
+
+void
+corners(Maze::Maze &maze) {
+    team_corners<Take_order::oldest>(maze);
+}
+
+void
+animate_corners(Maze::Maze &maze, Speed::Speed speed) {
+    animate_team_corners<Take_order::oldest>(maze, speed);
+}
+
+} // namespace Steal_bfs
@@ -0,0 +1,137 @@
+/// File: work_deque.cc
+/// -------------------
+/// This file contains a Chase-Lev work stealing deque. The owning thread
+/// pushes and pops at the bottom like a normal stack so it continues a depth
+/// first search exactly as it would with a std::vector. Idle threads steal
+/// from the top where the oldest entries live. In a depth first search those
+/// are the branches closest to the root, so a thief walks away with the
+/// largest unexplored subtree it can find and rarely needs to steal again.
+///
+/// The ring grows by doubling when the owner fills it. Thieves may still be
+/// reading an old ring when that happens so old rings are retired, not freed,
+/// until the deque itself is destroyed. A search only grows a handful of times
+/// so this costs very little memory.
+module;
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+module labyrinth:work_deque;
+import :maze;
+
+template <class Value_type> class Work_deque {
+
+  public:
+    Work_deque() {
+        retired_.push_back(std::make_unique<Ring>(initial_capacity));
+        ring_.store(retired_.back().get(), std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    void
+    push(Value_type const &elem) {
+        int64_t const b = bottom_.load(std::memory_order_relaxed);
+        int64_t const t = top_.load(std::memory_order_acquire);
+        Ring *r = ring_.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(r->mask)) {
+            r = grow(r, t, b);
+        }
+        r->put(b, elem);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    std::optional<Value_type>
+    pop() {
+        int64_t const b = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring *r = ring_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return {};
+        }
+        Value_type elem = r->get(b);
+        if (t == b) {
+            // Last element. Race any thieves for it.
+            bool const won = top_.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            if (!won) {
+                return {};
+            }
+        }
+        return elem;
+    }
+
+    // Any thread. An empty result means the deque was empty or another thread
+    // beat us to the top element; either way the caller should look elsewhere.
+    std::optional<Value_type>
+    steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t const b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return {};
+        }
+        Ring const *r = ring_.load(std::memory_order_acquire);
+        Value_type elem = r->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return {};
+        }
+        return elem;
+    }
+
+    bool
+    empty() const {
+        return bottom_.load(std::memory_order_relaxed)
+               <= top_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static constexpr uint64_t initial_capacity = 256;
+
+    // Slots are atomic so a thief reading while the owner writes a different
+    // lap of the ring is not a data race. Relaxed access compiles to plain
+    // loads and stores for a small trivially copyable type like Maze::Point.
+    struct Ring {
+        uint64_t mask;
+        std::unique_ptr<std::atomic<Value_type>[]> slots;
+        explicit Ring(uint64_t capacity)
+            : mask(capacity - 1),
+              slots(std::make_unique<std::atomic<Value_type>[]>(capacity)) {
+        }
+
+        Value_type
+        get(int64_t i) const {
+            return slots[static_cast<uint64_t>(i) & mask].load(
+                std::memory_order_relaxed);
+        }
+
+        void
+        put(int64_t i, Value_type const &elem) {
+            slots[static_cast<uint64_t>(i) & mask].store(
+                elem, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(Maze::cache_line) std::atomic_int64_t top_{0};
+    alignas(Maze::cache_line) std::atomic_int64_t bottom_{0};
+    alignas(Maze::cache_line) std::atomic<Ring *> ring_{nullptr};
+    std::vector<std::unique_ptr<Ring>> retired_;
+
+    Ring *
+    grow(Ring const *old, int64_t t, int64_t b) {
+        retired_.push_back(std::make_unique<Ring>((old->mask + 1) * 2));
+        Ring *bigger = retired_.back().get();
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        ring_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+};
@@ -1,7 +1,15 @@
+module;
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
 export module labyrinth:speed;
 
+//////////////////////////////////   Exported Interface
+
 export namespace Speed {
 
+/// Steps of an algorithm shown per frame. Zero means no limit at all.
 using Speed_unit = int;
 
 enum class Speed {
@@ -15,4 +23,94 @@ enum class Speed {
     speed_7,
 };
 
+constexpr int frames_per_second = 60;
+constexpr std::chrono::microseconds frame_period
+    = std::chrono::microseconds(1'000'000) / frames_per_second;
+
+/// Sleeping a few microseconds after every square costs more in timer slack
+/// and system calls than the step itself, and how long an animation took
+/// depended on how big the maze was and how the scheduler felt. Instead every
+/// animated thread counts its steps and, once it has taken steps_per_frame in
+/// this frame, sleeps until the next frame begins. Each thread then advances
+/// in batches that line up with the frames the renderer draws, so a speed
+/// level takes the same wall time per step on any maze and any machine. Some
+/// steps, such as a builder backtracking, may count as more than one.
+void pace(Speed_unit steps_per_frame, Speed_unit cost = 1);
+
+/// Sleeps until the next frame boundary of the clock every animation shares.
+void wait_for_next_frame();
+
+/// A recording has no viewer to wait for. With logical pacing a thread that
+/// finishes its batch moves straight on to the next frame without sleeping,
+/// so animations run at full speed while keeping their frame numbers.
+enum class Pacing {
+    real_time,
+    logical,
+};
+
+void set_pacing(Pacing pacing);
+
+/// How many frames the calling thread has finished batches for.
+uint64_t frames_paced();
+
+} // namespace Speed
+
+//////////////////////////////////   Implementation
+
+namespace {
+
+std::atomic<Speed::Pacing> pacing{Speed::Pacing::real_time};
+thread_local uint64_t frames_paced_by_thread = 0;
+
+// Every thread measures frames from the same instant so their batches and the
+// frames drawn by the renderer all begin together.
+std::chrono::steady_clock::time_point
+frame_origin() {
+    static std::chrono::steady_clock::time_point const origin
+        = std::chrono::steady_clock::now();
+    return origin;
+}
+
+} // namespace
+
+namespace Speed {
+
+void
+wait_for_next_frame() {
+    std::chrono::steady_clock::time_point const origin = frame_origin();
+    auto const frames_so_far
+        = (std::chrono::steady_clock::now() - origin) / frame_period;
+    std::this_thread::sleep_until(origin
+                                  + ((frames_so_far + 1) * frame_period));
+}
+
+void
+pace(Speed_unit steps_per_frame, Speed_unit cost) {
+    if (steps_per_frame <= 0) {
+        return;
+    }
+    thread_local Speed_unit steps_this_frame = 0;
+    steps_this_frame += cost;
+    // A costly step may fill several frames. Each one is waited out and what
+    // is left over counts towards the next.
+    Speed_unit const frames = steps_this_frame / steps_per_frame;
+    steps_this_frame %= steps_per_frame;
+    for (Speed_unit frame = 0; frame < frames; ++frame) {
+        ++frames_paced_by_thread;
+        if (pacing.load(std::memory_order_relaxed) == Pacing::real_time) {
+            wait_for_next_frame();
+        }
+    }
+}
+
+void
+set_pacing(Pacing new_pacing) {
+    pacing.store(new_pacing, std::memory_order_relaxed);
+}
+
+uint64_t
+frames_paced() {
+    return frames_paced_by_thread;
+}
+
 } // namespace Speed